@@ -0,0 +1,95 @@
+// Pathfinding benchmark on a large random map: A* queries per second and
+// flow-field rebuild time.
+//
+//   make bench-path && ./twindisseia-bench-path [size] [queries]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "Map.h"
+#include "Pathfinding.h"
+#include "Rng.h"
+
+using Clock = std::chrono::steady_clock;
+
+static double msSince(Clock::time_point t0) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+// Bordered map with ~25% scattered wall tiles.
+static Map makeMap(int size, Rng& rng) {
+  Map map(size, size);
+  for (int y = 1; y < size - 1; ++y)
+    for (int x = 1; x < size - 1; ++x)
+      if (rng.bounded(4) == 0) map.setTile(x, y, Tile::Wall);
+  return map;
+}
+
+static void randomFloor(const Map& map, Rng& rng, int& x, int& y) {
+  do {
+    x = (int)rng.bounded(map.getWidth());
+    y = (int)rng.bounded(map.getHeight());
+  } while (!map.isWalkable(x, y));
+}
+
+int main(int argc, char** argv) {
+  const int size    = argc > 1 ? std::atoi(argv[1]) : 4096;
+  const int queries = argc > 2 ? std::atoi(argv[2]) : 2000;
+  Rng rng(7);
+
+  auto t0 = Clock::now();
+  Map map = makeMap(size, rng);
+  std::printf("map %dx%d built in %.1f ms (%zu chunks, %.1f MB)\n",
+              size, size, msSince(t0), map.chunkCount(), map.memoryBytes() / 1e6);
+
+  // A*: random pairs up to ~100 tiles apart
+  Pathfinder pf(map, 1 << 16);
+  std::vector<PathPoint> path;
+  path.reserve(1024);
+  int found = 0;
+  long long steps = 0, expanded = 0;
+  t0 = Clock::now();
+  for (int q = 0; q < queries; ++q) {
+    int sx, sy, tx, ty;
+    randomFloor(map, rng, sx, sy);
+    do {
+      tx = sx + (int)rng.bounded(201) - 100;
+      ty = sy + (int)rng.bounded(201) - 100;
+    } while (!map.isWalkable(tx, ty));
+    if (pf.findPath(sx, sy, tx, ty, path)) { ++found; steps += (long long)path.size(); }
+    expanded += pf.lastExpanded();
+  }
+  double ms = msSince(t0);
+  std::printf("A*        : %d queries in %.1f ms -> %.0f queries/s "
+              "(%d found, avg path %.1f, avg expanded %.0f)\n",
+              queries, ms, queries / (ms / 1000.0), found,
+              found ? (double)steps / found : 0.0, (double)expanded / queries);
+
+  // flow field rebuilds at a few radii
+  for (int radius : { 16, 32, 64, 128, 200 }) {
+    FlowField ff(map, radius);
+    const int reps = 50;
+    int px, py;
+    randomFloor(map, rng, px, py);
+    t0 = Clock::now();
+    for (int i = 0; i < reps; ++i) {
+      ff.invalidate();
+      ff.update(px, py);
+    }
+    ms = msSince(t0) / reps;
+
+    // agents stepping: one table lookup each
+    long long moves = 0;
+    auto t1 = Clock::now();
+    for (int i = 0; i < 1000000; ++i) {
+      int dx, dy;
+      int x = px - radius + (int)rng.bounded(2 * radius + 1);
+      int y = py - radius + (int)rng.bounded(2 * radius + 1);
+      moves += ff.step(x, y, dx, dy);
+    }
+    double stepNs = std::chrono::duration<double, std::nano>(Clock::now() - t1).count() / 1e6;
+    std::printf("flow r=%-3d: rebuild %.3f ms (%d cells), step %.1f ns/agent (%lld moved)\n",
+                radius, ms, (2 * radius + 1) * (2 * radius + 1), stepNs, moves);
+  }
+  return 0;
+}
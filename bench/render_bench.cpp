@@ -0,0 +1,195 @@
+// Renderer benchmark: the same frames drawn through NcursesRenderer and
+// AnsiRenderer on terminals of several sizes, reporting time per frame
+// and bytes sent to the terminal per frame.
+//
+//   make bench-render && ./twindisseia-bench-render [frames]
+//
+// Output goes into a pipe that is emptied (and counted) between frames,
+// outside the timed part, so the numbers are the cost of producing the
+// bytes and handing them to the kernel.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <fcntl.h>
+#include <ncurses.h>
+#include <unistd.h>
+#include "AnsiRenderer.h"
+#include "DungeonGenerator.h"
+#include "EntityStore.h"
+#include "Fov.h"
+#include "Map.h"
+#include "MessageLog.h"
+#include "NcursesRenderer.h"
+#include "Player.h"
+#include "Rng.h"
+#include "StartingGear.h"
+#include "Ui.h"
+
+using Clock = std::chrono::steady_clock;
+
+struct World {
+  DungeonLayout layout;
+  Map map;
+  Player player;
+  EntityStore actors;
+  EntityHandle foe;
+  Fov fov;
+  MessageLog log;
+
+  World()
+  : map(generateDungeon(config(), layout)),
+    player(layout.spawnX, layout.spawnY),
+    fov(map, 10) {
+    giveStartingGear(player);
+    Enemy proto;
+    giveStartingGear(proto);
+    Rng rng(7);
+    for (size_t r = 1; r < layout.rooms.size(); ++r) {
+      int x, y;
+      randomRoomTile(map, layout.rooms[r], rng, x, y);
+      proto.setPos(x, y);
+      EntityHandle h = actors.spawnEnemy(proto);
+      if (r == 1) foe = h;
+    }
+    log.push(MsgId::Welcome);
+  }
+  static DungeonConfig config() {
+    DungeonConfig c;
+    c.width = 512; c.height = 512; c.seed = 11; c.threads = 1;
+    return c;
+  }
+};
+
+// Pipe standing in for the terminal, big enough to hold a whole frame.
+struct Sink {
+  int fds[2] = { -1, -1 };
+  uint64_t bytes = 0;
+
+  bool open() {
+    if (pipe(fds) != 0) return false;
+    fcntl(fds[1], F_SETPIPE_SZ, 1 << 20);
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    return true;
+  }
+  void drain() {
+    char buf[1 << 16];
+    for (ssize_t n; (n = read(fds[0], buf, sizeof buf)) > 0; ) bytes += (uint64_t)n;
+  }
+  ~Sink() {
+    if (fds[0] >= 0) close(fds[0]);
+    if (fds[1] >= 0) close(fds[1]);
+  }
+};
+
+// walk: a step back and forth with field of view (mostly blank map)
+// scroll: the same steps with the whole map shown, every cell shifts
+// log:    a new message per frame, nothing else moves
+enum class Scenario { Walk, Scroll, Log };
+static const char* const kScenarioNames[] = { "walk", "scroll", "log" };
+
+struct Row { double usPerFrame; double bytesPerFrame; };
+
+// Draws `frames` frames; the first one (a full paint) is not counted.
+static Row play(Ui& ui, World& w, Sink& sink, Scenario sc, int frames) {
+  // scrolling needs a spot where the camera is not held by the map's edge
+  const bool mid = sc == Scenario::Scroll;
+  const int x0 = mid ? w.map.getWidth() / 2 : w.layout.spawnX;
+  const int y0 = mid ? w.map.getHeight() / 2 : w.layout.spawnY;
+  const int x1 = mid || w.map.isWalkable(x0 + 1, y0) ? x0 + 1 : x0 - 1;
+  w.player.setPos(x0, y0);
+  w.fov.update(x0, y0);
+  ui.layout();
+  ui.renderFrame(w.map, w.player, w.actors, w.foe, w.log, false);
+  sink.drain();
+  sink.bytes = 0;
+
+  double us = 0;
+  for (int i = 0; i < frames; ++i) {
+    if (sc != Scenario::Log) {
+      w.player.setPos(i & 1 ? x0 : x1, y0);
+      w.fov.update(w.player.getX(), w.player.getY());
+    }
+    w.log.push(MsgId::YouHit, { i % 6 + 1, 2, 3, 1, 1, 2, 4 });
+    const auto t0 = Clock::now();
+    ui.renderFrame(w.map, w.player, w.actors, w.foe, w.log, false);
+    us += std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+    sink.drain();
+  }
+  return { us / frames, (double)sink.bytes / frames };
+}
+
+static Row runNcurses(World& w, int rows, int cols, Scenario sc, int frames) {
+  Sink sink;
+  if (!sink.open()) return { 0, 0 };
+  FILE* out = fdopen(dup(sink.fds[1]), "w");
+  FILE* in = std::fopen("/dev/null", "r");
+  SCREEN* screen = newterm("xterm-256color", out, in);
+  if (!screen) screen = newterm("xterm", out, in);
+  if (!screen) { std::fclose(out); std::fclose(in); return { 0, 0 }; }
+  set_term(screen);
+  resizeterm(rows, cols);
+  noecho();
+  curs_set(0);
+  if (has_colors()) {
+    start_color();
+    use_default_colors();
+    init_pair(1, COLOR_RED, -1);
+    init_pair(2, COLOR_GREEN, -1);
+    init_pair(3, COLOR_CYAN, -1);
+    init_pair(5, COLOR_WHITE, -1);
+  }
+  Row r;
+  {
+    Ui ui(18, 5);
+    ui.setRenderer(std::make_unique<NcursesRenderer>());
+    ui.setVisibility(sc == Scenario::Scroll ? nullptr : &w.fov);
+    r = play(ui, w, sink, sc, frames);
+  }
+  endwin();
+  delscreen(screen);
+  sink.drain();
+  std::fclose(out);
+  std::fclose(in);
+  return r;
+}
+
+static Row runAnsi(World& w, int rows, int cols, Scenario sc, int frames, uint64_t& writes) {
+  Sink sink;
+  if (!sink.open()) return { 0, 0 };
+  auto screen = std::make_unique<AnsiRenderer>(sink.fds[1]);
+  AnsiRenderer* a = screen.get();
+  a->resize(rows, cols);
+  Ui ui(18, 5);
+  ui.setRenderer(std::move(screen));
+  ui.setVisibility(sc == Scenario::Scroll ? nullptr : &w.fov);
+  const Row r = play(ui, w, sink, sc, frames);
+  writes = a->writes();
+  return r;
+}
+
+int main(int argc, char** argv) {
+  const int frames = argc > 1 ? std::max(1, std::atoi(argv[1])) : 300;
+  const int sizes[][2] = { { 24, 80 }, { 60, 200 }, { 100, 320 }, { 150, 480 } };
+  World w;
+
+  std::printf("%-6s %-9s %14s %14s %14s %14s\n", "", "terminal",
+              "ncurses us/fr", "ansi us/fr", "ncurses B/fr", "ansi B/fr");
+  for (Scenario sc : { Scenario::Walk, Scenario::Scroll, Scenario::Log }) {
+    for (const auto& s : sizes) {
+      uint64_t writes = 0;
+      const Row n = runNcurses(w, s[0], s[1], sc, frames);
+      const Row a = runAnsi(w, s[0], s[1], sc, frames, writes);
+      char term[16];
+      std::snprintf(term, sizeof term, "%dx%d", s[1], s[0]);
+      std::printf("%-6s %-9s %14.1f %14.1f %14.0f %14.0f\n",
+                  kScenarioNames[(int)sc], term,
+                  n.usPerFrame, a.usPerFrame, n.bytesPerFrame, a.bytesPerFrame);
+      if (writes != (uint64_t)frames + 1)
+        std::printf("       (ansi made %llu write() calls for %d frames)\n",
+                    (unsigned long long)writes, frames + 1);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,64 @@
+// RNG microbenchmark: the old std::mt19937 dice path vs Rng vs RngBatch.
+//
+//   make bench-rng && ./twindisseia-bench-rng [rolls] [count] [sides]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "Rng.h"
+
+// The pre-Rng implementation: a fresh distribution for every roll.
+static int legacyRollDice(std::mt19937& rng, int count, int sides) {
+  if (count <= 0 || sides <= 0) return 0;
+  std::uniform_int_distribution<int> dist(1, sides);
+  int sum = 0;
+  for (int i = 0; i < count; ++i) sum += dist(rng);
+  return sum;
+}
+
+template <class F>
+static void report(const char* name, size_t rolls, F&& body) {
+  auto t0 = std::chrono::steady_clock::now();
+  long long checksum = body();
+  auto t1 = std::chrono::steady_clock::now();
+  double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+  std::printf("  %-26s %8.3f ns/roll  %8.1f M rolls/s  (sum %lld)\n",
+              name, ns / (double)rolls, (double)rolls / ns * 1e3, checksum);
+}
+
+int main(int argc, char** argv) {
+  size_t rolls = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20000000;
+  int count    = argc > 2 ? std::atoi(argv[2]) : 2;
+  int sides    = argc > 3 ? std::atoi(argv[3]) : 6;
+
+  std::printf("%zu rolls of %dd%d (SIMD batch: %s)\n",
+              rolls, count, sides, RngBatch::usingSimd() ? "avx2" : "scalar");
+
+  report("std::mt19937 + dist", rolls, [&]{
+    std::mt19937 rng(42);
+    long long s = 0;
+    for (size_t i = 0; i < rolls; ++i) s += legacyRollDice(rng, count, sides);
+    return s;
+  });
+
+  report("Rng::rollDice", rolls, [&]{
+    Rng rng(42);
+    long long s = 0;
+    for (size_t i = 0; i < rolls; ++i) s += rng.rollDice(count, sides);
+    return s;
+  });
+
+  std::vector<int> buf(4096);
+  report("RngBatch::roll (4096/call)", rolls, [&]{
+    RngBatch batch(Rng(42));
+    long long s = 0;
+    for (size_t done = 0; done < rolls; done += buf.size()) {
+      size_t m = std::min(buf.size(), rolls - done);
+      batch.roll(buf.data(), m, count, sides);
+      for (size_t k = 0; k < m; ++k) s += buf[k];
+    }
+    return s;
+  });
+  return 0;
+}
@@ -0,0 +1,548 @@
+// Benchmark suite for the core subsystems: dice, damage, turn order, the
+// job system, map queries and drawing, level building, text wrapping and
+// full UI frames on an off-screen terminal.
+//
+//   make bench                                 (build and run everything)
+//   ./twindisseia-bench --filter map/ --reps 20
+//   ./twindisseia-bench --fixed --json base.json
+//   ./twindisseia-bench --fixed --compare base.json --threshold 5
+//
+// Each benchmark runs `warmup` untimed repetitions, then `reps` timed ones,
+// and reports per-operation median/mean/stddev/min/max. By default the
+// iteration count is calibrated so one repetition takes about --min-ms.
+// --fixed uses a constant iteration count per benchmark instead, so two
+// runs do exactly the same work and --compare can report the change of
+// each median as a percentage (exit status 1 past --threshold).
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include <ncurses.h>
+#include <unistd.h>
+#include "AnsiRenderer.h"
+#include "AreaStreamer.h"
+#include "CombatResolver.h"
+#include "DicePlan.h"
+#include "DungeonGenerator.h"
+#include "EntityStore.h"
+#include "Fov.h"
+#include "JobSystem.h"
+#include "Map.h"
+#include "MessageLog.h"
+#include "NcursesRenderer.h"
+#include "Player.h"
+#include "Profiler.h"
+#include "Rng.h"
+#include "StartingGear.h"
+#include "ToolArgs.h"
+#include "TurnScheduler.h"
+#include "Ui.h"
+
+using Clock = std::chrono::steady_clock;
+
+// Keeps a value alive without letting the optimiser see through it.
+template <class T>
+static inline void keep(const T& v) { asm volatile("" : : "r,m"(v) : "memory"); }
+
+struct Benchmark {
+  std::string name;
+  uint64_t fixedIters;                      // per repetition in --fixed mode
+  std::function<void(uint64_t)> body;       // runs `iters` operations
+};
+
+struct Result {
+  std::string name;
+  uint64_t iters = 0;
+  int reps = 0;
+  double median = 0, mean = 0, stddev = 0, min = 0, max = 0;   // ns per op
+};
+
+struct Options {
+  std::string filter, jsonPath, comparePath;
+  int reps = 10, warmup = 2;
+  double minMs = 20, threshold = 10;
+  bool fixed = false, list = false;
+};
+
+static double timeRep(const Benchmark& b, uint64_t iters) {
+  auto t0 = Clock::now();
+  b.body(iters);
+  return std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+}
+
+static Result runOne(const Benchmark& b, const Options& o) {
+  uint64_t iters = b.fixedIters;
+  if (!o.fixed) {
+    // double until one repetition is long enough to time reliably
+    iters = 1;
+    while (timeRep(b, iters) < o.minMs * 1e6 && iters < (1ull << 40)) iters *= 2;
+  }
+  for (int i = 0; i < o.warmup; ++i) timeRep(b, iters);
+
+  std::vector<double> ns;
+  for (int i = 0; i < o.reps; ++i) ns.push_back(timeRep(b, iters) / (double)iters);
+  std::sort(ns.begin(), ns.end());
+
+  Result r;
+  r.name = b.name;
+  r.iters = iters;
+  r.reps = o.reps;
+  r.min = ns.front();
+  r.max = ns.back();
+  r.median = ns.size() % 2 ? ns[ns.size() / 2] : (ns[ns.size() / 2 - 1] + ns[ns.size() / 2]) / 2;
+  for (double v : ns) r.mean += v;
+  r.mean /= (double)ns.size();
+  for (double v : ns) r.stddev += (v - r.mean) * (v - r.mean);
+  r.stddev = ns.size() > 1 ? std::sqrt(r.stddev / (double)(ns.size() - 1)) : 0;
+  return r;
+}
+
+// One benchmark object per line, so the file is easy to diff and to read
+// back without a JSON library.
+static bool writeJson(const std::string& path, const std::vector<Result>& rs, bool fixed) {
+  FILE* f = std::fopen(path.c_str(), "w");
+  if (!f) return false;
+  std::fprintf(f, "{\n  \"mode\": \"%s\",\n  \"benchmarks\": [\n", fixed ? "fixed" : "calibrated");
+  for (size_t i = 0; i < rs.size(); ++i) {
+    const Result& r = rs[i];
+    std::fprintf(f, "    {\"name\": \"%s\", \"iterations\": %llu, \"reps\": %d, "
+                    "\"median_ns\": %.4f, \"mean_ns\": %.4f, \"stddev_ns\": %.4f, "
+                    "\"min_ns\": %.4f, \"max_ns\": %.4f}%s\n",
+                 r.name.c_str(), (unsigned long long)r.iters, r.reps, r.median, r.mean,
+                 r.stddev, r.min, r.max, i + 1 < rs.size() ? "," : "");
+  }
+  std::fprintf(f, "  ]\n}\n");
+  return std::fclose(f) == 0;
+}
+
+static bool readJson(const std::string& path, std::map<std::string, double>& medians) {
+  FILE* f = std::fopen(path.c_str(), "r");
+  if (!f) return false;
+  char line[1024];
+  while (std::fgets(line, sizeof line, f)) {
+    const char* n = std::strstr(line, "\"name\": \"");
+    const char* m = std::strstr(line, "\"median_ns\": ");
+    if (!n || !m) continue;
+    n += 9;
+    const char* e = std::strchr(n, '"');
+    if (!e) continue;
+    medians[std::string(n, e)] = std::atof(m + 13);
+  }
+  std::fclose(f);
+  return true;
+}
+
+// ---------------- off-screen terminal ----------------
+
+// ncurses screen whose output goes into a pipe that a thread drains
+// (counting bytes), so frames are fully encoded but never displayed.
+class PipeTerminal {
+public:
+  bool open(int cols, int lines) {
+    if (pipe(fds) != 0) return false;
+    out = fdopen(fds[1], "w");
+    in  = std::fopen("/dev/null", "r");
+    if (!out || !in) return false;
+    drain = std::thread([this]{
+      char buf[1 << 14];
+      for (ssize_t n; (n = read(fds[0], buf, sizeof buf)) > 0; ) bytes += (uint64_t)n;
+    });
+    screen = newterm("xterm-256color", out, in);
+    if (!screen) screen = newterm("xterm", out, in);
+    if (!screen) return false;
+    set_term(screen);
+    resizeterm(lines, cols);
+    noecho();
+    curs_set(0);
+    if (has_colors()) {
+      start_color();
+      use_default_colors();
+      for (short p = 1; p <= 5; ++p) init_pair(p, (short)(p % 8), -1);
+    }
+    return true;
+  }
+  ~PipeTerminal() {
+    if (screen) { endwin(); delscreen(screen); }
+    if (out) std::fclose(out);   // closes the write end; drain sees EOF
+    if (drain.joinable()) drain.join();
+    if (fds[0] >= 0) close(fds[0]);
+    if (in) std::fclose(in);
+  }
+  uint64_t bytesWritten() const { return bytes; }
+
+private:
+  int fds[2] = { -1, -1 };
+  FILE* out = nullptr;
+  FILE* in = nullptr;
+  SCREEN* screen = nullptr;
+  std::thread drain;
+  std::atomic<uint64_t> bytes{ 0 };
+};
+
+// ---------------- fixtures ----------------
+
+struct World {
+  DungeonLayout layout;
+  Map map;
+  Player player;
+  EntityStore actors;
+  EntityHandle foe;
+  Fov fov;
+
+  World()
+  : map(generateDungeon(config(), layout)),
+    player(layout.spawnX, layout.spawnY),
+    fov(map, 10) {
+    giveStartingGear(player);
+    Enemy proto;
+    giveStartingGear(proto);
+    Rng rng(7);
+    for (size_t r = 1; r < layout.rooms.size(); ++r) {
+      int x, y;
+      randomRoomTile(map, layout.rooms[r], rng, x, y);
+      proto.setPos(x, y);
+      EntityHandle h = actors.spawnEnemy(proto);
+      if (r == 1) foe = h;
+    }
+  }
+  static DungeonConfig config() {
+    DungeonConfig c;
+    c.width = 512; c.height = 512; c.seed = 11; c.threads = 1;
+    return c;
+  }
+};
+
+static std::vector<Benchmark> makeSuite(World& world, PipeTerminal* term) {
+  std::vector<Benchmark> suite;
+  // combatants point at gear, so the enemy has to outlive the suite
+  static Enemy enemy;
+  giveStartingGear(enemy);
+  static combat::Combatant P, E;
+  P = combat::fromPlayer(world.player);
+  E = combat::fromEnemy(enemy);
+
+  suite.push_back({ "dice/rollDice_2d6", 1 << 22, [](uint64_t n) {
+    Rng rng(1);
+    int s = 0;
+    for (uint64_t i = 0; i < n; ++i) s += combat::rollDice(rng, 2, 6);
+    keep(s);
+  }});
+  suite.push_back({ "dice/plan_1d8+2d4+1", 1 << 22, [](uint64_t n) {
+    static DicePlan plan;
+    std::string err;
+    DicePlan::compile("1d8+2d4+1", plan, err);
+    Rng rng(2);
+    int s = 0;
+    for (uint64_t i = 0; i < n; ++i) s += plan.roll(rng);
+    keep(s);
+  }});
+  suite.push_back({ "dice/plan_4d6kh3", 1 << 21, [](uint64_t n) {
+    static DicePlan plan;
+    std::string err;
+    DicePlan::compile("4d6kh3", plan, err);
+    Rng rng(3);
+    int s = 0;
+    for (uint64_t i = 0; i < n; ++i) s += plan.roll(rng);
+    keep(s);
+  }});
+  suite.push_back({ "dice/plan_batch_1d8+2d4+1", 1 << 22, [](uint64_t n) {
+    static DicePlan plan;
+    std::string err;
+    DicePlan::compile("1d8+2d4+1", plan, err);
+    RngBatch batch(Rng(4));
+    int out[1024];
+    int s = 0;
+    for (uint64_t i = 0; i < n; i += 1024) {
+      const size_t m = (size_t)std::min<uint64_t>(1024, n - i);
+      plan.rollMany(batch, out, m);
+      s += out[0];
+    }
+    keep(s);
+  }});
+  suite.push_back({ "combat/computeDamage", 1 << 24, [](uint64_t n) {
+    int s = 0;
+    for (uint64_t i = 0; i < n; ++i) {
+      const int k = (int)(i & 15);
+      s += combat::computeDamage(1 + (k % 6), 2, k, 1, k & 3, (k >> 2) & 3);
+    }
+    keep(s);
+  }});
+  suite.push_back({ "combat/resolveAttack", 1 << 21, [](uint64_t n) {
+    Rng rng(3);
+    int s = 0;
+    for (uint64_t i = 0; i < n; ++i) s += combat::resolveAttack(rng, P, E).dmg;
+    keep(s);
+  }});
+  suite.push_back({ "combat/resolveFight", 1 << 18, [](uint64_t n) {
+    Rng rng(4);
+    int s = 0;
+    for (uint64_t i = 0; i < n; ++i) s += combat::resolveFight(rng, P, E).turns;
+    keep(s);
+  }});
+
+  // one turn (next + done) with 100k actors of mixed speeds on the wheel
+  suite.push_back({ "turns/next_done_100k", 1 << 22, [](uint64_t n) {
+    static TurnScheduler sched;
+    if (sched.waiting() == 0) {
+      Rng rng(6);
+      for (uint32_t i = 0; i < 100000; ++i) sched.add(i, 1 + (int)rng.bounded(20));
+    }
+    uint64_t s = 0;
+    for (uint64_t i = 0; i < n; ++i) {
+      const TurnScheduler::ActorId id = sched.next();
+      sched.done(id, 50 + (int)(id % 100));
+      s += id;
+    }
+    keep(s);
+  }});
+  suite.push_back({ "combat/turnOrder", 1 << 24, [](uint64_t n) {
+    combat::TurnOrder order(7, 3);
+    int s = 0;
+    for (uint64_t i = 0; i < n; ++i) s += order.playerNext();
+    keep(s);
+  }});
+
+  // 64k fights in 16 chunks over all cores (compare with combat/resolveFight
+  // x 64k for the speed-up), and the cost of one two-job graph
+  suite.push_back({ "jobs/fights_64k", 1 << 4, [](uint64_t n) {
+    static JobSystem jobs;
+    int s = 0;
+    for (uint64_t i = 0; i < n; ++i)
+      s += jobs.parallelReduce(1 << 16, 1 << 12, 0, [i](size_t b, size_t e) {
+        Rng rng = Rng(4).split(i * 16 + b);
+        int t = 0;
+        for (size_t f = b; f < e; ++f) t += combat::resolveFight(rng, P, E).turns;
+        return t;
+      }, [](int& a, int p) { a += p; });
+    keep(s);
+  }});
+  suite.push_back({ "jobs/graph_2", 1 << 16, [](uint64_t n) {
+    static JobSystem jobs;
+    static int a = 0, b = 0;
+    static JobGraph g;
+    if (g.size() == 0) { g.add([]{ ++a; }); g.add([]{ ++b; }); }
+    for (uint64_t i = 0; i < n; ++i) jobs.run(g);
+    keep(a + b);
+  }});
+
+  // one level as the streaming worker builds it, and the queue hand-off
+  suite.push_back({ "area/build", 1 << 6, [](uint64_t n) {
+    size_t s = 0;
+    for (uint64_t i = 0; i < n; ++i) s += buildArea(7, 1 + (int)(i & 7))->actors.size();
+    keep(s);
+  }});
+  suite.push_back({ "area/spsc_push_pop", 1 << 24, [](uint64_t n) {
+    static SpscQueue<int, 8> q;
+    int s = 0, v = 0;
+    for (uint64_t i = 0; i < n; ++i) { q.push((int)i); q.pop(v); s += v; }
+    keep(s);
+  }});
+
+  // what a ProfileScope costs when the profiler is off, and when it records
+  suite.push_back({ "profiler/scope_off", 1 << 24, [](uint64_t n) {
+    for (uint64_t i = 0; i < n; ++i) { ProfileScope scope("bench"); keep(i); }
+  }});
+  suite.push_back({ "profiler/scope_on", 1 << 20, [](uint64_t n) {
+    Profiler::setEnabled(true);
+    for (uint64_t i = 0; i < n; ++i) { ProfileScope scope("bench"); keep(i); }
+    Profiler::setEnabled(false);
+  }});
+
+  // random probes over the whole map (cache-unfriendly on purpose)
+  static std::vector<uint32_t> probes;
+  probes.resize(1 << 16);
+  Rng prng(5);
+  for (uint32_t& p : probes) p = prng.next32();
+  const Map& map = world.map;
+  suite.push_back({ "map/isWalkable_random", 1 << 24, [&map](uint64_t n) {
+    const uint32_t w = (uint32_t)map.getWidth(), h = (uint32_t)map.getHeight();
+    int s = 0;
+    for (uint64_t i = 0; i < n; ++i) {
+      const uint32_t p = probes[i & (probes.size() - 1)];
+      s += map.isWalkable((int)((p & 0xFFFF) % w), (int)((p >> 16) % h));
+    }
+    keep(s);
+  }});
+  suite.push_back({ "map/isWalkable_scan", 1 << 24, [&map](uint64_t n) {
+    const int w = map.getWidth();
+    int s = 0, x = 0, y = 0;
+    for (uint64_t i = 0; i < n; ++i) {
+      s += map.isWalkable(x, y);
+      if (++x == w) { x = 0; y = (y + 1) % map.getHeight(); }
+    }
+    keep(s);
+  }});
+
+  suite.push_back({ "ui/wrapSpans_200ch_w60", 1 << 18, [](uint64_t n) {
+    static const std::string msg =
+        "You attack: d6=4 + atk=2 + w=7  vs  def=1 + flat=1 + arm=3 -> 8 dmg. "
+        "The enemy staggers back against the wall, its mace scraping the stone "
+        "floor as it raises its shield again and prepares for the next blow.";
+    MessageLog::Span lines[MessageLog::kMaxLines];
+    size_t s = 0;
+    for (uint64_t i = 0; i < n; ++i)
+      s += MessageLog::wrapSpans(msg.data(), msg.size(), 60, lines, MessageLog::kMaxLines);
+    keep(s);
+  }});
+  suite.push_back({ "log/push_format_wrap", 1 << 18, [](uint64_t n) {
+    static MessageLog log;
+    const MessageLog::Span* lines;
+    size_t s = 0;
+    for (uint64_t i = 0; i < n; ++i) {
+      const int k = (int)(i & 7);
+      log.push(MsgId::YouHit, { 1 + k % 6, 2, k, 1, 1, k / 2, 1 + k });
+      s += log.wrap(log.size() - 1, 60, lines);
+    }
+    keep(s);
+  }});
+
+  if (!term) return suite;
+
+  static WINDOW* win = nullptr;
+  if (!win) win = newwin(40, 120, 0, 0);
+  suite.push_back({ "map/drawTo_120x40", 1 << 12, [&map](uint64_t n) {
+    for (uint64_t i = 0; i < n; ++i) map.drawTo(win, (int)(i * 7 % 300), (int)(i * 3 % 400));
+    keep(win);
+  }});
+
+  static Ui* ui = nullptr;
+  static Ui* ansi = nullptr;
+  static std::string ansiOut;   // AnsiRenderer sink, emptied after every frame
+  if (!ui) {
+    ui = new Ui(18, 5);
+    ui->setRenderer(std::make_unique<NcursesRenderer>());
+    ui->setVisibility(&world.fov);
+    ui->layout();
+    ansi = new Ui(18, 5);
+    ansi->setRenderer(std::make_unique<AnsiRenderer>(&ansiOut, 50, 160));
+    ansi->setVisibility(&world.fov);
+    ansi->layout();
+  }
+  World& w = world;
+  static MessageLog log;
+  suite.push_back({ "ui/renderFrame_idle", 1 << 16, [&w](uint64_t n) {
+    w.fov.update(w.player.getX(), w.player.getY());
+    if (!log.size()) log.push(MsgId::Welcome);
+    for (uint64_t i = 0; i < n; ++i)
+      ui->renderFrame(w.map, w.player, w.actors, w.foe, log, false);
+  }});
+  suite.push_back({ "ui/renderFrame_walk", 1 << 10, [&w](uint64_t n) {
+    // alternate between two floor tiles: FOV, camera and map all change
+    const int x0 = w.layout.spawnX, y0 = w.layout.spawnY;
+    const int x1 = w.map.isWalkable(x0 + 1, y0) ? x0 + 1 : x0 - 1;
+    for (uint64_t i = 0; i < n; ++i) {
+      w.player.setPos(i & 1 ? x1 : x0, y0);
+      w.fov.update(w.player.getX(), w.player.getY());
+      log.push(MsgId::YouHit, { (int)(i % 6) + 1, 2, 3, 1, 1, 2, 4 });
+      ui->renderFrame(w.map, w.player, w.actors, w.foe, log, false);
+    }
+    w.player.setPos(x0, y0);
+  }});
+  suite.push_back({ "ui/renderFrame_walk_ansi", 1 << 10, [&w](uint64_t n) {
+    const int x0 = w.layout.spawnX, y0 = w.layout.spawnY;
+    const int x1 = w.map.isWalkable(x0 + 1, y0) ? x0 + 1 : x0 - 1;
+    for (uint64_t i = 0; i < n; ++i) {
+      w.player.setPos(i & 1 ? x1 : x0, y0);
+      w.fov.update(w.player.getX(), w.player.getY());
+      log.push(MsgId::YouHit, { (int)(i % 6) + 1, 2, 3, 1, 1, 2, 4 });
+      ansi->renderFrame(w.map, w.player, w.actors, w.foe, log, false);
+      ansiOut.clear();
+    }
+    w.player.setPos(x0, y0);
+  }});
+  return suite;
+}
+
+static void usage() {
+  std::printf(
+    "usage: twindisseia-bench [options]\n"
+    "  --filter S      only benchmarks whose name contains S\n"
+    "  --reps N        timed repetitions (default 10)\n"
+    "  --warmup N      untimed repetitions first (default 2)\n"
+    "  --min-ms X      calibrate iterations so a repetition takes X ms (default 20)\n"
+    "  --fixed         fixed iteration counts (same work every run)\n"
+    "  --json FILE     write results as JSON\n"
+    "  --compare FILE  compare medians against an earlier --json file\n"
+    "  --threshold P   %% slowdown that counts as a regression (default 10)\n"
+    "  --no-term       skip the benchmarks that need a terminal\n"
+    "  --list          list benchmark names and exit\n");
+}
+
+int main(int argc, char** argv) {
+  Options o;
+  bool useTerm = true;
+  for (int i = 1; i < argc; ++i) {
+    const char* a = argv[i];
+    auto next = [&]() -> const char* {
+      if (i + 1 >= argc) { usage(); std::exit(1); }
+      return argv[++i];
+    };
+    if      (!std::strcmp(a, "--filter"))    o.filter = next();
+    else if (!std::strcmp(a, "--reps"))      o.reps = std::max(1, std::atoi(next()));
+    else if (!std::strcmp(a, "--warmup"))    o.warmup = std::max(0, std::atoi(next()));
+    else if (!std::strcmp(a, "--min-ms"))    o.minMs = std::atof(next());
+    else if (!std::strcmp(a, "--fixed"))     o.fixed = true;
+    else if (!std::strcmp(a, "--json"))      o.jsonPath = next();
+    else if (!std::strcmp(a, "--compare"))   o.comparePath = next();
+    else if (!std::strcmp(a, "--threshold")) o.threshold = std::atof(next());
+    else if (!std::strcmp(a, "--no-term"))   useTerm = false;
+    else if (!std::strcmp(a, "--list"))      o.list = true;
+    else { usage(); return isHelpFlag(a) ? 0 : 1; }
+  }
+
+  std::map<std::string, double> baseline;
+  if (!o.comparePath.empty() && !readJson(o.comparePath, baseline)) {
+    std::fprintf(stderr, "%s: cannot read\n", o.comparePath.c_str());
+    return 1;
+  }
+
+  World world;
+  PipeTerminal term;
+  const bool haveTerm = useTerm && term.open(160, 50);
+  std::vector<Benchmark> suite = makeSuite(world, haveTerm ? &term : nullptr);
+
+  if (o.list) {
+    for (const Benchmark& b : suite) std::printf("%s\n", b.name.c_str());
+    return 0;
+  }
+
+  std::printf("%-28s %12s %10s %10s %10s %8s", "benchmark", "iters", "median", "mean",
+              "min", "stddev");
+  if (!baseline.empty()) std::printf(" %9s", "vs base");
+  std::printf("\n");
+
+  std::vector<Result> results;
+  int regressions = 0;
+  for (const Benchmark& b : suite) {
+    if (!o.filter.empty() && b.name.find(o.filter) == std::string::npos) continue;
+    const Result r = runOne(b, o);
+    results.push_back(r);
+    std::printf("%-28s %12llu %8.2fns %8.2fns %8.2fns %7.1f%%", r.name.c_str(),
+                (unsigned long long)r.iters, r.median, r.mean, r.min,
+                r.mean > 0 ? 100.0 * r.stddev / r.mean : 0.0);
+    auto it = baseline.find(r.name);
+    if (it != baseline.end() && it->second > 0) {
+      const double pct = 100.0 * (r.median - it->second) / it->second;
+      const bool slower = pct > o.threshold;
+      regressions += slower;
+      std::printf(" %+8.1f%%%s", pct, slower ? "  REGRESSION" : "");
+    }
+    std::printf("\n");
+    std::fflush(stdout);
+  }
+  if (haveTerm) std::printf("(terminal output drained: %.1f MB)\n", term.bytesWritten() / 1e6);
+
+  if (!o.jsonPath.empty() && !writeJson(o.jsonPath, results, o.fixed)) {
+    std::fprintf(stderr, "%s: cannot write\n", o.jsonPath.c_str());
+    return 1;
+  }
+  return regressions ? 1 : 0;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Renderer.h"
+
+// The direct backend: no ncurses in the output path. Panels draw into a
+// back grid of cells; present() compares it with the front grid (what the
+// terminal shows), emits cursor moves and SGR changes only where cells
+// differ, and hands the whole frame over in one write().
+//
+// Output goes either to a terminal fd (size from TIOCGWINSZ) or is
+// appended to a string (server sessions, sized by resize()).
+class AnsiRenderer : public Renderer {
+public:
+  explicit AnsiRenderer(int fd);
+  explicit AnsiRenderer(std::string* sink, int rows = 24, int cols = 80);
+  ~AnsiRenderer() override;   // resets attributes, shows the cursor
+  AnsiRenderer(const AnsiRenderer&) = delete;
+  AnsiRenderer& operator=(const AnsiRenderer&) = delete;
+
+  // New terminal size; the next frame repaints everything.
+  void resize(int rows, int cols);
+
+  void measure(int& rows, int& cols) override;
+  void place(Panel p, int y, int x, int h, int w) override;
+  void clear(Panel p) override;
+  void text(Panel p, int y, int x, const char* s, int n, uint8_t style) override;
+  void cells(Panel p, int y, int x, const Cell* c, int n) override;
+  void box(Panel p) override;
+  void touch(Panel) override {}
+  void present() override;
+
+  uint64_t bytesOut() const { return bytes; }
+  uint64_t writes() const { return writeCalls; }
+
+private:
+  struct Rect { int y = 0, x = 0, h = 0, w = 0; };
+
+  static constexpr int kMaxMove = 24;   // longest cursor move we emit, plus room
+  static constexpr int kEraseMin = 3;   // changed cells that make ESC [ K worth it
+
+  int fd = -1;
+  std::string* sink = nullptr;
+  int rows = 0, cols = 0;
+  std::vector<Cell> front, back;
+  std::vector<uint8_t> rowDirty;   // back rows written since the last present()
+  Rect panels[kPanels];
+  bool full = true;                // clear the terminal and send every cell
+  bool started = false;
+
+  std::string out;                 // the frame being built
+  int curY = -1, curX = -1;        // terminal cursor, -1 = unknown
+  uint8_t curStyle = kPlain;
+  uint64_t bytes = 0, writeCalls = 0;
+
+  Cell* at(Panel p, int y, int x, int& n);
+  int moveSeq(int y, int x, char* buf) const;
+  void moveTo(int y, int x);
+  void setStyle(uint8_t style);
+  void send();
+};
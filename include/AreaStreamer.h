@@ -0,0 +1,134 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "DungeonGenerator.h"
+#include "EntityStore.h"
+#include "Map.h"
+#include "Rng.h"
+#include "SpscQueue.h"
+
+// The generated world is a stack of dungeon levels ("areas"). Depth 0 is
+// where the game starts; a '>' on one level leads to the '<' of the next.
+// Each area depends only on (seed, depth), so it can be built on any
+// thread, dropped, and built again identically.
+
+struct Area {
+  uint64_t seed = 0;
+  int depth = 0;
+  Map map{0, 0, false};
+  DungeonLayout layout;
+  EntityStore actors;
+  // the player's explored memory while the area is not the current one
+  std::vector<int32_t>  exploredIdx;
+  std::vector<uint64_t> exploredBits;
+  uint64_t lastUsed = 0;   // AreaStreamer's clock when last left; 0 = never visited
+
+  size_t memoryBytes() const;
+};
+
+constexpr int kAreaWidth  = 160;
+constexpr int kAreaHeight = 80;
+constexpr int kAreaEnemies = 6;
+
+DungeonConfig areaConfig(uint64_t seed, int depth);
+
+// Enemies one per room (skipping the spawn room, starting at a random
+// room), at most `count`, never on (avoidX, avoidY). Returns the first.
+EntityHandle spawnRoomEnemies(const Map& map, const DungeonLayout& layout, EntityStore& actors,
+                              Rng& rng, int count, int avoidX, int avoidY);
+// The NPC somewhere in the spawn room.
+void spawnRoomNPC(const Map& map, const DungeonLayout& layout, EntityStore& actors,
+                  Rng& rng, int avoidX, int avoidY);
+
+// '<' on the spawn tile (below depth 0) and '>' in the room farthest from
+// it. Uses no randomness, so it never shifts anyone's RNG stream.
+void placeStairs(Map& map, DungeonLayout& layout, int depth);
+// Fills the layout's stairs from the tiles (maps loaded from a save).
+void findStairs(const Map& map, DungeonLayout& layout);
+
+// Map, stairs and actors of one level. Enemies are placed with the same
+// RNG stream the game starts on, so depth 0 comes out exactly as Game
+// sets it up at startup and can be rebuilt like any other level.
+std::unique_ptr<Area> buildArea(uint64_t seed, int depth);
+
+// Builds areas ahead of need and keeps the ones already made.
+//
+// request() hands a depth to a worker thread through a lock-free queue
+// and returns at once; finished areas come back through a second queue
+// and the worker then writes a byte to readyFd(), which the game's event
+// loop watches, so nothing ever waits on the worker. Without a worker
+// (headless replays) request() builds on the spot, which gives the same
+// area, just sooner.
+//
+// Areas the player has left stay cached until the total passes the
+// memory budget; then untouched prefetches go first, then the least
+// recently left levels (which come back freshly built next time).
+class AreaStreamer {
+public:
+  static constexpr size_t kDefaultBudget = 4u << 20;
+  static constexpr size_t kMaxInFlight = 4;
+
+  AreaStreamer(uint64_t seed, bool background, size_t budgetBytes = kDefaultBudget);
+  ~AreaStreamer();
+
+  AreaStreamer(const AreaStreamer&) = delete;
+  AreaStreamer& operator=(const AreaStreamer&) = delete;
+
+  // Forgets every area and makes `depth` the current level (a save was
+  // loaded; restore() then brings back the levels it kept).
+  void reseed(uint64_t seed, int depth);
+
+  // Starts building `depth` unless it is cached or on its way. Never blocks.
+  void request(int depth);
+  // Moves finished builds into the cache; true if any arrived.
+  bool collect();
+  bool ready(int depth) const { return cache.count(depth) != 0; }
+  bool building(int depth) const;
+
+  // Removes `depth` from the cache (nullptr if it is not there) and makes
+  // it the current level: it and its neighbours are never evicted.
+  std::unique_ptr<Area> take(int depth);
+  // Caches the area being left, then trims to the budget.
+  void store(std::unique_ptr<Area> area);
+  // Levels the player has left that are still cached, by depth (saves).
+  std::vector<const Area*> visited() const;
+  // Caches a level left before the save was taken, keeping its lastUsed.
+  void restore(std::unique_ptr<Area> area);
+
+  // Readable when a build has finished (-1 without a worker).
+  int readyFd() const { return donePipe[0]; }
+
+  size_t cachedBytes() const { return bytes; }
+  size_t cachedAreas() const { return cache.size(); }
+  uint64_t builds() const { return built; }
+  uint64_t evictions() const { return evicted; }
+
+private:
+  uint64_t seed;
+  bool background;
+  size_t budget;
+
+  std::map<int, std::unique_ptr<Area>> cache;
+  size_t bytes = 0;
+  uint64_t clock = 0;
+  int current = 0;
+  uint64_t built = 0, evicted = 0;
+  std::vector<int> inFlight;
+
+  // main -> worker: depths to build (with the seed they belong to);
+  // worker -> main: finished areas
+  struct Job { uint64_t seed; int depth; };
+  SpscQueue<Job, 8> jobs;
+  SpscQueue<std::unique_ptr<Area>, 8> done;
+  int wakePipe[2] = { -1, -1 };
+  int donePipe[2] = { -1, -1 };
+  std::atomic<bool> stop{false};
+  std::thread worker;
+
+  void loop();
+  void trim();
+};
@@ -0,0 +1,82 @@
+#pragma once
+#include <vector>
+#include "Equipment.h"
+#include "Player.h"
+#include "Enemy.h"
+#include "EntityStore.h"
+#include "Rng.h"
+#include "TurnScheduler.h"
+
+// Pure combat rules: dice, damage and turn order.
+// No ncurses here, so the same code drives both the interactive
+// CombatSystem and the headless simulator.
+namespace combat {
+
+// One side of a fight, flattened from Player/Enemy.
+// Gear is referenced, not copied, so building one is cheap.
+struct Combatant {
+  int hp = 0;
+  int speed = 0;
+  int attack = 0;
+  int defense = 0;
+
+  const Equipment* weapon = nullptr;
+  const Equipment* armor[3] = {nullptr, nullptr, nullptr}; // helmet/chest/boots
+  int armorCount = 0;
+};
+
+Combatant fromPlayer(const Player& p);
+Combatant fromEnemy(const Enemy& e);
+Combatant fromEntity(const EntityStore& actors, EntityHandle h);
+
+// Everything rolled for a single attack (kept for the combat log).
+struct AttackRoll {
+  int base = 0;       // d6
+  int atkDice = 0;    // weapon dice total
+  int defDice = 0;    // armor dice total
+  int flat = 0;       // flat armor reduction
+  int dmg = 0;        // final damage (>= 1)
+};
+
+struct FightResult {
+  bool playerWon = false;
+  int  turns = 0;     // attacks made by both sides
+  int  playerHP = 0;  // remaining at the end
+  int  enemyHP = 0;
+};
+
+inline int rollD6(Rng& rng) { return rng.uniform(1, 6); }
+inline int rollDice(Rng& rng, int count, int sides) { return rng.rollDice(count, sides); }
+
+// dmg = max(1, (baseD6 + ATK + atkDiceSum) - (DEF + flatDef + defDiceSum))
+int computeDamage(int baseD6, int atk, int atkDiceSum,
+                  int targetDef, int flatDef, int defDiceSum);
+
+// Who attacks next in a duel. This is TurnScheduler's energy rule for
+// exactly two actors with the player "first", worked out directly: both
+// start empty, the one that fills up sooner acts, ties go to the player.
+class TurnOrder {
+public:
+  TurnOrder(int playerSpeed, int enemySpeed);
+  bool playerNext();   // and advances
+
+private:
+  int ps, es;
+  int pe = 0, ee = 0;   // energy
+};
+
+// One period of a duel's turn order (1 = player). It repeats from there:
+// after it both sides are back to zero energy.
+std::vector<uint8_t> turnCycle(int playerSpeed, int enemySpeed);
+
+inline bool playerActsFirst(int playerSpeed, int enemySpeed) {
+  return TurnOrder(playerSpeed, enemySpeed).playerNext();
+}
+
+AttackRoll resolveAttack(Rng& rng,
+                         const Combatant& attacker, const Combatant& defender);
+
+// Plays a whole fight without any rendering or waiting.
+FightResult resolveFight(Rng& rng, Combatant player, Combatant enemy);
+
+} // namespace combat
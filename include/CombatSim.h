@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "CombatResolver.h"
+
+// Headless Monte Carlo fights, spread over all cores by the JobSystem.
+// Fights run in fixed chunks of kSimChunk, each with its own RNG stream,
+// so nothing is shared while running and the totals do not depend on the
+// thread count.
+
+constexpr uint64_t kSimChunk = 1 << 14;
+
+struct SimConfig {
+  uint64_t fights  = 1000000;
+  unsigned threads = 0;        // 0 = std::thread::hardware_concurrency()
+  uint64_t seed    = 1;
+};
+
+struct SimStats {
+  uint64_t fights = 0;
+  uint64_t playerWins = 0;
+  std::vector<uint64_t> turns;         // [n] = fights that took n attacks
+  std::vector<uint64_t> playerHpLeft;  // [hp] on player wins
+  std::vector<uint64_t> enemyHpLeft;   // [hp] on player losses
+
+  void add(const combat::FightResult& r);
+  void merge(const SimStats& o);
+
+  double winRate() const;
+};
+
+// Histogram helpers (index = value).
+double histMean(const std::vector<uint64_t>& h);
+int    histPercentile(const std::vector<uint64_t>& h, double q);
+
+SimStats simulateFights(const combat::Combatant& player,
+                        const combat::Combatant& enemy,
+                        const SimConfig& cfg);
@@ -1,22 +1,41 @@
 #pragma once
-#include <random>
-#include <string>
+#include "CombatResolver.h"
 #include "Player.h"
-#include "Enemy.h"
-#include "Map.h"
-#include "NPC.h"
-#include "Ui.h"
+#include "EntityStore.h"
+#include "Rng.h"
+#include "Task.h"
 
-// Turn-based, speed-ordered, dice combat.
-class CombatSystem {
+// Turn-based dice combat against one enemy; who attacks next follows the
+// energy rule (combat::TurnOrder), so the faster side attacks more often.
+// Rules live in CombatResolver; this task only paces and reports them:
+// each attack is announced, rolled after a short delay, and its result
+// waits for a key. Several fights can run at once (one per enemy).
+class CombatTask : public Task {
 public:
-  explicit CombatSystem(std::mt19937& rng);
-  // Runs the fight; updates lastMessage each step.
-  // Sets `running=false` if the player dies (so Game can exit).
-  void run(Map& map, Player& player, Enemy& enemy, NPC& npc,
-           Ui& ui, bool& running, std::string& lastMessage);
+  // If the player wins and `advance` is set, they step onto (ax, ay).
+  // Sets `running=false` once the player dies (so Game can exit).
+  CombatTask(Rng& rng, Player& player, EntityStore& actors, EntityHandle enemy,
+             MessageLog& log, bool& running, bool advance = false, int ax = 0, int ay = 0);
+
+  Wait step() override;
+  bool involves(EntityHandle h) const override { return h == enemy; }
+  EntityHandle opponent() const override { return enemy; }
+
+  static constexpr int kRollDelayMs = 250;
 
 private:
-  std::mt19937& rng;
-  int rollD6();
+  enum class Phase { Start, Announce, Roll, Result, Died };
+
+  Rng& rng;
+  Player& player;
+  EntityStore& actors;
+  EntityHandle enemy;
+  MessageLog& log;
+  bool& running;
+  bool advance;
+  int ax, ay;
+
+  Phase phase = Phase::Start;
+  combat::TurnOrder order;
+  bool playerTurn = true;
 };
@@ -1,16 +1,24 @@
 #pragma once
-#include <string>
-#include "NPC.h"
-#include "Map.h"
+#include "EntityStore.h"
 #include "Player.h"
-#include "Enemy.h"
-#include "Ui.h"
+#include "Task.h"
 
-// Simple modal dialogue: one line per key press.
-// Only the first line shows a "press key" indicator.
-class DialogueSystem {
+// Simple dialogue: one line per key press, then the player steps onto
+// the NPC's tile. Only the first line shows a "press key" indicator.
+class DialogueTask : public Task {
 public:
-  void run(const NPC& npc, Map& map,
-           const Player& player, const Enemy& enemy,
-           Ui& ui, std::string& lastMessage);
+  DialogueTask(EntityHandle npc, const EntityStore& actors, Player& player,
+               MessageLog& log, int ax, int ay)
+  : npc(npc), actors(actors), player(player), log(log), ax(ax), ay(ay) {}
+
+  Wait step() override;
+  bool involves(EntityHandle h) const override { return h == npc; }
+
+private:
+  EntityHandle npc;
+  const EntityStore& actors;
+  Player& player;
+  MessageLog& log;
+  int ax, ay;
+  size_t line = 0;   // next line to show
 };
@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class Rng;
+class RngBatch;
+
+// Compiled dice expressions: "2d4+1", "4d6kh3", "1d8!-1", "1d6,1d4".
+//
+// Grammar: terms joined by '+' or '-' (',' is an old spelling of '+').
+// A term is a number or NdS (N defaults to 1) followed by modifiers:
+//   khK / kK   keep the K highest dice     klK   keep the K lowest
+//   !          exploding: a die that shows its top face rolls again and
+//              adds, at most kMaxExplode times (so odds stay exact)
+//
+// compile() parses once and folds what it can: constants collapse into one
+// bias, Nd1 becomes a constant, empty and no-op terms vanish, keeping all
+// dice becomes a plain roll, and neighbouring plain terms of the same die
+// merge. The result is a small fixed-size value with no heap memory, so
+// Equipment can hold it by value and rolling needs no setup. Plain terms
+// draw from the Rng exactly like Rng::rollDice, term by term.
+struct DiceTerm {
+  enum Mode : uint8_t { Plain, KeepHigh, KeepLow, Explode };
+  int32_t count = 0;
+  int32_t sides = 0;
+  int16_t keep = 0;      // KeepHigh / KeepLow
+  uint8_t mode = Plain;
+  int8_t  sign = 1;      // +1 or -1
+};
+
+class DicePlan {
+public:
+  static constexpr int kMaxTerms = 6;
+  static constexpr int kMaxPool = 64;       // dice in a kh/kl term
+  static constexpr int kMaxExplode = 10;    // re-rolls per exploding die
+
+  // On error `out` is untouched and `err` says what is wrong.
+  static bool compile(const std::string& text, DicePlan& out, std::string& err);
+  // Plain NdS (nothing for count or sides <= 0).
+  static DicePlan dice(int count, int sides);
+
+  int roll(Rng& rng) const;
+  // out[i] = one roll each, for i in [0, n). Term by term, so the loop
+  // for each term is tight; the RngBatch version uses its wide lanes.
+  void rollMany(Rng& rng, int* out, size_t n) const;
+  void rollMany(RngBatch& batch, int* out, size_t n) const;
+
+  bool empty() const { return terms == 0 && bias == 0; }
+  int  constant() const { return bias; }
+  int  termCount() const { return terms; }
+  const DiceTerm& term(int i) const { return parts[i]; }
+
+  // Canonical text, compiles back to the same plan ("" when empty).
+  std::string toString() const;
+
+private:
+  DiceTerm parts[kMaxTerms];
+  int32_t bias = 0;
+  uint8_t terms = 0;
+
+  bool add(const DiceTerm& t);
+};
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Map.h"
+
+// Seeded procedural dungeons: BSP rooms, cellular-automata caves and
+// corridors. The map is split into square regions that generate
+// independently (one RNG stream per region) on all cores, then get
+// stitched together with corridors. Output depends only on the config,
+// never on the thread count. A final flood fill from the spawn carves
+// extra corridors until every room is reachable.
+
+struct Room {
+  int x = 0, y = 0, w = 0, h = 0;
+  int anchorX = 0, anchorY = 0;   // a floor tile inside the room
+  bool cave = false;
+};
+
+struct DungeonConfig {
+  int width  = 120;
+  int height = 60;
+  uint64_t seed = 1;
+  int regionSize = 64;     // rounded up to a multiple of Map::kChunkSize
+  int cavePercent = 25;    // chance that a region is a cave instead of rooms
+  unsigned threads = 0;    // 0 = all cores
+};
+
+struct DungeonLayout {
+  std::vector<Room> rooms;
+  int spawnRoom = 0;
+  int spawnX = 1, spawnY = 1;
+  int repairs = 0;         // corridors added by the connectivity check
+  int upX = -1, upY = -1;      // stairs, -1 = none (placed by AreaStreamer.cpp)
+  int downX = -1, downY = -1;
+};
+
+Map generateDungeon(const DungeonConfig& cfg, DungeonLayout& layout);
+
+// Random floor tile of a room (falls back to its anchor).
+class Rng;
+void randomRoomTile(const Map& map, const Room& room, Rng& rng, int& x, int& y);
@@ -1,5 +1,5 @@
 #pragma once
-#include "Equipment.h"
+#include "ItemRegistry.h"
 
 class Enemy {
 private:
@@ -10,10 +10,10 @@ private:
     int defense;
     bool alive;
 
-    // gear
-    Equipment weapon; // Weapon
-    Equipment helmet; // Helmet
-    Equipment chest;  // Chest
+    // gear (ids into ItemRegistry)
+    ItemId weapon = kNoItem;
+    ItemId helmet = kNoItem;
+    ItemId chest  = kNoItem;
     // (no boots for enemy per your spec)
 
 public:
@@ -33,11 +33,13 @@ public:
     void takeDamage(int dmg);
 
     // gear access / setters
-    const Equipment& getWeapon() const { return weapon; }
-    const Equipment& getHelmet() const { return helmet; }
-    const Equipment& getChest()  const { return chest;  }
+    const Equipment& getWeapon() const { return ItemRegistry::global().get(weapon); }
+    const Equipment& getHelmet() const { return ItemRegistry::global().get(helmet); }
+    const Equipment& getChest()  const { return ItemRegistry::global().get(chest);  }
+    ItemId weaponId() const { return weapon; }
+    ItemId helmetId() const { return helmet; }
+    ItemId chestId()  const { return chest;  }
 
-    void setWeapon(const Equipment& e) { weapon = e; }
-    void setHelmet(const Equipment& e) { helmet = e; }
-    void setChest (const Equipment& e) { chest  = e; }
+    // puts the item in its slot (kNoItem and boots are ignored)
+    void equip(ItemId id);
 };
@@ -0,0 +1,184 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Enemy.h"
+#include "ItemRegistry.h"
+#include "NPC.h"
+#include "SpatialIndex.h"
+
+// Structure-of-arrays storage for world actors (enemies and NPCs).
+//
+// Hot per-entity data lives in parallel dense arrays, so systems can sweep
+// positions/HP without touching anything else. Gear is an ItemId and dialogue
+// an index into a shared table, so an entity owns no heap memory of its own.
+// Handles carry a generation: a handle to a despawned entity stops
+// resolving even after its slot is reused. Spawn and despawn are O(1)
+// (despawn swaps the last dense element into the hole).
+// Positions are mirrored in a SpatialIndex, updated on spawn/setPos/despawn,
+// so tile and rectangle lookups cost O(1) / O(k) instead of a full scan.
+
+enum class EntityKind : uint8_t { Enemy, NPC };
+
+struct EntityHandle {
+  uint32_t slot = UINT32_MAX;
+  uint32_t gen  = 0;
+
+  bool operator==(const EntityHandle& o) const { return slot == o.slot && gen == o.gen; }
+  bool operator!=(const EntityHandle& o) const { return !(*this == o); }
+};
+
+class EntityStore {
+public:
+  EntityHandle spawnEnemy(const Enemy& proto);
+  EntityHandle spawnNPC(const NPC& proto);
+  void despawn(EntityHandle h);
+  void clear();
+  void reserve(size_t n);
+
+  bool valid(EntityHandle h) const {
+    return h.slot < slots.size() && slots[h.slot].gen == h.gen &&
+           slots[h.slot].dense != kFree;
+  }
+
+  // --- dense iteration: i in [0, size()) ---
+  size_t size() const { return kind.size(); }
+  EntityHandle handleAt(size_t i) const { return { denseSlot[i], slots[denseSlot[i]].gen }; }
+  // Whatever lives in slot s now (an invalid handle if nothing does).
+  EntityHandle handleOfSlot(uint32_t s) const {
+    return s < slots.size() ? EntityHandle{ s, slots[s].gen } : EntityHandle{};
+  }
+  EntityKind kindAt(size_t i) const { return kind[i]; }
+  int  xAt(size_t i) const { return xs[i]; }
+  int  yAt(size_t i) const { return ys[i]; }
+  bool aliveAt(size_t i) const { return alive[i] != 0; }
+
+  // --- per-handle access (handle must be valid) ---
+  EntityKind kindOf(EntityHandle h) const { return kind[d(h)]; }
+  int  getX(EntityHandle h) const { return xs[d(h)]; }
+  int  getY(EntityHandle h) const { return ys[d(h)]; }
+  int  getHP(EntityHandle h) const { return hp[d(h)]; }
+  int  getSpeed(EntityHandle h) const { return speed[d(h)]; }
+  int  getAttack(EntityHandle h) const { return attack[d(h)]; }
+  int  getDefense(EntityHandle h) const { return defense[d(h)]; }
+  bool isAlive(EntityHandle h) const { return alive[d(h)] != 0; }
+
+  void setPos(EntityHandle h, int nx, int ny) {
+    xs[d(h)] = nx; ys[d(h)] = ny;
+    index.move(h.slot, nx, ny);
+    markDirty(h.slot);
+  }
+  void takeDamage(EntityHandle h, int dmg);
+
+  const Equipment& getWeapon(EntityHandle h) const { return ItemRegistry::global().get(weapon[d(h)]); }
+  const Equipment& getHelmet(EntityHandle h) const { return ItemRegistry::global().get(helmet[d(h)]); }
+  const Equipment& getChest (EntityHandle h) const { return ItemRegistry::global().get(chest[d(h)]); }
+
+  const std::vector<std::string>& getDialog(EntityHandle h) const;
+
+  // --- spatial queries ---
+  // Live entity standing on (x, y) (dead bodies are ignored), or an
+  // invalid handle.
+  EntityHandle at(int x, int y) const;
+
+  // Calls f(i) with the dense index of every entity inside the rectangle.
+  template <class F>
+  void forEachInRect(int x0, int y0, int w, int h, F&& f) const {
+    if (w <= 0 || h <= 0) return;
+    const int x1 = x0 + w - 1, y1 = y0 + h - 1;
+    for (int cy = SpatialIndex::cellOf(y0); cy <= SpatialIndex::cellOf(y1); ++cy)
+      for (int cx = SpatialIndex::cellOf(x0); cx <= SpatialIndex::cellOf(x1); ++cx)
+        for (uint32_t s = index.first(cx, cy); s != SpatialIndex::kNone; s = index.next(s)) {
+          const uint32_t i = slots[s].dense;
+          if (xs[i] >= x0 && xs[i] <= x1 && ys[i] >= y0 && ys[i] <= y1) f((size_t)i);
+        }
+  }
+
+  size_t memoryBytes() const;
+
+  // --- snapshots (SaveGame) ---
+  static constexpr uint32_t kFree = UINT32_MAX;
+
+  struct Slot {
+    uint32_t dense = kFree;   // index into the dense arrays, kFree if unused
+    uint32_t gen = 0;
+    uint32_t nextFree = kFree;
+  };
+
+  // One entity's dense data, flattened.
+  struct Record {
+    EntityKind kind = EntityKind::Enemy;
+    uint8_t  alive = 0;
+    uint16_t dialog = 0;
+    int32_t  x = 0, y = 0, hp = 0, speed = 0, attack = 0, defense = 0;
+    ItemId   weapon = kNoItem, helmet = kNoItem, chest = kNoItem;
+    uint16_t pad = 0;   // keeps the raw bytes fully defined
+  };
+
+  Record recordAt(size_t i) const;
+  const std::vector<Slot>& slotTable() const { return slots; }
+  uint32_t freeListHead() const { return freeHead; }
+  const std::vector<uint32_t>& denseSlots() const { return denseSlot; }
+  const std::vector<std::vector<std::string>>& dialogTable() const { return dialogs; }
+
+  // Spatial index buckets (SpatialIndex keys): every occupied one, or
+  // those whose chain changed since clearDirty() (sorted, maybe empty now).
+  std::vector<uint64_t> indexBuckets() const;
+  std::vector<uint64_t> dirtyBuckets() const;
+  // One bucket's slots in an order that, inserted one by one, rebuilds the
+  // same chain (so queries visit actors in the same order after a reload).
+  void bucketChain(uint64_t bucket, std::vector<uint32_t>& out) const;
+
+  // Replaces everything; records are in dense order (records[i] belongs
+  // to denseOrder[i]). Handles saved with the same slot table stay valid.
+  void restore(std::vector<Slot> slotTable, uint32_t freeList,
+               const std::vector<uint32_t>& denseOrder, const std::vector<Record>& records,
+               const std::vector<uint32_t>& insertOrder,
+               std::vector<std::vector<std::string>> dialogLines);
+
+  // Slots whose entity data changed since clearDirty() (spawn, move,
+  // damage). Despawns show up in the slot table instead.
+  const std::vector<uint32_t>& dirtySlots() const { return dirtyList; }
+  // Slots whose slot-table entry or dense position changed since
+  // clearDirty() (spawn, despawn, and the entity moved into the hole).
+  const std::vector<uint32_t>& dirtyBookkeeping() const { return bookList; }
+  void clearDirty();
+
+private:
+
+  // sparse side
+  std::vector<Slot> slots;
+  uint32_t freeHead = kFree;
+
+  // dense side (parallel arrays)
+  std::vector<uint32_t>   denseSlot;
+  std::vector<EntityKind> kind;
+  std::vector<int32_t>    xs, ys;
+  std::vector<int32_t>    hp, speed, attack, defense;
+  std::vector<uint8_t>    alive;
+  std::vector<ItemId>     weapon, helmet, chest;
+  std::vector<uint16_t>   dialog;          // NPCs: index into dialogs
+
+  SpatialIndex index;   // keyed by slot
+
+  // shared table
+  std::vector<std::vector<std::string>> dialogs;
+
+  // snapshot dirty tracking, per slot
+  std::vector<uint8_t>  dirtyFlag;
+  std::vector<uint32_t> dirtyList;
+  std::vector<uint8_t>  bookFlag;
+  std::vector<uint32_t> bookList;
+
+  uint32_t d(EntityHandle h) const { return slots[h.slot].dense; }
+  void markDirty(uint32_t s) {
+    if (s >= dirtyFlag.size()) dirtyFlag.resize(slots.size(), 0);
+    if (!dirtyFlag[s]) { dirtyFlag[s] = 1; dirtyList.push_back(s); }
+  }
+  void markBookkeeping(uint32_t s) {
+    if (s >= bookFlag.size()) bookFlag.resize(slots.size(), 0);
+    if (!bookFlag[s]) { bookFlag[s] = 1; bookList.push_back(s); }
+  }
+  EntityHandle allocate();
+  uint16_t internDialog(const std::vector<std::string>& lines);
+};
@@ -1,11 +1,6 @@
 #pragma once
 #include <string>
-#include <vector>
-
-struct Dice {
-    int count = 0;  // e.g., 2 for "2d4"
-    int sides = 0;  // e.g., 4 for "2d4"
-};
+#include "DicePlan.h"
 
 enum class EquipSlot { Weapon, Helmet, Chest, Boots };
 
@@ -13,9 +8,9 @@ struct Equipment {
     std::string name;
     EquipSlot   slot;
 
-    // dice modifiers
-    std::vector<Dice> attackDice;   // extra damage dice (added to d6)
-    std::vector<Dice> defenseDice;  // damage reduction dice (subtracted)
+    // dice modifiers, compiled once (see DicePlan.h)
+    DicePlan attackDice;    // extra damage (added to d6), e.g. 1d8 or 2d4+1
+    DicePlan defenseDice;   // damage reduction (subtracted)
 
     // flat bonuses
     int flatDefBonus = 0;           // flat reduction to incoming damage
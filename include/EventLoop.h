@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <poll.h>
+#include <unordered_map>
+#include <vector>
+
+// Sleeps until the terminal has input, a watched descriptor is readable
+// or a timer is due.
+//
+// Timers live in a hashed timing wheel: kSlots buckets of kTickMs each,
+// indexed by due tick. Scheduling and cancelling are O(1); advancing the
+// wheel visits only the buckets whose ticks have passed. A timer further
+// out than one turn of the wheel just stays in its bucket until its own
+// tick comes round.
+//
+// With no input and no timers wait() blocks in poll(2) indefinitely, so an
+// idle game uses no CPU at all.
+class EventLoop {
+public:
+  using TimerId = uint64_t;
+  using Callback = std::function<void()>;
+
+  static constexpr uint32_t kTickMs = 1;
+  static constexpr size_t kSlots = 1024;   // power of two
+
+  EventLoop();
+
+  // Runs `cb` once, `ms` from now. Ids are never 0.
+  TimerId after(uint32_t ms, Callback cb);
+  // Runs `cb` every `ms` (at most once per wait if the loop falls behind).
+  TimerId every(uint32_t ms, Callback cb);
+  void cancel(TimerId id);
+  bool scheduled(TimerId id) const { return due.count(id) != 0; }
+
+  // Polls `fd` in every wait() from now on and runs `cb` when it is
+  // readable (cb must drain it). fd < 0 is ignored.
+  void watch(int fd, Callback cb);
+
+  // Blocks until `fd` or a watched descriptor is readable, a signal
+  // arrives (e.g. SIGWINCH) or the next timer is due, then runs the
+  // watchers and due timers. Returns true when the caller should read
+  // input (fd was readable, or a signal).
+  bool wait(int fd);
+  // Runs due timers without sleeping (headless loops).
+  void runDue();
+
+  // ms until the next timer, -1 if there is none.
+  int nextTimeoutMs() const;
+
+  uint64_t wakeups() const { return wakes; }
+
+private:
+  struct Timer {
+    TimerId id;
+    uint64_t tick;     // due tick
+    uint32_t period;   // ticks, 0 = one-shot
+    Callback cb;
+  };
+
+  std::vector<Timer> slots[kSlots];
+  std::unordered_map<TimerId, uint64_t> due;   // live timers -> due tick
+  std::vector<Timer> firing;                   // scratch for runDue()
+  struct Watch { int fd; Callback cb; };
+  std::vector<Watch> watches;
+  std::vector<pollfd> fds;                     // scratch for wait()
+  uint64_t cursor;       // last tick processed
+  TimerId nextId = 1;
+  uint64_t wakes = 0;
+
+  uint64_t nowTick() const;
+  TimerId schedule(uint32_t ms, uint32_t periodMs, Callback cb);
+  void insert(Timer t);
+};
@@ -0,0 +1,59 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "CombatResolver.h"
+
+// Exact fight odds: builds the per-hit damage distribution by convolving
+// the dice, then solves the fight as a Markov chain over (playerHP,
+// enemyHP, place in the turn order). The energy turn order repeats with a
+// short period (combat::turnCycle), so the chain stays small. No sampling
+// involved.
+
+// Discrete distribution: p[i] = P(X == lo + i).
+struct Pmf {
+  int lo = 0;
+  std::vector<double> p;
+
+  int hi() const { return lo + (int)p.size() - 1; }
+};
+
+Pmf constantPmf(int value);
+Pmf diePmf(int sides);                        // 1..sides, uniform
+Pmf convolve(const Pmf& a, const Pmf& b);     // distribution of A + B
+Pmf negate(const Pmf& a);                     // distribution of -A
+Pmf termPmf(const DiceTerm& term);           // one term, sign included
+Pmf planPmf(const DicePlan& plan);
+
+// Damage of one attack, with the max(1, ...) clamp from computeDamage.
+// Result index d holds P(dmg == d); index 0 is always 0.
+std::vector<double> damagePmf(const combat::Combatant& attacker,
+                              const combat::Combatant& defender);
+
+struct FightOdds {
+  double playerWin = 0.0;       // P(player wins)
+  double expectedTurns = 0.0;   // attacks made by both sides
+};
+
+class FightSolver {
+public:
+  // Damage PMFs are cached per (attacker, defender) loadout, so scoring
+  // many gear combinations only pays for the Markov solve.
+  FightOdds solve(const combat::Combatant& player, const combat::Combatant& enemy);
+
+  const std::vector<double>& cachedDamage(const combat::Combatant& attacker,
+                                          const combat::Combatant& defender);
+
+  size_t cacheSize() const { return cache.size(); }
+  void   clearCache() { cache.clear(); }
+
+private:
+  std::unordered_map<std::string, std::vector<double>> cache;
+
+  // reused between solves: one (PH+1) x (EH+1) table per turn-order step
+  std::vector<uint8_t> order;
+  std::vector<double> win, turns;
+};
+
+// One-off solve without caching.
+FightOdds solveFight(const combat::Combatant& player, const combat::Combatant& enemy);
@@ -0,0 +1,69 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Map.h"
+
+// Field of view with symmetric shadowcasting (Albert Ford's variant):
+// if A sees B then B sees A, so the same bits double as line-of-sight
+// checks for enemy AI.
+//
+// - visible: bitset over the (2r+1)^2 window around the viewer, rebuilt
+//   only when the viewer moves or the terrain version changes.
+// - explored: 1 bit per tile, stored per Map chunk and allocated only for
+//   chunks that have ever been seen.
+class Fov {
+public:
+  explicit Fov(const Map& map, int radius = 10);
+
+  // Recomputes if the viewer moved or the map changed. Returns true when
+  // the visible set was recomputed.
+  bool update(int vx, int vy);
+  void invalidate() { valid = false; }
+
+  bool isVisible(int x, int y) const {
+    const int lx = x - ox, ly = y - oy;
+    if ((unsigned)lx >= (unsigned)side || (unsigned)ly >= (unsigned)side) return false;
+    const size_t i = (size_t)ly * side + lx;
+    return (visible[i >> 6] >> (i & 63)) & 1u;
+  }
+  bool isExplored(int x, int y) const;
+
+  // Symmetric, so this is also "can (x,y) see the viewer".
+  bool viewerCanSee(int x, int y) const { return isVisible(x, y); }
+
+  // Explored memory as stored: chunk -> block index (-1 = none) and 16
+  // words per block. restoreExplored() takes the same pair back.
+  const std::vector<int32_t>&  exploredIndex() const { return exploredIdx; }
+  const std::vector<uint64_t>& exploredWords() const { return exploredBits; }
+  void restoreExplored(std::vector<int32_t> index, std::vector<uint64_t> words);
+  // Map chunks that gained explored bits since clearExploredDirty().
+  const std::vector<uint32_t>& dirtyExplored() const { return exploredDirty; }
+  void clearExploredDirty();
+
+  int radius() const { return r; }
+  // Bumped on every recompute; renderers compare it to detect changes.
+  uint64_t version() const { return ver; }
+
+private:
+  const Map& map;
+  int r, side;
+  int ox = 0, oy = 0;          // window origin
+  int vx = 0, vy = 0;          // viewer
+  uint64_t mapVersion = 0;
+  uint64_t ver = 0;
+  bool valid = false;
+
+  std::vector<uint64_t> visible;            // side*side bits
+  std::vector<int32_t>  exploredIdx;        // per map chunk, -1 = none
+  std::vector<uint64_t> exploredBits;       // 16 words per allocated chunk
+  std::vector<uint8_t>  exploredFlag;       // per map chunk: in exploredDirty
+  std::vector<uint32_t> exploredDirty;
+
+  struct Row { int depth; int startNum, startDen, endNum, endDen; };
+  std::vector<Row> stack;                   // reused scan stack
+
+  void compute();
+  void scanQuadrant(int q);
+  void reveal(int x, int y);
+  bool opaque(int x, int y) const { return !Map::walkable(map.getTile(x, y)); }
+};
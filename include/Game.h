@@ -1,44 +1,155 @@
 #pragma once
+#include <chrono>
+#include <memory>
 #include <string>
-#include <random>
+#include <vector>
 #include "Map.h"
+#include "MessageLog.h"
+#include "DungeonGenerator.h"
+#include "LevelFile.h"
 #include "Player.h"
 #include "Enemy.h"
 #include "NPC.h"
+#include "EntityStore.h"
+#include "Pathfinding.h"
+#include "Fov.h"
 #include "Ui.h"
 #include "CombatSystem.h"
 #include "DialogueSystem.h"
+#include "Rng.h"
+#include "SaveGame.h"
+#include "Input.h"
+#include "EventLoop.h"
+#include "GameOptions.h"
+#include "AreaStreamer.h"
+#include "Profiler.h"
+#include "TurnScheduler.h"
+#include "JobSystem.h"
 
 class Game {
 public:
-  Game();
+  // level == nullptr: generate a dungeon from opts.seed; otherwise play
+  // the loaded level. Keys come from `input`; when it replays a log the
+  // game runs headless (no ncurses at all) and stops at the log's end.
+  // Frames go to `screen` when given (a server session's AnsiRenderer);
+  // otherwise the game sets up ncurses and draws with the backend named
+  // by opts.renderer.
+  Game(const GameOptions& opts, Input& input, Level* level = nullptr,
+       std::unique_ptr<Renderer> screen = nullptr);
   ~Game();
   void run();
 
+  // One pass of run() without the sleep: waiting keys, tasks, at most one
+  // frame. False once the game is over. For loops that do their own
+  // waiting (GameServer), together with the two below.
+  bool tick();
+  int nextTimeoutMs() const { return loop.nextTimeoutMs(); }   // -1 = no timer
+  void runTimers() { loop.runDue(); }
+
+  static uint64_t clockSeed();
+  // One line describing the end state (replay regression checks).
+  std::string summary() const;
+
+  // Autosave to `path` every few seconds of play and on quit
+  // (full snapshot first, then deltas; written in the background).
+  void autosaveTo(const std::string& path);
+  // After run(): why the save file lacks the final state ("" if it has it).
+  std::string saveError() const;
+  // Continue a loaded save (construct with the save's map as the level).
+  void restore(SaveState& st);
+
 private:
-  // world & actors
-  Map map;
+  // world & actors (the dungeon is generated from `seed`)
+  uint64_t seed;
+  DungeonLayout layout; // rooms + spawn point, filled while `map` is built
+  std::vector<LevelSpawn> spawns;  // from a level file (empty when generated)
+  Map map;              // the current level; the others wait in `levels`
   Player player;
-  Enemy enemy;
-  NPC npc;
+  EntityStore actors;   // enemies + NPCs
+  EntityHandle foe;     // enemy shown in the HUD (last one engaged)
+
+  static constexpr int kAggroRange = 8;   // enemies chase within this path distance
+  static constexpr int kPrefetchRange = 12;   // start building the next level this close to stairs
+
+  // other levels: built ahead on a worker thread, cached while left
+  AreaStreamer levels;
+  int depth = 0;
+  int pendingDepth = -1;   // took the stairs; waiting for that level to be built
+
+  static constexpr int kSightRadius = 10;
+
+  FlowField chase;                   // toward the player, shared by all enemies
+  Fov fov;                           // what the player sees (and who sees them)
+
+  // the world turn fans out over these; the outcome is the same on any
+  // number of threads (see moveEnemies)
+  JobSystem jobs;
+  JobGraph sight;                    // FOV and flow field, side by side
+  std::vector<uint32_t> nearby;      // aggro scan candidates (dense indices)
+
+  // turn order on the map: the player (always "acting" while the game
+  // waits for a key) and the enemies that are after them (slot + 1)
+  TurnScheduler schedule;
+  static constexpr TurnScheduler::ActorId kPlayerActor = 0;
 
   // game state
   bool running = true;
-  std::string lastMessage;
-
-  // rng FIRST (so it's constructed before CombatSystem references it)
-  std::mt19937 rng;
-  std::uniform_int_distribution<int> d6;
+  bool headless;
+  bool remote;          // keys and screen belong to a server session
+  bool tracing;         // --profile: keep the profiler on for the whole run
+  uint64_t turns = 0;   // player moves/attacks/talks
+  MessageLog log;       // shown in the message box
 
-  // systems AFTER rng
+  Rng rng;
+  Input& input;
   Ui ui;                 // windows + rendering
-  CombatSystem combat;   // turn-based dice combat
-  DialogueSystem dialog; // npc dialogue
+
+  // fights and conversations in progress, in start order; the first one
+  // waiting for a key is in front: it gets the next key, and its enemy
+  // is the one on screen
+  std::vector<std::unique_ptr<Task>> tasks;
+
+  // main loop: sleeps until a key or a timer, draws only after changes
+  EventLoop loop;
+  bool redraw = true;
+  EventLoop::TimerId saveTimer = 0, overlayTimer = 0;
+
+  // persistence
+  static constexpr std::chrono::seconds kAutosaveEvery{5};
+  std::unique_ptr<SaveWriter> saver;
+  std::chrono::steady_clock::time_point lastSave;
+  bool unsaved = false;   // a turn was played since the last save
+  SaveView saveView();
+  void autosave(bool force);
+  void scheduleAutosave();
 
   // setup
-  void spawnEnemy();
+  void initTerminal();
+  void spawnEnemies();
   void spawnNPC();
+  static Map takeMap(Level* level, uint64_t seed, const std::vector<LevelSpawn>& spawns,
+                     DungeonLayout& layout);
 
   // input helpers
+  void handleKey(int ch);
+  void toggleProfile();
   bool tryMovePlayer(int dx, int dy);
+  void fight(EntityHandle who, bool advance = false, int ax = 0, int ay = 0);
+
+  // levels
+  void useStairs(int step);
+  void finishStairs();
+  void enterArea(std::unique_ptr<Area> next);
+  void prefetchStairs();
+
+  // tasks
+  Task* front() const;
+  bool acceptsKeys() const;
+  bool engaged(EntityHandle h) const;
+  void pumpTasks();
+
+  // world turn
+  void resetSchedule();
+  void moveEnemies();
+  bool enemyTurn(EntityHandle h);
 };
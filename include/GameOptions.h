@@ -0,0 +1,20 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// Command-line settings for one session (see main.cpp for the flags).
+struct GameOptions {
+  uint64_t seed = 0;          // 0 = from the clock
+  std::string levelPath;      // .twlv level instead of a generated dungeon
+  std::string savePath;       // autosave target
+  std::string loadPath;       // save to continue
+  std::string recordPath;     // input log to write
+  std::string replayPath;     // input log to play back (headless)
+  std::string profilePath;    // Chrome trace to write on exit
+  std::string itemsPath;      // item definitions (default: data/items.ini if present)
+  unsigned threads = 2;       // job system threads for the world turn (0 = all cores)
+  std::string renderer = "ncurses";   // or "ansi": frames written straight to the terminal
+};
+
+// Parses argv; on error fills `err` and returns false.
+bool parseGameOptions(int argc, char** argv, GameOptions& out, std::string& err);
@@ -0,0 +1,86 @@
+#pragma once
+#include <csignal>
+#include <cstdint>
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+
+// Many independent games in one process, played over a Unix socket.
+//
+// Every connection is a session with its own Game (dungeon, actors, RNG),
+// an Input fed from the socket, and an AnsiRenderer that appends each
+// frame straight to the client's outbox. One thread multiplexes all of
+// them with epoll. A session only runs when its client sent something or
+// one of its timers (combat pauses) is due, so an idle session costs its
+// memory and nothing else.
+//
+// The client sends raw terminal bytes and gets terminal output back, so
+// `socat -,raw,echo=0 UNIX-CONNECT:PATH` works as a client. Two escape
+// sequences are handled by the server itself:
+//   ESC [ 8 ; rows ; cols t   the client's window size (default 80x24)
+//   ESC [ 5 n                 status request, answered with ESC [ 0 n once
+//                             everything sent before it is handled and
+//                             drawn (twindisseia-loadgen times these)
+
+struct ServerConfig {
+  std::string socketPath;
+  uint64_t seed = 0;            // session n plays seed + n (0 = from the clock)
+  size_t maxSessions = 20000;   // further connections are closed at once
+};
+
+struct ServerStats {
+  uint64_t accepted = 0, refused = 0, closed = 0;
+  size_t peak = 0;              // most sessions open at once
+  uint64_t bytesIn = 0, bytesOut = 0;
+  uint64_t pumps = 0;           // times a session ran
+};
+
+class GameServer {
+public:
+  explicit GameServer(const ServerConfig& cfg);
+  ~GameServer();
+  GameServer(const GameServer&) = delete;
+  GameServer& operator=(const GameServer&) = delete;
+
+  // Binds and listens (replacing a stale socket file).
+  bool listen(std::string& err);
+  // Serves until stop(); false on a fatal error.
+  bool run(std::string& err);
+  // Safe to call from a signal handler (installed without SA_RESTART, so
+  // the wait returns at once).
+  void stop() { stopping = 1; }
+
+  size_t sessions() const { return open; }
+  const ServerStats& stats() const { return st; }
+
+private:
+  struct Session;
+  struct Due {
+    uint64_t at;       // steady ms
+    int fd;
+    uint64_t serial;   // fds are reused; this is not
+    bool operator>(const Due& o) const { return at > o.at; }
+  };
+
+  static constexpr size_t kMaxBacklog = size_t(4) << 20;   // unsent bytes before a client is dropped
+
+  ServerConfig cfg;
+  ServerStats st;
+  int listenFd = -1, epollFd = -1;
+  std::vector<std::unique_ptr<Session>> byFd;
+  size_t open = 0;
+  uint64_t serials = 0;
+  std::priority_queue<Due, std::vector<Due>, std::greater<Due>> timers;
+  volatile std::sig_atomic_t stopping = 0;
+
+  void acceptAll();
+  void readFrom(Session& s);
+  void pump(Session& s);
+  void flush(Session& s);
+  void finish(Session& s);
+  void close(Session& s);
+  void watchWrites(Session& s, bool on);
+  void runDueTimers();
+  int waitMs() const;
+};
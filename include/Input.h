@@ -0,0 +1,75 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Where keys come from: the ncurses keyboard, optionally recorded to a
+// log, a recorded log played back without any terminal at all, or keys
+// pushed by a server session for its remote client.
+//
+// Log format (text): a "twindisseia-replay 1" line, "seed N", "level PATH"
+// ("-" for a generated dungeon), then one "<ms> <key>" line per key read,
+// with ms counted from the start of the session and key the getch() code.
+// A finished recording ends with "end <summary>" (Game::summary()), which
+// playback compares against to catch behaviour changes.
+// Every key the game consumes is logged, including the "press any key"
+// waits in combat and dialogue, so playback follows the same path. Keys
+// thrown away by discardPending() are never read, so never logged.
+class Input {
+public:
+  Input() = default;
+  ~Input();
+
+  Input(const Input&) = delete;
+  Input& operator=(const Input&) = delete;
+
+  // Start logging every key read from the keyboard.
+  bool record(const std::string& path, uint64_t seed, const std::string& level,
+              std::string& err);
+  // Replace the keyboard with a recorded log (headless; no ncurses calls).
+  bool replay(const std::string& path, uint64_t& seed, std::string& level,
+              std::string& err);
+  // Recording: write the closing summary line.
+  void finish(const std::string& summary);
+  // Playback: summary the recording ended with ("" if it has none).
+  const std::string& expectedSummary() const { return expected; }
+
+  // Replace the keyboard with keys handed over by push() (server sessions;
+  // the caller owns the terminal, so no ncurses input calls).
+  void useRemote() { remote = true; }
+  void push(int key) { pushed.push_back(key); }
+
+  // Main loop: next pending key, or ERR right away if there is none.
+  // During replay, ERR means the log is used up (see exhausted()).
+  int poll();
+  // Drops typed-ahead keys, so a "press any key" prompt needs a fresh
+  // press (no-op during replay: the log has no such keys).
+  void discardPending();
+
+  bool replaying() const { return playback; }
+  bool remoteKeys() const { return remote; }
+  bool exhausted() const { return playback && pos >= events.size(); }
+  size_t keysRead() const { return reads; }
+
+private:
+  struct Event { uint32_t ms; int key; };
+
+  bool playback = false;
+  std::vector<Event> events;
+  size_t pos = 0;
+  size_t reads = 0;
+  std::string expected;
+
+  bool remote = false;
+  std::vector<int> pushed;   // remote keys, oldest first
+  size_t pushedPos = 0;
+
+  FILE* log = nullptr;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  int next();          // replay: pop one key (ERR when done)
+  int nextPushed();    // remote: pop one key (ERR when none)
+  int note(int key);   // record: log a real key, pass it through
+};
@@ -0,0 +1,69 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include "Equipment.h"
+
+// Item definitions, loaded once at startup.
+//
+// Every item lives exactly once in a flat table and is named by a small
+// ItemId; players, enemies and saves store ids, never Equipment copies.
+// load() replaces the table and so must run before any id is handed out
+// (it refuses afterwards). From then on definitions are immutable and the
+// table only grows, so an id (and a reference from get()) stays valid for
+// the whole run.
+//
+// Items and starting loadouts come from a text file (data/items.ini):
+//
+//   [item Chest Plate]       one section per item, named by the header
+//   slot = chest             weapon | helmet | chest | boots
+//   attack = 1d8             extra damage dice, e.g. 2d4+1 or 4d6kh3
+//   defense = 1d4            damage reduction dice (see DicePlan.h)
+//   flat = 1                 flat damage reduction
+//   speed = 2                speed bonus
+//
+//   [loadout player]         what an actor starts with, slot = item name
+//   weapon = Sword
+//
+// '#' starts a comment. The same defaults are built in, so the game runs
+// without the file.
+
+using ItemId = uint16_t;
+constexpr ItemId kNoItem = UINT16_MAX;
+
+struct Loadout {
+  ItemId weapon = kNoItem, helmet = kNoItem, chest = kNoItem, boots = kNoItem;
+};
+
+class ItemRegistry {
+public:
+  // The table everything reads from; starts with the built-in items.
+  static ItemRegistry& global();
+
+  ItemRegistry() = default;
+
+  // Replaces the definitions with those in `path` / `text`. On error, or
+  // once find(), intern() or loadout() has been called, the registry is
+  // left unchanged.
+  bool load(const std::string& path, std::string& err);
+  bool parse(const std::string& text, const std::string& source, std::string& err);
+
+  const Equipment& get(ItemId id) const { return id < items.size() ? items[id] : none; }
+  ItemId find(const std::string& name) const;
+  // Id of the item called e.name, adding `e` if there is none yet (custom
+  // items from the tools, items from an older save). kNoItem for an empty
+  // item or a full table.
+  ItemId intern(const Equipment& e);
+  size_t size() const { return items.size(); }
+
+  // Named starting gear ("player", "enemy"); empty if not defined.
+  const Loadout& loadout(const std::string& name) const;
+
+private:
+  std::deque<Equipment> items;   // deque: growing never moves an entry
+  std::unordered_map<std::string, ItemId> byName;
+  std::unordered_map<std::string, Loadout> loadouts;
+  Equipment none{};
+  mutable bool inUse = false;    // ids have been handed out
+};
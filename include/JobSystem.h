@@ -0,0 +1,143 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Work-stealing job system.
+//
+// Every thread owns a deque of jobs: it pushes and pops at the bottom
+// (newest first, still warm in cache) while idle threads steal from the
+// top of the others (Chase-Lev, no locks). The thread that created the
+// system is thread 0 and works too: run() and parallelFor() only return
+// once their jobs are done, and the caller executes jobs while it waits.
+// Jobs may start nested work the same way; other threads must not (they
+// would share deque 0). Idle workers spin briefly and then sleep until
+// something is pushed.
+//
+// Results never depend on the thread count: parallelFor() cuts [0, n)
+// into chunks from n and the grain alone, and parallelReduce() merges the
+// per-chunk results in chunk order on the calling thread. With one thread
+// (or one chunk) everything runs inline, in order, and a single-thread
+// system has no deques at all (server sessions each own one).
+//
+// No ncurses, so the headless tools use it too.
+
+class JobGraph;
+
+class JobSystem {
+public:
+  // threads includes the caller; 0 = all cores.
+  explicit JobSystem(unsigned threads = 0);
+  ~JobSystem();
+  JobSystem(const JobSystem&) = delete;
+  JobSystem& operator=(const JobSystem&) = delete;
+
+  unsigned threads() const { return count; }
+
+  // Runs every node of `g`, each after the nodes it was added after.
+  void run(JobGraph& g);
+
+  // body(begin, end) over chunks of at most `grain` indices.
+  template <class F>
+  void parallelFor(size_t n, size_t grain, F&& body) {
+    if (grain == 0) grain = 1;
+    const size_t chunks = (n + grain - 1) / grain;
+    if (chunks <= 1 || threads() == 1) {
+      for (size_t b = 0; b < n; b += grain) body(b, b + grain < n ? b + grain : n);
+      return;
+    }
+    using Body = std::remove_reference_t<F>;
+    forChunks(n, grain, &body, [](void* ctx, size_t b, size_t e) { (*(Body*)ctx)(b, e); });
+  }
+
+  // chunk(begin, end) -> T for every chunk, then merge(acc, part) in
+  // chunk order starting from `init`.
+  template <class T, class F, class M>
+  T parallelReduce(size_t n, size_t grain, T init, F&& chunk, M&& merge) {
+    if (grain == 0) grain = 1;
+    std::vector<T> parts((n + grain - 1) / grain);
+    parallelFor(n, grain, [&](size_t b, size_t e) { parts[b / grain] = chunk(b, e); });
+    for (T& p : parts) merge(init, p);
+    return init;
+  }
+
+  uint64_t steals() const { return stolen.load(std::memory_order_relaxed); }
+
+private:
+  friend class JobGraph;
+
+  struct Job {
+    void (*fn)(void* ctx, size_t begin, size_t end) = nullptr;
+    void* ctx = nullptr;
+    size_t begin = 0, end = 0;
+    std::atomic<uint32_t> waiting{0};    // unfinished prerequisites
+    Job* const* next = nullptr;          // dependents
+    uint32_t nextCount = 0;
+    std::atomic<size_t>* left = nullptr; // the batch's unfinished jobs
+  };
+
+  // Chase-Lev deque over a fixed ring; push() fails when it is full and
+  // the job then runs inline.
+  struct Deque {
+    static constexpr int64_t kSize = 4096;   // power of two
+    alignas(64) std::atomic<int64_t> top{0};
+    alignas(64) std::atomic<int64_t> bottom{0};
+    std::atomic<Job*> ring[kSize];
+
+    bool push(Job* j);   // owner
+    Job* pop();          // owner
+    Job* steal();        // anyone
+  };
+
+  unsigned count = 1;
+  std::vector<std::unique_ptr<Deque>> deques;   // [0] = the owner; none with one thread
+  std::vector<std::thread> workers;
+
+  std::mutex sleepMutex;
+  std::condition_variable wake;
+  std::atomic<size_t> queued{0};     // pushed and not yet taken
+  std::atomic<unsigned> sleepers{0};
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> stolen{0};
+
+  unsigned self() const;
+  void submit(Job* j, bool notifyAll = false);
+  void execute(Job* j);
+  Job* find(unsigned me);
+  void helpUntil(const std::atomic<size_t>& left);
+  void workerLoop(unsigned me);
+  void forChunks(size_t n, size_t grain, void* ctx, void (*fn)(void*, size_t, size_t));
+};
+
+// A fixed set of jobs with dependencies, built once and run as often as
+// needed (e.g. once per turn). A node can only wait for nodes added
+// before it, so there are no cycles.
+class JobGraph {
+public:
+  using NodeId = uint32_t;
+
+  NodeId add(std::function<void()> fn, std::initializer_list<NodeId> after = {});
+  size_t size() const { return nodes.size(); }
+
+private:
+  friend class JobSystem;
+  struct Node {
+    std::function<void()> fn;
+    std::vector<NodeId> next;
+    uint32_t deps = 0;
+  };
+  std::vector<Node> nodes;
+
+  // built on the first run after a change
+  std::unique_ptr<JobSystem::Job[]> jobs;
+  std::vector<JobSystem::Job*> edges;
+  bool built = false;
+};
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Map.h"
+
+// Binary level files (.twlv), opened with mmap and read in place.
+//
+// Layout (little-endian):
+//   header        magic "TWLV", version, size, counts, section offsets,
+//                 a checksum over header + directory + spawns, and a
+//                 separate checksum over the chunk data
+//   directory     one uint32 per chunk position: stored chunk index or
+//                 kNoChunk for all-Void chunks
+//   spawns        LevelSpawn records
+//   chunk data    page-aligned array of Map::Chunk (tile plane + walk bits)
+//
+// Chunk records have exactly the in-memory Map::Chunk layout, so loading
+// just points the map's directory into the mapping: nothing is parsed and
+// pages are read from disk only when a chunk is first touched. The mapping
+// is private, so editing a loaded map copies the touched page and never
+// writes back to the file. Only the cheap header checksum is checked on
+// load; verifyLevel() also checks the chunk data.
+
+struct LevelSpawn {
+  enum Kind : uint8_t { Player = 0, Enemy = 1, NPC = 2 };
+  uint8_t kind = Player;
+  uint8_t reserved[3] = {0, 0, 0};
+  int32_t x = 0, y = 0;
+};
+
+struct Level {
+  Map map{0, 0, false};
+  std::vector<LevelSpawn> spawns;
+};
+
+bool saveLevel(const std::string& path, const Map& map,
+               const std::vector<LevelSpawn>& spawns, std::string& err);
+bool loadLevel(const std::string& path, Level& out, std::string& err);
+bool verifyLevel(const std::string& path, std::string& err);
+
+// Text layout: '#' wall, '.' floor, ' ' void, '@' player, 'g' enemy and
+// 'N' NPC (all three stand on floor). Ragged lines are padded with void.
+bool parseAsciiLevel(const std::string& text, Level& out, std::string& err);
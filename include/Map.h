@@ -1,25 +1,126 @@
 #ifndef MAP_H
 #define MAP_H
 
+#include <cstdint>
+#include <memory>
 #include <vector>
-#include <string>
 #include <ncurses.h>
 
-class Map {
-private:
-    int width, height;
-    std::vector<std::string> grid;
+enum class Tile : uint8_t { Void = 0, Floor, Wall, StairsDown, StairsUp };
 
+// Tile grid stored as 32x32 chunks. Each chunk keeps a tile-type byte plane
+// and a walkability bitset. Chunks are allocated only once something is
+// written into them; untouched areas share one static all-Void chunk, so a
+// sparse 10k x 10k map costs little more than its chunk directory.
+// Chunks can also live in external memory (a memory-mapped level file, see
+// LevelFile.h); the map then only holds a reference that keeps it alive.
+class Map {
 public:
-    Map(int w = 20, int h = 10);
+    static constexpr int kChunkShift = 5;
+    static constexpr int kChunkSize  = 1 << kChunkShift;       // 32
+    static constexpr int kChunkMask  = kChunkSize - 1;
+    static constexpr int kChunkTiles = kChunkSize * kChunkSize; // 1024
+
+    struct Chunk {
+        uint8_t  tiles[kChunkTiles];        // Tile values, row-major
+        uint64_t walk[kChunkTiles / 64];    // 1 bit per tile
+    };
+
+    // bordered = true: floor room with a wall border (the classic map).
+    // bordered = false: all Void, no chunks allocated.
+    Map(int w = 20, int h = 10, bool bordered = true);
 
-    // Draw the map rows into a target window.
-    // Renders up to the window's size (no overflow).
-    void drawTo(WINDOW* win) const;
+    Map(Map&&) = default;
+    Map& operator=(Map&&) = default;
+
+    // Draw the map into a target window, with (originX, originY) at the
+    // window's top-left. Renders up to the window's size (no overflow).
+    void drawTo(WINDOW* win, int originX = 0, int originY = 0) const;
+
+    // Top-left map coordinate that centres `center` in a view of `viewSize`,
+    // clamped so the view never scrolls past the map edges.
+    static int viewOrigin(int center, int mapSize, int viewSize);
+
+    bool isWalkable(int x, int y) const {
+        if (((unsigned)x >= (unsigned)width) | ((unsigned)y >= (unsigned)height))
+            return false;
+        const Chunk* c = dir[(y >> kChunkShift) * chunksX + (x >> kChunkShift)];
+        const int i = ((y & kChunkMask) << kChunkShift) | (x & kChunkMask);
+        return (c->walk[i >> 6] >> (i & 63)) & 1u;
+    }
+
+    Tile getTile(int x, int y) const;
+    void setTile(int x, int y, Tile t);
+    void fillRect(int x0, int y0, int w, int h, Tile t);
+
+    static char glyph(Tile t);
+    static bool walkable(Tile t) {
+        return t == Tile::Floor || t == Tile::StairsDown || t == Tile::StairsUp;
+    }
 
-    bool isWalkable(int x, int y) const;
     int getWidth()  const;
     int getHeight() const;
+
+    // Bumped on every terrain change; lets renderers skip unchanged frames.
+    uint64_t version() const { return ver; }
+
+    size_t chunkCount()  const { return store.size() + attached; }
+    size_t memoryBytes() const;   // heap only; attached chunks not counted
+
+    // --- raw chunk access (level files) ---
+    int chunksAcross() const { return chunksX; }
+    int chunksDown()   const { return chunksY; }
+    // nullptr for chunks that were never written (all Void)
+    const Chunk* chunkAt(int cx, int cy) const {
+        const Chunk* c = dir[(size_t)cy * chunksX + cx];
+        return c == &emptyChunk ? nullptr : c;
+    }
+
+    // Overwrites a whole chunk (snapshot loading). Counts as an edit.
+    void writeChunk(int cx, int cy, const Chunk& data);
+
+    // Points the directory at chunks owned elsewhere; `chunks` is indexed
+    // like the directory, nullptr = Void. `backing` keeps their memory alive.
+    // The memory must be writable (a private mapping gives copy-on-write).
+    void attachChunks(const std::vector<Chunk*>& chunks, std::shared_ptr<void> backing);
+
+    // Chunks whose tiles changed since the last clearDirty() (directory
+    // indices, each listed once). Used for incremental saves.
+    const std::vector<uint32_t>& dirtyChunks() const { return dirtyList; }
+    void clearDirty();
+
+    // Chunks changed since markPristine() (directory indices, each listed
+    // once): what sets a level apart from the one its seed generates.
+    // Attached chunks count as edited, since they come from a file.
+    const std::vector<uint32_t>& editedChunks() const { return editedList; }
+    void markPristine();
+    // Replaces the edited set with the chunks whose tiles differ from
+    // `base` (every chunk if the sizes differ).
+    void markEditsAgainst(const Map& base);
+
+    // Hint that the chunks covering this rectangle will be read soon
+    // (starts paging them in for attached storage; no-op otherwise).
+    void prefetch(int x0, int y0, int w, int h) const;
+
+private:
+    int width, height;
+    int chunksX, chunksY;
+    uint64_t ver = 0;
+    std::vector<Chunk*> dir;                    // chunksX * chunksY
+    std::vector<std::unique_ptr<Chunk>> store;  // allocated chunks only
+    std::shared_ptr<void> backing;              // external chunk memory
+    size_t attached = 0;
+    std::vector<uint8_t>  dirtyFlag;            // per directory entry
+    std::vector<uint32_t> dirtyList;
+    std::vector<uint8_t>  editedFlag;           // per directory entry
+    std::vector<uint32_t> editedList;
+
+    static const Chunk emptyChunk;
+
+    Chunk* chunkForWrite(int cx, int cy);
+    void markEdited(size_t ci) {
+        if (!editedFlag[ci]) { editedFlag[ci] = 1; editedList.push_back((uint32_t)ci); }
+    }
 };
 
 #endif
@@ -0,0 +1,97 @@
+#pragma once
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// What a log entry says; each id has one text template (MessageLog.cpp).
+enum class MsgId : uint16_t {
+  Text,            // {s}
+  Welcome,
+  CombatYouFirst,
+  CombatEnemyFirst,
+  YouRoll,
+  EnemyRolls,
+  YouHit,          // d6, atk, weapon, def, flat, armor, dmg
+  EnemyHits,       // same
+  YouDied,
+  Victory,
+  NpcSays,         // {s}
+  TalkDone,
+  StairsDown,      // depth
+  StairsUp,        // depth
+  StairsWait,
+  NoStairs,
+};
+
+// One message, stored as a template id plus its numbers. A string
+// argument ({s}) is an id into the log's interned string table.
+struct LogEntry {
+  static constexpr int kMaxArgs = 8;
+  static constexpr uint32_t kNoStr = UINT32_MAX;
+
+  MsgId    id = MsgId::Text;
+  uint8_t  argc = 0;
+  bool     transient = false;   // replaced by the next entry (progress lines)
+  uint32_t str = kNoStr;
+  int32_t  args[kMaxArgs] = {};
+};
+
+// Fixed-capacity message history.
+//
+// Entries live in a ring of kCapacity slots; the oldest is overwritten.
+// Text is formatted the first time an entry is shown, and its wrapped
+// lines are cached per slot until the width changes (a resize), so
+// redrawing the log neither formats nor wraps again. Slot buffers are
+// reserved up front, and repeated strings (NPC lines) are interned once,
+// so steady play does not allocate.
+class MessageLog {
+public:
+  static constexpr size_t kCapacity = 256;
+  static constexpr int kMaxLines = 24;   // wrapped lines kept per entry
+
+  struct Span { uint16_t off = 0, len = 0; };   // one line of an entry's text
+
+  MessageLog();
+
+  void push(MsgId id, std::initializer_list<int> args = {}, bool transient = false);
+  void push(MsgId id, const std::string& s);   // {s} templates
+
+  size_t size() const { return count; }
+  const LogEntry& at(size_t i) const { return slot(i).e; }   // 0 = oldest held
+  // Changes whenever the contents do (dirty tracking for the UI).
+  uint64_t version() const { return changes; }
+  void clear();
+
+  // Entry i as text, formatted on first use.
+  const std::string& text(size_t i) const;
+  // Entry i word-wrapped to `width` columns; returns the line count and
+  // points `lines` at spans into text(i).
+  int wrap(size_t i, int width, const Span*& lines) const;
+
+  // Word-wraps text[0, n) into at most `max` spans of <= width columns.
+  static int wrapSpans(const char* text, size_t n, int width, Span* out, int max);
+
+private:
+  struct Slot {
+    LogEntry e;
+    std::string text;
+    bool formatted = false;
+    int width = -1;            // width the spans were made for
+    int lineCount = 0;
+    Span lines[kMaxLines];
+  };
+
+  mutable std::vector<Slot> ring;
+  size_t head = 0;    // next slot to write
+  size_t count = 0;
+  uint64_t changes = 0;
+
+  std::vector<std::string> strings;
+  std::unordered_map<std::string, uint32_t> stringIds;
+
+  Slot& slot(size_t i) const { return ring[(head + kCapacity - count + i) % kCapacity]; }
+  void store(const LogEntry& e);
+  void format(const LogEntry& e, std::string& out) const;
+};
@@ -0,0 +1,30 @@
+#pragma once
+#include <vector>
+#include <ncurses.h>
+#include "Renderer.h"
+
+// The ncurses backend: one WINDOW per panel on the current SCREEN,
+// touch() is wnoutrefresh() and present() is doupdate(). Colors are used
+// only when the terminal has them.
+class NcursesRenderer : public Renderer {
+public:
+  NcursesRenderer() = default;
+  ~NcursesRenderer() override;
+  NcursesRenderer(const NcursesRenderer&) = delete;
+  NcursesRenderer& operator=(const NcursesRenderer&) = delete;
+
+  void measure(int& rows, int& cols) override;
+  void place(Panel p, int y, int x, int h, int w) override;
+  void clear(Panel p) override;
+  void text(Panel p, int y, int x, const char* s, int n, uint8_t style) override;
+  void cells(Panel p, int y, int x, const Cell* c, int n) override;
+  void box(Panel p) override;
+  void touch(Panel p) override;
+  void present() override;
+
+private:
+  WINDOW* win[kPanels] = {};
+  std::vector<chtype> row;   // cells() scratch
+
+  static chtype attrOf(uint8_t style);
+};
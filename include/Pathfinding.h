@@ -0,0 +1,92 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Map.h"
+
+// Grid pathfinding on top of Map::isWalkable (4-connected, unit cost).
+
+struct PathPoint { int x, y; };
+
+// Single-agent A*. All search memory (node table + open heap) is an arena
+// owned by the Pathfinder and reused between queries: after the first
+// query of a given size, findPath() does not allocate. Node lookups go
+// through an open-addressing table, so the cost depends on the nodes
+// explored, not on the map size.
+class Pathfinder {
+public:
+  explicit Pathfinder(const Map& map, int maxNodes = 1 << 16);
+
+  // Fills `out` with the steps from (sx,sy) (excluded) to (tx,ty)
+  // (included). Returns false if the goal is unreachable or the search
+  // exceeds maxNodes; `out` is then empty.
+  bool findPath(int sx, int sy, int tx, int ty, std::vector<PathPoint>& out);
+
+  int lastExpanded() const { return expanded; }
+
+private:
+  struct Node {
+    uint64_t tile;     // y * width + x
+    uint32_t g;
+    uint32_t parent;   // node index, UINT32_MAX for the start
+    uint32_t stamp;    // == curStamp when the node belongs to this query
+    bool     closed;
+  };
+  struct OpenItem {
+    uint32_t f, g, node;
+  };
+
+  const Map& map;
+  int maxNodes;
+  std::vector<Node> nodes;        // open-addressing table, power-of-two size
+  std::vector<OpenItem> open;     // binary heap (lazy decrease-key)
+  uint32_t curStamp = 0;
+  uint32_t used = 0;
+  int expanded = 0;
+
+  uint32_t lookup(uint64_t tile, bool& fresh);
+};
+
+// Distance field toward a single target (usually the player), computed
+// with a breadth-first Dijkstra over a square window around the target.
+// Each cell stores the step that leads one tile closer, so moving any
+// number of agents costs one table lookup each. The field is rebuilt only
+// when the target moves or the terrain changes.
+class FlowField {
+public:
+  static constexpr uint32_t kUnreached = UINT32_MAX;
+
+  explicit FlowField(const Map& map, int radius = 32);
+
+  // Returns true if the field had to be rebuilt.
+  bool update(int tx, int ty);
+  void invalidate() { valid = false; }
+
+  // Step toward the target from (x,y); false outside the window, on the
+  // target itself or where the target cannot be reached.
+  bool step(int x, int y, int& dx, int& dy) const;
+  uint32_t distance(int x, int y) const;
+
+  int radius() const { return r; }
+  int rebuilds() const { return rebuildCount; }
+
+private:
+  const Map& map;
+  int r, side;
+  int ox = 0, oy = 0;         // window origin in map coordinates
+  int tx = 0, ty = 0;
+  uint64_t mapVersion = 0;
+  bool valid = false;
+  int rebuildCount = 0;
+
+  std::vector<uint32_t> dist; // side * side
+  std::vector<uint8_t>  dir;  // 0 none, 1..4 = up/down/left/right
+  std::vector<uint32_t> queue;
+
+  void rebuild();
+  bool inWindow(int x, int y, int& i) const {
+    const int lx = x - ox, ly = y - oy;
+    if ((unsigned)lx >= (unsigned)side || (unsigned)ly >= (unsigned)side) return false;
+    i = ly * side + lx;
+    return true;
+  }
+};
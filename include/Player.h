@@ -1,5 +1,5 @@
 #pragma once
-#include "Equipment.h"
+#include "ItemRegistry.h"
 
 class Player {
 private:
@@ -13,11 +13,11 @@ private:
     // current HP (separate from baseHP for future max HP handling)
     int hp;
 
-    // equipped gear
-    Equipment weapon; // Weapon
-    Equipment helmet; // Helmet
-    Equipment chest;  // Chest
-    Equipment boots;  // Boots
+    // equipped gear (ids into ItemRegistry)
+    ItemId weapon = kNoItem;
+    ItemId helmet = kNoItem;
+    ItemId chest  = kNoItem;
+    ItemId boots  = kNoItem;
 
 public:
     Player(int startX = 0, int startY = 0,
@@ -41,15 +41,21 @@ public:
     bool isAlive() const;
     void takeDamage(int dmg);
 
+    // raw values (snapshots)
+    int  getMaxHP() const     { return baseHP; }
+    int  getBaseSpeed() const { return baseSpeed; }
+    void setHP(int v)         { hp = v; }
+
     // gear access
-    const Equipment& getWeapon() const { return weapon; }
-    const Equipment& getHelmet() const { return helmet; }
-    const Equipment& getChest()  const { return chest;  }
-    const Equipment& getBoots()  const { return boots;  }
-
-    // equip setters (used in Game to give starting gear)
-    void setWeapon(const Equipment& e) { weapon = e; }
-    void setHelmet(const Equipment& e) { helmet = e; }
-    void setChest (const Equipment& e) { chest  = e; }
-    void setBoots (const Equipment& e) { boots  = e; }
+    const Equipment& getWeapon() const { return ItemRegistry::global().get(weapon); }
+    const Equipment& getHelmet() const { return ItemRegistry::global().get(helmet); }
+    const Equipment& getChest()  const { return ItemRegistry::global().get(chest);  }
+    const Equipment& getBoots()  const { return ItemRegistry::global().get(boots);  }
+    ItemId weaponId() const { return weapon; }
+    ItemId helmetId() const { return helmet; }
+    ItemId chestId()  const { return chest;  }
+    ItemId bootsId()  const { return boots;  }
+
+    // puts the item in its slot (kNoItem is ignored)
+    void equip(ItemId id);
 };
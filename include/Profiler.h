@@ -0,0 +1,72 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Built-in frame profiler.
+//
+// ProfileScope timers record trace events into a fixed ring. Any thread may
+// record: a slot is claimed with one fetch_add and published with a
+// sequence number, so there are no locks. The ring keeps the newest
+// kRingSize events, and writeTrace() dumps them as Chrome trace_event JSON
+// (open it in chrome://tracing or Perfetto). While disabled (the default)
+// a scope costs one relaxed atomic load.
+//
+// The profiler also collects frame times and input latency for the HUD
+// overlay. A frame is the work between two waits (EventLoop reports them
+// through idleBegin/idleEnd). It only counts if it read a key or drew
+// something. Input latency runs from the wakeup that delivered a
+// key to the present() that shows its effect. These samples are
+// main-thread only.
+
+struct ProfileSummary {
+  double frameP50Ms = 0, frameP99Ms = 0;
+  double inputP50Ms = 0, inputP99Ms = 0;
+  size_t frames = 0, inputs = 0;   // samples behind the percentiles
+};
+
+class Profiler {
+public:
+  static bool enabled() { return on.load(std::memory_order_relaxed); }
+  static void setEnabled(bool enable);
+
+  // Steady clock in ns since the process started.
+  static uint64_t now();
+  // `name` must outlive the profiler (a string literal).
+  static void record(const char* name, uint64_t startNs, uint64_t endNs);
+
+  // Main loop hooks (no-ops while disabled).
+  static void idleBegin();
+  static void idleEnd();
+  static void inputArrived();   // a key was read
+  static void presented();      // right after the frame is presented
+
+  // Percentiles over the last kSamples frames / inputs.
+  static ProfileSummary summary();
+  static uint64_t eventsRecorded();
+
+  // Writes the ring as Chrome trace JSON; `written` is the event count.
+  static bool writeTrace(const std::string& path, size_t& written, std::string& err);
+
+  static constexpr size_t kRingSize = size_t(1) << 16;   // power of two
+  static constexpr size_t kSamples = 256;
+
+private:
+  static inline std::atomic<bool> on{false};
+};
+
+// Times the enclosing block: ProfileScope scope("Ui::drawMap");
+class ProfileScope {
+public:
+  explicit ProfileScope(const char* name)
+  : name(Profiler::enabled() ? name : nullptr), start(this->name ? Profiler::now() : 0) {}
+  ~ProfileScope() { if (name) Profiler::record(name, start, Profiler::now()); }
+
+  ProfileScope(const ProfileScope&) = delete;
+  ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+  const char* name;
+  uint64_t start;
+};
@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+
+// Cell attributes. The low bits are a color, numbered like the ncurses
+// pairs Game sets up (0 = terminal default); the rest are flags.
+enum CellStyle : uint8_t {
+  kPlain = 0,
+  kRed = 1, kGreen = 2, kCyan = 3, kWhite = 5,
+  kColorBits = 7,
+  kBold = 8,
+  kDim = 16,
+  kReverse = 32,
+  kLineChars = 64,   // ch is a DEC line-drawing letter (box corners and edges)
+};
+
+struct Cell {
+  char ch = ' ';
+  uint8_t style = kPlain;
+  bool operator==(const Cell& o) const { return ch == o.ch && style == o.style; }
+  bool operator!=(const Cell& o) const { return !(*this == o); }
+};
+
+// Where Ui draws: four panels (rectangles of the terminal) that are
+// written cell by cell and shown together. NcursesRenderer puts each
+// panel in a WINDOW; AnsiRenderer keeps its own cell grids and writes
+// escape sequences itself.
+//
+// Coordinates are panel-relative, and anything past a panel's edge is
+// cut off. Changes show up only after touch() and present(), like
+// wnoutrefresh() and doupdate().
+class Renderer {
+public:
+  enum Panel { Hud, MapView, Side, Msg, kPanels };
+
+  virtual ~Renderer() = default;
+
+  // Terminal size in cells (a backend may notice a resize here).
+  virtual void measure(int& rows, int& cols) = 0;
+  // (Re)creates a panel; it starts out blank.
+  virtual void place(Panel p, int y, int x, int h, int w) = 0;
+
+  virtual void clear(Panel p) = 0;
+  virtual void text(Panel p, int y, int x, const char* s, int n, uint8_t style) = 0;
+  virtual void cells(Panel p, int y, int x, const Cell* c, int n) = 0;
+  // A line border around the panel's edge.
+  virtual void box(Panel p) = 0;
+
+  virtual void touch(Panel p) = 0;
+  virtual void present() = 0;
+};
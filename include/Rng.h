@@ -0,0 +1,105 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Small, fast random number generator (xoshiro256**).
+//
+// - 32 bytes of state, no hidden statics: every owner has its own stream,
+//   so it is safe to use one Rng per thread/entity.
+// - split(id) derives an independent child stream deterministically from
+//   (seed, stream path, id), e.g. one per worker thread or per entity.
+// - bounded()/uniform() are bias-free (Lemire's multiply + rejection),
+//   unlike `rng() % n`.
+// - Satisfies UniformRandomBitGenerator, so <random>/<algorithm> still work.
+class Rng {
+public:
+  using result_type = uint64_t;
+
+  explicit Rng(uint64_t seed = 1, uint64_t stream = 0);
+
+  void seed(uint64_t seed, uint64_t stream = 0);
+  uint64_t seedValue()   const { return seedKey; }
+  uint64_t streamValue() const { return streamKey; }
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return ~result_type(0); }
+
+  result_type operator()() {
+    const uint64_t result = rotl(s[1] * 5, 7) * 9;
+    const uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+  }
+
+  uint32_t next32() { return (uint32_t)((*this)() >> 32); }
+
+  // Child stream; same (seed, stream, id) always gives the same sequence.
+  Rng split(uint64_t id) const;
+
+  // Uniform in [0, n). n == 0 returns 0.
+  uint32_t bounded(uint32_t n) {
+    uint64_t m = (uint64_t)next32() * n;
+    uint32_t low = (uint32_t)m;
+    if (low < n) {
+      const uint32_t threshold = (uint32_t)(-n) % n;
+      while (low < threshold) {
+        m = (uint64_t)next32() * n;
+        low = (uint32_t)m;
+      }
+    }
+    return (uint32_t)(m >> 32);
+  }
+
+  // Uniform in [lo, hi].
+  int uniform(int lo, int hi) {
+    if (hi <= lo) return lo;
+    return lo + (int)bounded((uint32_t)(hi - lo) + 1u);
+  }
+
+  // Sum of `count` dice with `sides` faces (0 if either is <= 0).
+  int rollDice(int count, int sides) {
+    if (count <= 0 || sides <= 0) return 0;
+    int sum = count;
+    for (int i = 0; i < count; ++i) sum += (int)bounded((uint32_t)sides);
+    return sum;
+  }
+
+  // Raw state, for save games.
+  void getState(uint64_t out[4]) const { for (int i = 0; i < 4; ++i) out[i] = s[i]; }
+  void setState(const uint64_t in[4])  { for (int i = 0; i < 4; ++i) s[i] = in[i]; }
+
+private:
+  uint64_t s[4];
+  uint64_t seedKey = 0, streamKey = 0;
+
+  static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+};
+
+// Batched NdS rolling: four xoshiro256** lanes advanced together, with an
+// AVX2 path picked at runtime and a scalar path that produces the exact same
+// numbers. Seeded from a parent Rng, so it is as reproducible as the parent.
+class RngBatch {
+public:
+  explicit RngBatch(const Rng& parent);
+
+  // out[i] = sum of `count` d`sides` for i in [0, n).
+  void roll(int* out, size_t n, int count, int sides);
+
+  // Fills out[i] uniformly in [0, bound) (bound > 0).
+  void bounded(uint32_t* out, size_t n, uint32_t bound);
+
+  static bool usingSimd();
+
+private:
+  static constexpr int kLanes = 4;
+  alignas(32) uint64_t s[4][kLanes]; // s[word][lane]
+  Rng fallback;                      // rejection re-draws
+
+  void boundedScalar(uint32_t* out, size_t n, uint32_t bound);
+  void boundedAvx2(uint32_t* out, size_t n, uint32_t bound);
+};
@@ -0,0 +1,158 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "AreaStreamer.h"
+#include "EntityStore.h"
+#include "Fov.h"
+#include "Map.h"
+#include "MessageLog.h"
+#include "Player.h"
+#include "Rng.h"
+
+// Binary save games: a full snapshot followed by appended delta records.
+//
+// Every record is a small header (magic, version, kind, sequence number,
+// payload size, checksum) plus a payload of raw tables: game/RNG state,
+// the player, the item and dialogue tables, the entity slot table and dense
+// order, spatial index chains, entity records, map chunks and explored
+// bits, then the levels the player has left: for each one the chunks that
+// differ from what its seed generates, its entity tables and its explored
+// bits. A full record holds all of it. A delta holds the game state, the
+// player and only what changed since the previous record: new item and
+// dialogue entries (usually none), the slot and dense entries of spawned
+// and despawned entities, the index buckets they and movers touched, the
+// dirty entities and map chunks, and the chunks with newly explored
+// tiles, plus which left levels are still kept. Loading replays the full record and then each delta in order,
+// stopping at the first damaged one (e.g. a crash mid-append).
+//
+// Encoding is a handful of memcpys and runs on the caller's thread so it
+// sees a consistent state; file I/O happens on a background thread.
+
+// The live objects a snapshot reads from and restores into.
+struct SaveView {
+  Map& map;
+  Player& player;
+  EntityStore& actors;
+  EntityHandle& foe;
+  Rng& rng;
+  Fov& fov;
+  MessageLog& log;   // only the newest entry is saved, as text
+  uint64_t& seed;
+  int& depth;        // which level of the world `map` is
+  uint64_t& turns;   // player turns so far
+  AreaStreamer& levels;   // the levels left earlier
+};
+
+// A level the player left, as saved.
+struct SavedArea {
+  int depth = 0;
+  uint64_t lastUsed = 0;
+  int width = 0, height = 0;
+  std::vector<std::pair<uint32_t, Map::Chunk>> chunks;   // edited since generation
+  std::vector<std::vector<std::string>> dialogs;
+  std::vector<EntityStore::Slot> slots;
+  uint32_t freeHead = EntityStore::kFree;
+  std::vector<uint32_t> denseSlot;
+  std::map<uint64_t, std::vector<uint32_t>> chains;
+  std::vector<EntityStore::Record> records;   // in dense order
+  std::vector<int32_t>  exploredIdx;
+  std::vector<uint64_t> exploredBits;
+};
+
+// A decoded save, ready to be moved into a Game.
+struct SaveState {
+  uint64_t seed = 0;
+  int depth = 0;
+  uint64_t turns = 0;
+  uint64_t rngSeed = 0, rngStream = 0, rngState[4] = {0, 0, 0, 0};
+  EntityHandle foe;
+  std::string message;
+
+  Player player;
+  Map map{0, 0, false};
+
+  std::vector<Equipment> items;          // the saving run's item table
+  ItemId playerItems[4] = { kNoItem, kNoItem, kNoItem, kNoItem };
+  std::vector<std::vector<std::string>> dialogs;
+  std::vector<EntityStore::Slot> slots;
+  uint32_t freeHead = EntityStore::kFree;
+  std::vector<uint32_t> denseSlot;
+  std::map<uint64_t, std::vector<uint32_t>> chains;   // index bucket -> slots
+  std::vector<EntityStore::Record> bySlot;
+
+  std::vector<int32_t>  exploredIdx;
+  std::vector<uint64_t> exploredBits;
+
+  std::vector<SavedArea> areas;
+
+  int records = 0;   // full + deltas applied
+};
+
+// Item ids are matched to the current ItemRegistry by name; items it
+// lacks are added, and one it defines differently fails the load.
+bool loadSave(const std::string& path, SaveState& out, std::string& err);
+
+// Copies a loaded state into live objects (the map is moved separately,
+// since Game owns it by value) and hands the saved levels to `levels`.
+void restoreSave(SaveState& st, SaveView v);
+
+class SaveWriter {
+public:
+  explicit SaveWriter(std::string path);
+  ~SaveWriter();   // finishes queued writes
+
+  SaveWriter(const SaveWriter&) = delete;
+  SaveWriter& operator=(const SaveWriter&) = delete;
+
+  // Encodes a record now and queues it for writing. The first save (and
+  // every so often after, see kRebaseEvery, or after a failed write) is a
+  // full snapshot that replaces the file; the rest are appended deltas. Clears the dirty
+  // sets of the map, the entity store and the explored memory.
+  void save(SaveView v);
+
+  // Makes the next record a full snapshot (the map was swapped wholesale).
+  void rebase() { rebaseNext = true; }
+
+  // Blocks until everything queued so far is on disk.
+  void flush();
+
+  const std::string& path() const { return file; }
+  size_t lastRecordBytes() const { return lastBytes; }
+  bool lastWasDelta() const { return lastDelta; }
+  // True while the file lacks a record that was saved: a write failed and
+  // no full snapshot has replaced the file since. `why` gets the error.
+  bool failed(std::string* why = nullptr) const;
+
+  static constexpr int kRebaseEvery = 64;   // deltas before a new full snapshot
+
+private:
+  struct Job {
+    std::vector<uint8_t> bytes;
+    bool replace = false;   // full snapshot: write aside, then rename
+  };
+
+  std::string file;
+  uint32_t seq = 0;
+  int deltas = 0;
+  uint64_t deltaBytes = 0, fullBytes = 0;
+  size_t lastBytes = 0;
+  bool lastDelta = false;
+  bool rebaseNext = false;
+  uint32_t itemsSaved = 0, dialogsSaved = 0;   // table entries already written
+
+  mutable std::mutex mtx;
+  std::condition_variable cv, idle;
+  std::deque<Job> queue;
+  bool busy = false, stop = false, error = false;
+  std::string errorText;
+  std::thread worker;
+
+  void loop();
+  bool write(const Job& job, std::string& err);
+};
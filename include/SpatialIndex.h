@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Bucketed spatial hash: ids are linked into 8x8-tile buckets keyed by
+// bucket coordinate, so only occupied areas cost memory. Each id sits in
+// at most one bucket (intrusive doubly-linked list), making insert,
+// remove and move O(1). Callers keep the exact coordinates and filter.
+class SpatialIndex {
+public:
+  static constexpr int kCellShift = 3;            // 8x8 tiles per bucket
+  static constexpr int kCellSize  = 1 << kCellShift;
+  static constexpr uint32_t kNone = UINT32_MAX;
+
+  void insert(uint32_t id, int x, int y);
+  void remove(uint32_t id);
+  void move(uint32_t id, int x, int y);
+  void clear();
+
+  static int cellOf(int v) { return v >> kCellShift; }   // floors negatives too
+
+  // First id in the bucket holding (cx, cy), then follow next().
+  uint32_t first(int cx, int cy) const {
+    auto it = heads.find(key(cx, cy));
+    return it == heads.end() ? kNone : it->second;
+  }
+  uint32_t next(uint32_t id) const { return links[id].next; }
+  // Same, by the bucket keys below.
+  uint32_t firstIn(uint64_t bucket) const {
+    auto it = heads.find(bucket);
+    return it == heads.end() ? kNone : it->second;
+  }
+
+  size_t bucketCount() const { return heads.size(); }
+
+  static uint64_t key(int cx, int cy) {
+    return ((uint64_t)(uint32_t)cy << 32) | (uint32_t)cx;
+  }
+  // Buckets whose chain changed since clearTouched() (may repeat).
+  const std::vector<uint64_t>& touchedBuckets() const { return touched; }
+  void clearTouched() { touched.clear(); touchedCap = kTouchedMin; }
+
+private:
+  struct Link {
+    uint32_t prev = kNone, next = kNone;
+    uint64_t key = 0;
+    bool linked = false;
+  };
+  std::vector<Link> links;                       // by id
+  std::unordered_map<uint64_t, uint32_t> heads;  // bucket -> first id
+  std::vector<uint64_t> touched;
+  static constexpr size_t kTouchedMin = 64;
+  size_t touchedCap = kTouchedMin;   // dedupe when touched reaches this
+
+  void touch(uint64_t k);
+  void unlink(uint32_t id);
+  void link(uint32_t id, uint64_t k);
+};
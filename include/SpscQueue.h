@@ -0,0 +1,51 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// Bounded lock-free queue for exactly one producer thread and one
+// consumer thread. Neither side ever blocks or takes a lock: push() fails
+// when the ring is full and pop() when it is empty.
+//
+// The two indices live on separate cache lines, and each side keeps a
+// private copy of the other side's index, re-reading the shared one only
+// when its copy says full/empty. N must be a power of two.
+template <class T, size_t N>
+class SpscQueue {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "capacity must be a power of two");
+
+public:
+  static constexpr size_t kCapacity = N;
+
+  // Producer side. On failure `v` is left untouched.
+  template <class U>
+  bool push(U&& v) {
+    const size_t t = tail.load(std::memory_order_relaxed);
+    if (t - headSeen == N) {
+      headSeen = head.load(std::memory_order_acquire);
+      if (t - headSeen == N) return false;
+    }
+    ring[t & (N - 1)] = std::forward<U>(v);
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side.
+  bool pop(T& out) {
+    const size_t h = head.load(std::memory_order_relaxed);
+    if (h == tailSeen) {
+      tailSeen = tail.load(std::memory_order_acquire);
+      if (h == tailSeen) return false;
+    }
+    out = std::move(ring[h & (N - 1)]);
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+private:
+  alignas(64) std::atomic<size_t> head{0};   // next slot to pop
+  size_t tailSeen = 0;                       // consumer's copy of tail
+  alignas(64) std::atomic<size_t> tail{0};   // next slot to push
+  size_t headSeen = 0;                       // producer's copy of head
+  alignas(64) T ring[N];
+};
@@ -0,0 +1,7 @@
+#pragma once
+#include "Player.h"
+#include "Enemy.h"
+
+// Default loadouts, shared by Game and the headless tools.
+void giveStartingGear(Player& player);
+void giveStartingGear(Enemy& enemy);
@@ -0,0 +1,35 @@
+#pragma once
+#include "EntityStore.h"
+#include "EventLoop.h"
+#include "MessageLog.h"
+
+// A resumable piece of game flow (a fight, a conversation).
+//
+// Instead of blocking for keys and delays, a task is an explicit state
+// machine: step() runs until the task has to wait, and says what for.
+// Game steps it again once the key arrives or the delay has passed, and
+// keeps the map, the other actors and the screen going in between.
+// Headless runs resume delays at once. Tasks report to the message log.
+class Task {
+public:
+  enum class Wait { Key, Delay, Done };
+
+  virtual ~Task() = default;
+
+  // Called once to start, then after each awaited key or delay.
+  virtual Wait step() = 0;
+  // Actors the task holds (they do not wander off mid-fight).
+  virtual bool involves(EntityHandle) const { return false; }
+  // Enemy to show in the HUD while this task is in front.
+  virtual EntityHandle opponent() const { return {}; }
+
+  // Set by step() alongside its result.
+  int delayMs = 0;          // how long, for Wait::Delay
+  bool indicator = false;   // show the "press a key" marker
+  bool turnPassed = false;  // the player used a turn: the world moves
+
+  // Scheduler bookkeeping (Game).
+  enum class State { Ready, AwaitKey, Delayed };
+  State state = State::Ready;
+  EventLoop::TimerId timer = 0;
+};
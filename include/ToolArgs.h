@@ -0,0 +1,7 @@
+#pragma once
+#include <cstring>
+
+// The command-line tools print their usage for these and exit with 0.
+inline bool isHelpFlag(const char* a) {
+  return !std::strcmp(a, "-h") || !std::strcmp(a, "--help");
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Energy-based turn order for any number of actors.
+//
+// Every actor gains `speed` energy per tick and may act once it holds
+// kActionCost; acting spends the cost of what it did and keeps the rest.
+// Actors therefore act in proportion to their speed: 7 against 3 is seven
+// turns to three, not one extra opening move.
+//
+// Instead of adding energy tick by tick, each waiting actor is filed
+// under the tick it will be ready, in a wheel of kSlots buckets (the same
+// idea as EventLoop's timers). Speeds are at least 1 and costs at most
+// kMaxCost, so no wait is longer than one turn of the wheel and next()
+// is O(1) amortized however many actors there are. Actors ready on the
+// same tick act "first" ones first (the player: ties go to the player),
+// then in the order they were filed.
+//
+// No ncurses and no heap traffic once the buckets have grown, so it also
+// runs inside the headless tools.
+class TurnScheduler {
+public:
+  using ActorId = uint32_t;
+  static constexpr ActorId kNone = UINT32_MAX;
+  static constexpr int kActionCost = 100;
+  static constexpr int kMaxCost = 255;
+  static constexpr size_t kSlots = 256;   // > kMaxCost, power of two
+
+  // Starts `id` waiting with no energy (re-adding restarts it). Ids index
+  // a table, so keep them small and dense (e.g. entity slots).
+  void add(ActorId id, int speed, bool first = false);
+  void remove(ActorId id);
+  bool scheduled(ActorId id) const { return id < actors.size() && actors[id].state != Idle; }
+  bool acting(ActorId id) const { return id < actors.size() && actors[id].state == Acting; }
+  // Energy gained so far is kept; a waiting actor is filed again.
+  void setSpeed(ActorId id, int speed);
+
+  // The next actor to act; time jumps to its tick. kNone when nobody is
+  // waiting. The actor is "acting" until done() or remove().
+  ActorId next();
+  // Spends `cost` energy (1..kMaxCost) and files the actor's next turn.
+  void done(ActorId id, int cost = kActionCost);
+
+  uint64_t now() const { return tick; }
+  size_t waiting() const { return pending; }
+  int energy(ActorId id) const { return id < actors.size() ? actors[id].energy : 0; }
+  void clear();
+
+private:
+  enum State : uint8_t { Idle, Waiting, Acting };
+  struct Actor {
+    int speed = 1;
+    int energy = 0;          // as of `since`
+    uint64_t since = 0;
+    uint32_t gen = 0;        // bumped by remove(): stale entries are skipped
+    bool first = false;
+    State state = Idle;
+  };
+  struct Entry { ActorId id; uint32_t gen; };
+  struct Bucket {
+    std::vector<Entry> lane[2];   // 0 = first, 1 = everyone else
+    size_t pos[2] = { 0, 0 };     // entries already handed out this tick
+  };
+
+  std::vector<Actor> actors;
+  Bucket slots[kSlots];
+  uint64_t tick = 0;
+  size_t pending = 0;
+
+  void file(ActorId id);
+};
@@ -1,39 +1,122 @@
 #pragma once
+#include <algorithm>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
-#include <ncurses.h>
 #include "Map.h"
 #include "Player.h"
-#include "Enemy.h"
-#include "NPC.h"
+#include "EntityStore.h"
+#include "Fov.h"
+#include "MessageLog.h"
+#include "Renderer.h"
 
-struct UiWindows {
-  WINDOW *hud=nullptr, *mapw=nullptr, *side=nullptr, *msg=nullptr;
+// What the last renderFrame actually touched.
+struct UiFrameStats {
+  uint64_t frames = 0;
+  uint64_t idleFrames = 0;   // frames that drew nothing at all
+  int cellsTouched = 0;      // cells written during the last frame
+  int windowsRefreshed = 0;  // panels pushed to the screen last frame
 };
 
 class Ui {
 public:
   Ui(int sidebarWidth=18, int msgHeight=9);
-  ~Ui();
+
+  // Where frames go (NcursesRenderer or AnsiRenderer). Without one the
+  // Ui is headless: renderFrame only counts frames (replays).
+  void setRenderer(std::unique_ptr<Renderer> r) { out = std::move(r); }
+  Renderer* renderer() const { return out.get(); }
 
   void layout();  // call on start and on KEY_RESIZE
+  // Redraws only what changed since the previous call: whole panels for
+  // the HUD/sidebar/message, and single tiles on the map when only
+  // entities moved. Idle frames write nothing and skip present().
+  // `foe` is the enemy shown in the HUD/sidebar (may be invalid). The
+  // message box shows the newest lines of `log`.
   void renderFrame(const Map& map, const Player& player,
-                   const Enemy& enemy, const NPC& npc,
-                   const std::string& message, bool showIndicator=false);
+                   const EntityStore& actors, EntityHandle foe,
+                   const MessageLog& log, bool showIndicator=false);
 
+  // x/y are map coordinates; the map view scrolls to keep the player centred
   bool onMapViewport(int x, int y) const;
-  WINDOW* mapWindow() const;
+
+  // With a Fov set, the map shows visible tiles, dims remembered ones,
+  // hides the rest, and only draws actors the player can see.
+  void setVisibility(const Fov* fov) { this->fov = fov; mapValid = false; }
+
+  // Scrollback: positive goes back in the log, negative forward. A new
+  // message jumps back to the newest lines.
+  void scrollLog(int lines) { msgScroll = std::max(0, msgScroll + lines); }
+  static constexpr int kLogScrollStep = 2;
+
+  const UiFrameStats& frameStats() const { return stats; }
+  void setShowStats(bool on) { showStats = on; hudValid = false; }
+  bool statsShown() const { return showStats; }
+  // Profiler overlay in the HUD: p50/p99 frame time and input latency.
+  void setShowProfile(bool on) { showProfile = on; hudValid = false; profStale = true; }
+  bool profileShown() const { return showProfile; }
+  // The overlay keeps its numbers until asked to re-read them, so showing
+  // it does not make every frame redraw the HUD.
+  void refreshProfile() { profStale = true; }
+  static constexpr uint32_t kProfileRefreshMs = 500;   // suggested refresh interval
 
 private:
+  struct Rect { int h = 0, w = 0; };
+
   int sidebarWidth, msgHeight;
-  UiWindows w;
+  std::unique_ptr<Renderer> out;
+  Rect panel[Renderer::kPanels];   // sizes from the last layout()
+  int camX = 0, camY = 0;   // map coordinate at the map panel's top-left
+
+  // --- cached inputs of the last frame (dirty tracking) ---
+  struct HudState {
+    int hp = -1, enemyHp = -1, spd = -1, cells = -1;
+    int prof[4] = { -1, -1, -1, -1 };   // frame/input p50/p99 in us, -1 = hidden
+    bool operator==(const HudState& o) const {
+      return hp == o.hp && enemyHp == o.enemyHp && spd == o.spd && cells == o.cells &&
+             std::equal(prof, prof + 4, o.prof);
+    }
+  };
+  struct SideState {
+    int stats[8] = {};  // player hp/spd/atk/def, enemy hp/spd/atk/def
+  };
+  struct Mark {
+    int x, y;
+    Cell cell;
+    bool operator==(const Mark& o) const {
+      return x == o.x && y == o.y && cell == o.cell;
+    }
+  };
+
+  bool hudValid = false, sideValid = false, msgValid = false, mapValid = false;
+  HudState hudState;
+  SideState sideState;
+  std::string sideNames[7];  // gear names shown last frame
+  uint64_t msgVersion = 0;   // log version shown
+  int msgScroll = 0, shownScroll = 0;
+  bool msgIndicator = false;
+  uint64_t mapVersion = 0;
+  uint64_t mapFovVersion = 0;
+  const Fov* fov = nullptr;
+  int mapCamX = -1, mapCamY = -1;
+  std::vector<Mark> marks, prevMarks;   // entities drawn this/last frame
+  std::vector<Cell> rowBuf;             // terrain row scratch
 
-  void destroy();
+  UiFrameStats stats;
+  bool showStats = false;
+  int shownCells = 0;
+  bool showProfile = false;
+  int shownProf[4] = {};   // overlay numbers, re-read on refreshProfile()
+  bool profStale = true;
 
-  void drawHUD(const Player& player, const Enemy& enemy) const;
-  void drawSidebar(const Player& player, const Enemy& enemy) const;
-  void drawMessageBox(const std::string& text, bool showIndicator) const;
+  bool drawHUD(const Player& player, const EntityStore& actors, EntityHandle foe);
+  bool drawSidebar(const Player& player, const EntityStore& actors, EntityHandle foe);
+  bool drawMessageBox(const MessageLog& log, bool showIndicator);
+  bool drawMap(const Map& map, const Player& player, const EntityStore& actors);
 
-  // ⬇️ declare exactly as defined in Ui.cpp
-  static std::vector<std::string> wrapText(const std::string& s, int maxw);
+  void drawMark(const Mark& m);
+  void restoreTile(const Map& map, int x, int y);
+  Cell terrainCell(const Map& map, int x, int y) const;
+  void drawTerrain(const Map& map, int rows, int cols);
 };
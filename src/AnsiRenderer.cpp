@@ -0,0 +1,251 @@
+#include "AnsiRenderer.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace {
+
+// SGR foreground for each color number (the ncurses pairs in Game)
+const int kFg[8] = { 0, 31, 32, 36, 33, 37, 35, 34 };
+
+void appendInt(std::string& s, int v) {
+  char b[12];
+  const int n = std::snprintf(b, sizeof b, "%d", v);
+  s.append(b, (size_t)n);
+}
+
+}
+
+AnsiRenderer::AnsiRenderer(int fd) : fd(fd) {
+  int r = 24, c = 80;
+  measure(r, c);
+}
+
+AnsiRenderer::AnsiRenderer(std::string* sink, int rows, int cols) : sink(sink) {
+  resize(rows, cols);
+}
+
+AnsiRenderer::~AnsiRenderer() {
+  if (!started) return;
+  out.clear();
+  if (curStyle & kLineChars) out += "\x1b(B";
+  out += "\x1b[m\x1b[?25h";
+  send();
+}
+
+void AnsiRenderer::resize(int r, int c) {
+  r = std::max(1, r);
+  c = std::max(1, c);
+  if (r == rows && c == cols && !front.empty()) return;
+  rows = r; cols = c;
+  front.assign((size_t)rows * cols, Cell());
+  back.assign((size_t)rows * cols, Cell());
+  rowDirty.assign((size_t)rows, 1);
+  for (Rect& p : panels) p = Rect();
+  full = true;
+}
+
+void AnsiRenderer::measure(int& r, int& c) {
+  winsize ws{};
+  if (fd >= 0 && ioctl(fd, TIOCGWINSZ, &ws) == 0 && ws.ws_row && ws.ws_col)
+    resize(ws.ws_row, ws.ws_col);
+  r = rows;
+  c = cols;
+}
+
+void AnsiRenderer::place(Panel p, int y, int x, int h, int w) {
+  Rect& r = panels[p];
+  r.y = std::clamp(y, 0, rows);
+  r.x = std::clamp(x, 0, cols);
+  r.h = std::clamp(h, 0, rows - r.y);
+  r.w = std::clamp(w, 0, cols - r.x);
+  clear(p);
+}
+
+Cell* AnsiRenderer::at(Panel p, int y, int x, int& n) {
+  const Rect& r = panels[p];
+  if (y < 0 || y >= r.h || x < 0 || x >= r.w) return nullptr;
+  n = std::min(n, r.w - x);
+  if (n <= 0) return nullptr;
+  rowDirty[r.y + y] = 1;
+  return &back[(size_t)(r.y + y) * cols + r.x + x];
+}
+
+void AnsiRenderer::clear(Panel p) {
+  const Rect& r = panels[p];
+  for (int y = 0; y < r.h; ++y) {
+    int n = r.w;
+    if (Cell* c = at(p, y, 0, n)) std::fill(c, c + n, Cell());
+  }
+}
+
+void AnsiRenderer::text(Panel p, int y, int x, const char* s, int n, uint8_t style) {
+  Cell* c = at(p, y, x, n);
+  if (!c) return;
+  for (int i = 0; i < n && s[i]; ++i) c[i] = { s[i], style };
+}
+
+void AnsiRenderer::cells(Panel p, int y, int x, const Cell* src, int n) {
+  if (Cell* c = at(p, y, x, n)) std::copy(src, src + n, c);
+}
+
+void AnsiRenderer::box(Panel p) {
+  const Rect& r = panels[p];
+  if (r.h < 2 || r.w < 2) return;
+  // DEC special graphics: l k m j corners, q horizontal, x vertical
+  const uint8_t line = kLineChars;
+  for (int x = 1; x < r.w - 1; ++x) {
+    back[(size_t)r.y * cols + r.x + x] = { 'q', line };
+    back[(size_t)(r.y + r.h - 1) * cols + r.x + x] = { 'q', line };
+  }
+  for (int y = 1; y < r.h - 1; ++y) {
+    back[(size_t)(r.y + y) * cols + r.x] = { 'x', line };
+    back[(size_t)(r.y + y) * cols + r.x + r.w - 1] = { 'x', line };
+  }
+  back[(size_t)r.y * cols + r.x] = { 'l', line };
+  back[(size_t)r.y * cols + r.x + r.w - 1] = { 'k', line };
+  back[(size_t)(r.y + r.h - 1) * cols + r.x] = { 'm', line };
+  back[(size_t)(r.y + r.h - 1) * cols + r.x + r.w - 1] = { 'j', line };
+  for (int y = 0; y < r.h; ++y) rowDirty[r.y + y] = 1;
+}
+
+// Shortest sequence that takes the cursor from where it is to (y, x).
+int AnsiRenderer::moveSeq(int y, int x, char* buf) const {
+  int n = std::snprintf(buf, kMaxMove, "\x1b[%d;%dH", y + 1, x + 1);
+  if (curY < 0) return n;
+  char alt[kMaxMove];
+  int m = kMaxMove;
+  if (y == curY && x == 0) {
+    m = std::snprintf(alt, sizeof alt, "\r");
+  } else if (y == curY) {
+    m = x > curX ? std::snprintf(alt, sizeof alt, "\x1b[%dC", x - curX)
+                 : std::snprintf(alt, sizeof alt, "\x1b[%dD", curX - x);
+  } else if (x == 0 && y > curY && y - curY < kMaxMove - 2) {
+    m = 1 + (y - curY);
+    alt[0] = '\r';
+    std::memset(alt + 1, '\n', (size_t)(y - curY));
+  } else if (x == curX) {
+    m = y > curY ? std::snprintf(alt, sizeof alt, "\x1b[%dB", y - curY)
+                 : std::snprintf(alt, sizeof alt, "\x1b[%dA", curY - y);
+  }
+  if (m < n) {
+    std::memcpy(buf, alt, (size_t)m);
+    n = m;
+  }
+  return n;
+}
+
+void AnsiRenderer::moveTo(int y, int x) {
+  if (y == curY && x == curX) return;
+  char buf[kMaxMove];
+  out.append(buf, (size_t)moveSeq(y, x, buf));
+  curY = y; curX = x;
+}
+
+void AnsiRenderer::setStyle(uint8_t s) {
+  if (s == curStyle) return;
+  if ((s ^ curStyle) & kLineChars) out += (s & kLineChars) ? "\x1b(0" : "\x1b(B";
+  const uint8_t from = curStyle & ~kLineChars, to = s & ~kLineChars;
+  curStyle = s;
+  if (from == to) return;
+  if (to == kPlain) { out += "\x1b[m"; return; }
+  // only adding to what is on: send just the additions
+  const uint8_t flags = kBold | kDim | kReverse;
+  const bool adds = (from & flags & ~to) == 0 &&
+                    ((from & kColorBits) == 0 || (from & kColorBits) == (to & kColorBits));
+  const uint8_t want = adds ? (uint8_t)(to & ~from) : to;
+  out += adds ? "\x1b[" : "\x1b[0;";
+  const size_t mark = out.size();
+  if (want & kBold)    out += "1;";
+  if (want & kDim)     out += "2;";
+  if (want & kReverse) out += "7;";
+  if ((want & kColorBits) && (!adds || (from & kColorBits) == 0)) {
+    appendInt(out, kFg[to & kColorBits]);
+    out += ';';
+  }
+  if (out.size() > mark) out.back() = 'm';
+  else out += 'm';
+}
+
+void AnsiRenderer::present() {
+  out.clear();
+  if (!started) { out += "\x1b[?25l"; started = true; }
+  if (full) {
+    // start from a known blank screen, then send only non-blank cells
+    if (curStyle & kLineChars) out += "\x1b(B";
+    out += "\x1b[m\x1b[H\x1b[2J";
+    curStyle = kPlain;
+    curY = curX = 0;
+    std::fill(front.begin(), front.end(), Cell());
+    std::fill(rowDirty.begin(), rowDirty.end(), 1);
+    full = false;
+  }
+
+  const Cell blank;
+  char move[kMaxMove];
+  for (int y = 0; y < rows; ++y) {
+    if (!rowDirty[y]) continue;
+    rowDirty[y] = 0;
+    Cell* b = &back[(size_t)y * cols];
+    Cell* f = &front[(size_t)y * cols];
+    if (std::memcmp(b, f, sizeof(Cell) * cols) == 0) continue;
+    int tail = cols;   // b[tail, cols) is blank
+    while (tail > 0 && b[tail - 1] == blank) --tail;
+
+    for (int x = 0; x < cols; ) {
+      if (b[x] == f[x]) { ++x; continue; }
+      if (x >= tail) {
+        // the rest of the line goes blank: erase it if that is shorter
+        int changed = 0;
+        for (int i = x; i < cols; ++i) changed += (f[i] != blank);
+        if (changed > kEraseMin) {
+          moveTo(y, x);
+          setStyle(kPlain);
+          out += "\x1b[K";
+          std::fill(f + x, f + cols, blank);
+          break;
+        }
+      }
+      // unchanged cells in the current style may be cheaper to print
+      // again than a cursor jump over them
+      if (curY == y && curX >= 0 && curX < x && x - curX <= moveSeq(y, x, move)) {
+        bool reprint = true;
+        for (int i = curX; i < x && reprint; ++i) reprint = (f[i].style == curStyle);
+        if (reprint) {
+          for (int i = curX; i < x; ++i) out += f[i].ch;
+          curX = x;
+        }
+      }
+      moveTo(y, x);
+      setStyle(b[x].style);
+      out += b[x].ch;
+      f[x] = b[x];
+      ++x;
+      curX = x < cols ? x : -1;   // past the last column the cursor waits to wrap
+      if (curX < 0) curY = -1;
+    }
+  }
+  if (curStyle & kLineChars) setStyle((uint8_t)(curStyle & ~kLineChars));
+  send();
+}
+
+void AnsiRenderer::send() {
+  if (out.empty()) return;
+  bytes += out.size();
+  if (sink) { sink->append(out); ++writeCalls; return; }
+  const char* p = out.data();
+  size_t left = out.size();
+  while (left > 0) {
+    const ssize_t n = ::write(fd, p, left);
+    ++writeCalls;
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      break;   // the terminal is gone; nothing sensible left to do
+    }
+    p += n;
+    left -= (size_t)n;
+  }
+}
@@ -0,0 +1,268 @@
+#include "AreaStreamer.h"
+#include "NPC.h"
+#include "StartingGear.h"
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+
+size_t Area::memoryBytes() const {
+  return sizeof(Area) + map.memoryBytes() + actors.memoryBytes() +
+         layout.rooms.capacity() * sizeof(Room) +
+         exploredIdx.capacity() * sizeof(int32_t) +
+         exploredBits.capacity() * sizeof(uint64_t);
+}
+
+DungeonConfig areaConfig(uint64_t seed, int depth) {
+  DungeonConfig cfg;
+  cfg.width  = kAreaWidth;
+  cfg.height = kAreaHeight;
+  // depth 0 keeps the run's seed, so old seeds still make the same dungeon
+  cfg.seed   = depth == 0 ? seed : Rng(seed, 3).split((uint64_t)depth)();
+  return cfg;
+}
+
+// Walkable tile of `room` not taken by an actor or (avoidX, avoidY).
+static bool freeRoomTile(const Map& map, const Room& room, const EntityStore& actors, Rng& rng,
+                         int avoidX, int avoidY, int& x, int& y) {
+  for (int tries = 0; tries < 16; ++tries) {
+    int tx, ty;
+    randomRoomTile(map, room, rng, tx, ty);
+    if (tx == avoidX && ty == avoidY) continue;
+    if (actors.valid(actors.at(tx, ty))) continue;
+    x = tx; y = ty;
+    return true;
+  }
+  return false;
+}
+
+EntityHandle spawnRoomEnemies(const Map& map, const DungeonLayout& layout, EntityStore& actors,
+                              Rng& rng, int count, int avoidX, int avoidY) {
+  EntityHandle first;
+  const int rooms = (int)layout.rooms.size();
+  if (rooms < 2) return first;
+  Enemy proto;
+  giveStartingGear(proto);
+  const int start = (int)rng.bounded((uint32_t)rooms);
+  int placed = 0;
+  for (int k = 0; k < rooms && placed < count; ++k) {
+    const int r = (start + k) % rooms;
+    if (r == layout.spawnRoom) continue;
+    int ex, ey;
+    if (!freeRoomTile(map, layout.rooms[r], actors, rng, avoidX, avoidY, ex, ey)) continue;
+    proto.setPos(ex, ey);
+    EntityHandle h = actors.spawnEnemy(proto);
+    if (placed++ == 0) first = h;
+  }
+  return first;
+}
+
+void spawnRoomNPC(const Map& map, const DungeonLayout& layout, EntityStore& actors,
+                  Rng& rng, int avoidX, int avoidY) {
+  if (layout.rooms.empty()) return;
+  int nx, ny;
+  if (!freeRoomTile(map, layout.rooms[layout.spawnRoom], actors, rng, avoidX, avoidY, nx, ny))
+    return;
+  actors.spawnNPC(NPC(nx, ny));
+}
+
+void placeStairs(Map& map, DungeonLayout& layout, int depth) {
+  if (depth > 0) {
+    layout.upX = layout.spawnX;
+    layout.upY = layout.spawnY;
+    map.setTile(layout.upX, layout.upY, Tile::StairsUp);
+  }
+  long best = -1;
+  for (size_t r = 0; r < layout.rooms.size(); ++r) {
+    if ((int)r == layout.spawnRoom) continue;
+    const Room& room = layout.rooms[r];
+    const long dx = room.anchorX - layout.spawnX, dy = room.anchorY - layout.spawnY;
+    if (dx * dx + dy * dy <= best) continue;
+    best = dx * dx + dy * dy;
+    layout.downX = room.anchorX;
+    layout.downY = room.anchorY;
+  }
+  if (best >= 0) map.setTile(layout.downX, layout.downY, Tile::StairsDown);
+}
+
+void findStairs(const Map& map, DungeonLayout& layout) {
+  layout.upX = layout.upY = layout.downX = layout.downY = -1;
+  for (int y = 0; y < map.getHeight(); ++y)
+    for (int x = 0; x < map.getWidth(); ++x) {
+      const Tile t = map.getTile(x, y);
+      if (t == Tile::StairsUp)   { layout.upX = x;   layout.upY = y; }
+      if (t == Tile::StairsDown) { layout.downX = x; layout.downY = y; }
+    }
+}
+
+std::unique_ptr<Area> buildArea(uint64_t seed, int depth) {
+  auto a = std::make_unique<Area>();
+  a->seed = seed;
+  a->depth = depth;
+  DungeonConfig cfg = areaConfig(seed, depth);
+  cfg.threads = 1;   // same map on any thread count; leave the cores to the game
+  a->map = generateDungeon(cfg, a->layout);
+
+  // the same stream and order as Game's startup (rng.seed(seed, 1))
+  Rng rng(cfg.seed, 1);
+  const DungeonLayout& l = a->layout;
+  spawnRoomEnemies(a->map, l, a->actors, rng, kAreaEnemies, l.spawnX, l.spawnY);
+  if (depth == 0) spawnRoomNPC(a->map, l, a->actors, rng, l.spawnX, l.spawnY);
+  placeStairs(a->map, a->layout, depth);
+  a->map.markPristine();
+
+  a->exploredIdx.assign((size_t)a->map.chunksAcross() * a->map.chunksDown(), -1);
+  return a;
+}
+
+// ---------------- AreaStreamer ----------------
+
+// Wakes whoever reads the pipe. The byte carries nothing; if the pipe is
+// full a wakeup is pending anyway.
+static void poke(int fd) {
+  const char one = 1;
+  const ssize_t n = ::write(fd, &one, 1);
+  (void)n;
+}
+
+AreaStreamer::AreaStreamer(uint64_t seed, bool background, size_t budgetBytes)
+: seed(seed), background(background), budget(budgetBytes) {
+  if (!background) return;
+  if (::pipe(wakePipe) != 0 || ::pipe(donePipe) != 0) {
+    // no pipes, no worker: build on the caller's thread instead
+    for (int* p : { wakePipe, donePipe })
+      for (int k = 0; k < 2; ++k)
+        if (p[k] >= 0) { ::close(p[k]); p[k] = -1; }
+    this->background = false;
+    return;
+  }
+  ::fcntl(donePipe[0], F_SETFL, O_NONBLOCK);
+  worker = std::thread(&AreaStreamer::loop, this);
+}
+
+AreaStreamer::~AreaStreamer() {
+  if (worker.joinable()) {
+    stop.store(true, std::memory_order_release);
+    poke(wakePipe[1]);
+    worker.join();
+  }
+  for (int* p : { wakePipe, donePipe })
+    for (int k = 0; k < 2; ++k)
+      if (p[k] >= 0) ::close(p[k]);
+}
+
+void AreaStreamer::reseed(uint64_t s, int depth) {
+  seed = s;
+  current = depth;
+  cache.clear();
+  inFlight.clear();   // builds for the old seed are dropped as they arrive
+  bytes = 0;
+}
+
+bool AreaStreamer::building(int depth) const {
+  return std::find(inFlight.begin(), inFlight.end(), depth) != inFlight.end();
+}
+
+void AreaStreamer::request(int depth) {
+  if (depth < 0 || ready(depth) || building(depth)) return;
+  if (!background) {
+    std::unique_ptr<Area> a = buildArea(seed, depth);
+    ++built;
+    bytes += a->memoryBytes();
+    cache[depth] = std::move(a);
+    trim();
+    return;
+  }
+  if (inFlight.size() >= kMaxInFlight) return;   // asked again on the next step
+  if (!jobs.push(Job{ seed, depth })) return;
+  inFlight.push_back(depth);
+  poke(wakePipe[1]);
+}
+
+bool AreaStreamer::collect() {
+  if (!background) return false;
+  char buf[64];
+  while (::read(donePipe[0], buf, sizeof buf) > 0) {}
+  bool any = false;
+  std::unique_ptr<Area> a;
+  while (done.pop(a)) {
+    if (a->seed != seed) continue;   // asked for before a reseed
+    inFlight.erase(std::remove(inFlight.begin(), inFlight.end(), a->depth), inFlight.end());
+    ++built;
+    any = true;
+    if (ready(a->depth)) continue;
+    bytes += a->memoryBytes();
+    cache[a->depth] = std::move(a);
+  }
+  if (any) trim();
+  return any;
+}
+
+std::unique_ptr<Area> AreaStreamer::take(int depth) {
+  current = depth;
+  auto it = cache.find(depth);
+  if (it == cache.end()) return nullptr;
+  std::unique_ptr<Area> a = std::move(it->second);
+  cache.erase(it);
+  bytes -= a->memoryBytes();
+  return a;
+}
+
+void AreaStreamer::store(std::unique_ptr<Area> area) {
+  area->lastUsed = ++clock;
+  bytes += area->memoryBytes();
+  const int depth = area->depth;
+  auto& slot = cache[depth];
+  if (slot) bytes -= slot->memoryBytes();
+  slot = std::move(area);
+  trim();
+}
+
+std::vector<const Area*> AreaStreamer::visited() const {
+  std::vector<const Area*> out;
+  for (const auto& e : cache)
+    if (e.second->lastUsed != 0) out.push_back(e.second.get());
+  return out;
+}
+
+void AreaStreamer::restore(std::unique_ptr<Area> area) {
+  clock = std::max(clock, area->lastUsed);
+  bytes += area->memoryBytes();
+  auto& slot = cache[area->depth];
+  if (slot) bytes -= slot->memoryBytes();
+  slot = std::move(area);
+  trim();
+}
+
+// Fresh prefetches are free to rebuild, so they go before any visited
+// level; among visited levels the one left longest ago goes first.
+void AreaStreamer::trim() {
+  while (bytes > budget) {
+    auto victim = cache.end();
+    for (auto it = cache.begin(); it != cache.end(); ++it) {
+      if (it->first >= current - 1 && it->first <= current + 1) continue;
+      if (victim == cache.end() || it->second->lastUsed < victim->second->lastUsed)
+        victim = it;
+    }
+    if (victim == cache.end()) break;
+    bytes -= victim->second->memoryBytes();
+    cache.erase(victim);
+    ++evicted;
+  }
+}
+
+// Worker: sleeps in read() until request() writes a byte, then builds
+// everything queued. Finished areas go back through `done`; with at most
+// kMaxInFlight jobs outstanding per seed it is practically never full.
+void AreaStreamer::loop() {
+  char buf[64];
+  while (!stop.load(std::memory_order_acquire)) {
+    Job job;
+    if (!jobs.pop(job)) {
+      if (::read(wakePipe[0], buf, sizeof buf) == 0) break;
+      continue;
+    }
+    std::unique_ptr<Area> a = buildArea(job.seed, job.depth);
+    while (!done.push(std::move(a))) std::this_thread::yield();
+    poke(donePipe[1]);
+  }
+}
@@ -0,0 +1,118 @@
+#include "CombatResolver.h"
+#include <algorithm>
+#include <numeric>
+
+namespace combat {
+
+Combatant fromPlayer(const Player& p) {
+  Combatant c;
+  c.hp      = p.getHP();
+  c.speed   = p.getSpeed();
+  c.attack  = p.getAttack();
+  c.defense = p.getDefense();
+  c.weapon  = &p.getWeapon();
+  c.armor[0] = &p.getHelmet();
+  c.armor[1] = &p.getChest();
+  c.armor[2] = &p.getBoots();
+  c.armorCount = 3;
+  return c;
+}
+
+Combatant fromEnemy(const Enemy& e) {
+  Combatant c;
+  c.hp      = e.isAlive() ? e.getHP() : 0;
+  c.speed   = e.getSpeed();
+  c.attack  = e.getAttack();
+  c.defense = e.getDefense();
+  c.weapon  = &e.getWeapon();
+  c.armor[0] = &e.getHelmet();
+  c.armor[1] = &e.getChest();
+  c.armorCount = 2;          // no boots for enemy
+  return c;
+}
+
+Combatant fromEntity(const EntityStore& actors, EntityHandle h) {
+  Combatant c;
+  c.hp      = actors.isAlive(h) ? actors.getHP(h) : 0;
+  c.speed   = actors.getSpeed(h);
+  c.attack  = actors.getAttack(h);
+  c.defense = actors.getDefense(h);
+  c.weapon  = &actors.getWeapon(h);
+  c.armor[0] = &actors.getHelmet(h);
+  c.armor[1] = &actors.getChest(h);
+  c.armorCount = 2;
+  return c;
+}
+
+int computeDamage(int baseD6, int atk, int atkDiceSum,
+                  int targetDef, int flatDef, int defDiceSum) {
+  int offense = baseD6 + atk + atkDiceSum;
+  int defense = targetDef + flatDef + defDiceSum;
+  int dmg = offense - defense;
+  if (dmg < 1) dmg = 1;
+  return dmg;
+}
+
+AttackRoll resolveAttack(Rng& rng,
+                         const Combatant& attacker, const Combatant& defender) {
+  AttackRoll r;
+  // same roll order as the original CombatSystem: d6, weapon, armor
+  r.base = rollD6(rng);
+  if (attacker.weapon) r.atkDice = attacker.weapon->attackDice.roll(rng);
+  for (int i = 0; i < defender.armorCount; ++i) {
+    const Equipment* a = defender.armor[i];
+    if (!a) continue;
+    r.defDice += a->defenseDice.roll(rng);
+    r.flat    += a->flatDefBonus;
+  }
+  r.dmg = computeDamage(r.base, attacker.attack, r.atkDice,
+                        defender.defense, r.flat, r.defDice);
+  return r;
+}
+
+TurnOrder::TurnOrder(int playerSpeed, int enemySpeed)
+: ps(std::max(1, playerSpeed)), es(std::max(1, enemySpeed)) {}
+
+bool TurnOrder::playerNext() {
+  constexpr int T = TurnScheduler::kActionCost;
+  auto ticks = [](int energy, int speed) {
+    return energy >= T ? 0 : (T - energy + speed - 1) / speed;
+  };
+  const int dp = ticks(pe, ps), de = ticks(ee, es);
+  const bool player = dp <= de;
+  const int dt = player ? dp : de;
+  pe += ps * dt;
+  ee += es * dt;
+  (player ? pe : ee) -= T;
+  return player;
+}
+
+std::vector<uint8_t> turnCycle(int playerSpeed, int enemySpeed) {
+  constexpr int T = TurnScheduler::kActionCost;
+  const int ps = std::max(1, playerSpeed), es = std::max(1, enemySpeed);
+  // both energies are multiples of T again after `period` ticks
+  const long period = std::lcm((long)(T / std::gcd(T, ps)), (long)(T / std::gcd(T, es)));
+  const long actions = (ps + es) * period / T;
+  std::vector<uint8_t> cycle((size_t)actions);
+  TurnOrder order(ps, es);
+  for (uint8_t& c : cycle) c = order.playerNext();
+  return cycle;
+}
+
+FightResult resolveFight(Rng& rng, Combatant player, Combatant enemy) {
+  FightResult res;
+  TurnOrder order(player.speed, enemy.speed);
+
+  while (player.hp > 0 && enemy.hp > 0) {
+    if (order.playerNext()) enemy.hp  -= resolveAttack(rng, player, enemy).dmg;
+    else                    player.hp -= resolveAttack(rng, enemy, player).dmg;
+    ++res.turns;
+  }
+
+  res.playerWon = player.hp > 0;
+  res.playerHP  = player.hp > 0 ? player.hp : 0;
+  res.enemyHP   = enemy.hp  > 0 ? enemy.hp  : 0;
+  return res;
+}
+
+} // namespace combat
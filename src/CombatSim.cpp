@@ -0,0 +1,69 @@
+#include "CombatSim.h"
+#include "JobSystem.h"
+
+static void bump(std::vector<uint64_t>& h, int v) {
+  if (v < 0) v = 0;
+  if ((size_t)v >= h.size()) h.resize(v + 1, 0);
+  ++h[v];
+}
+
+static void mergeHist(std::vector<uint64_t>& dst, const std::vector<uint64_t>& src) {
+  if (src.size() > dst.size()) dst.resize(src.size(), 0);
+  for (size_t i = 0; i < src.size(); ++i) dst[i] += src[i];
+}
+
+void SimStats::add(const combat::FightResult& r) {
+  ++fights;
+  bump(turns, r.turns);
+  if (r.playerWon) { ++playerWins; bump(playerHpLeft, r.playerHP); }
+  else             { bump(enemyHpLeft, r.enemyHP); }
+}
+
+void SimStats::merge(const SimStats& o) {
+  fights     += o.fights;
+  playerWins += o.playerWins;
+  mergeHist(turns, o.turns);
+  mergeHist(playerHpLeft, o.playerHpLeft);
+  mergeHist(enemyHpLeft, o.enemyHpLeft);
+}
+
+double SimStats::winRate() const {
+  return fights ? (double)playerWins / (double)fights : 0.0;
+}
+
+double histMean(const std::vector<uint64_t>& h) {
+  uint64_t n = 0;
+  double sum = 0.0;
+  for (size_t i = 0; i < h.size(); ++i) { n += h[i]; sum += (double)i * h[i]; }
+  return n ? sum / (double)n : 0.0;
+}
+
+int histPercentile(const std::vector<uint64_t>& h, double q) {
+  uint64_t n = 0;
+  for (auto c : h) n += c;
+  if (n == 0) return 0;
+  uint64_t want = (uint64_t)(q * (double)(n - 1)) + 1;
+  uint64_t acc = 0;
+  for (size_t i = 0; i < h.size(); ++i) {
+    acc += h[i];
+    if (acc >= want) return (int)i;
+  }
+  return (int)h.size() - 1;
+}
+
+SimStats simulateFights(const combat::Combatant& player,
+                        const combat::Combatant& enemy,
+                        const SimConfig& cfg) {
+  // one independent stream per chunk (not per thread), so the same seed
+  // gives the same numbers on any number of threads
+  JobSystem jobs(cfg.threads);
+  return jobs.parallelReduce(cfg.fights, kSimChunk, SimStats(),
+    [&](uint64_t begin, uint64_t end) {
+      Rng rng = Rng(cfg.seed).split(begin / kSimChunk);
+      SimStats local;
+      for (uint64_t i = begin; i < end; ++i)
+        local.add(combat::resolveFight(rng, player, enemy));
+      return local;
+    },
+    [](SimStats& total, const SimStats& part) { total.merge(part); });
+}
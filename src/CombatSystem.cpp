@@ -1,133 +1,71 @@
 #include "CombatSystem.h"
-#include <ncurses.h>
-#include <sstream>
-#include <vector>
-#include <random>
-
-// --- small helpers ---
-static inline void wait_key_and_restore_timeout() {
-  nodelay(stdscr, FALSE);
-  flushinp();
-  getch();
-  timeout(50);
-}
-
-CombatSystem::CombatSystem(std::mt19937& rng) : rng(rng) {}
-
-int CombatSystem::rollD6() {
-  static std::uniform_int_distribution<int> d6(1, 6);
-  return d6(rng);
-}
-
-static int rollDice(std::mt19937& rng, int count, int sides) {
-  if (count <= 0 || sides <= 0) return 0;
-  std::uniform_int_distribution<int> dist(1, sides);
-  int sum = 0;
-  for (int i = 0; i < count; ++i) sum += dist(rng);
-  return sum;
-}
-
-static int rollDiceListSum(std::mt19937& rng, const std::vector<Dice>& list) {
-  int sum = 0;
-  for (const auto& d : list) sum += rollDice(rng, d.count, d.sides);
-  return sum;
-}
-
-// dmg = max(1, (baseD6 + ATK + atkDiceSum) - (DEF + flatDef + defDiceSum))
-static int computeDamage(int baseD6, int atk, int atkDiceSum,
-                         int targetDef, int flatDef, int defDiceSum) {
-  int offense = baseD6 + atk + atkDiceSum;
-  int defense = targetDef + flatDef + defDiceSum;
-  int dmg = offense - defense;
-  if (dmg < 1) dmg = 1;
-  return dmg;
-}
-
-void CombatSystem::run(Map& map, Player& player, Enemy& enemy, NPC& npc,
-                       Ui& ui, bool& running, std::string& lastMessage) {
-  bool playerTurn = (player.getSpeed() >= enemy.getSpeed());
-  lastMessage = playerTurn ? "Combat started! You act first."
-                           : "Combat started! Enemy acts first.";
-  ui.renderFrame(map, player, enemy, npc, lastMessage, /*indicator*/true);
-  wait_key_and_restore_timeout();
-
-  while (player.isAlive() && enemy.isAlive()) {
-    if (playerTurn) {
-      lastMessage = "You attack! Rolling...";
-      ui.renderFrame(map, player, enemy, npc, lastMessage, true);
-      napms(250);
-
-      int base = rollD6();
-      const auto& w  = player.getWeapon();
-      const auto& eh = enemy.getHelmet();
-      const auto& ec = enemy.getChest();
-
-      int atkDiceSum = rollDiceListSum(rng, w.attackDice);
-      int defDiceSum = rollDiceListSum(rng, eh.defenseDice) +
-                       rollDiceListSum(rng, ec.defenseDice);
-      int flatRed    = eh.flatDefBonus + ec.flatDefBonus;
-
-      int dmg = computeDamage(base, player.getAttack(), atkDiceSum,
-                              enemy.getDefense(), flatRed, defDiceSum);
-      enemy.takeDamage(dmg);
-
-      std::ostringstream os;
-      os << "You attack: d6=" << base
-         << " + atk=" << player.getAttack()
-         << " + w=" << atkDiceSum
-         << "  vs  def=" << enemy.getDefense()
-         << " + flat=" << flatRed
-         << " + arm=" << defDiceSum
-         << " -> " << dmg << " dmg.";
-      lastMessage = os.str();
-
-    } else {
-      lastMessage = "Enemy attacks! Rolling...";
-      ui.renderFrame(map, player, enemy, npc, lastMessage, true);
-      napms(250);
-
-      int base = rollD6();
-      const auto& w  = enemy.getWeapon();
-      const auto& ph = player.getHelmet();
-      const auto& pc = player.getChest();
-      const auto& pb = player.getBoots();
-
-      int atkDiceSum = rollDiceListSum(rng, w.attackDice);
-      int defDiceSum = rollDiceListSum(rng, ph.defenseDice) +
-                       rollDiceListSum(rng, pc.defenseDice) +
-                       rollDiceListSum(rng, pb.defenseDice);
-      int flatRed    = ph.flatDefBonus + pc.flatDefBonus + pb.flatDefBonus;
-
-      int dmg = computeDamage(base, enemy.getAttack(), atkDiceSum,
-                              player.getDefense(), flatRed, defDiceSum);
-      player.takeDamage(dmg);
-
-      std::ostringstream os;
-      os << "Enemy attack: d6=" << base
-         << " + atk=" << enemy.getAttack()
-         << " + w=" << atkDiceSum
-         << "  vs  def=" << player.getDefense()
-         << " + flat=" << flatRed
-         << " + arm=" << defDiceSum
-         << " -> " << dmg << " dmg.";
-      lastMessage = os.str();
+#include "CombatResolver.h"
+
+CombatTask::CombatTask(Rng& rng, Player& player, EntityStore& actors, EntityHandle enemy,
+                       MessageLog& log, bool& running, bool advance, int ax, int ay)
+: rng(rng), player(player), actors(actors), enemy(enemy), log(log),
+  running(running), advance(advance), ax(ax), ay(ay),
+  order(player.getSpeed(), actors.getSpeed(enemy)) {}
+
+Task::Wait CombatTask::step() {
+  for (;;) {
+    switch (phase) {
+      case Phase::Start:
+        playerTurn = order.playerNext();
+        log.push(playerTurn ? MsgId::CombatYouFirst : MsgId::CombatEnemyFirst);
+        indicator = true;
+        phase = Phase::Announce;
+        return Wait::Key;
+
+      case Phase::Announce:
+        // another fight may have ended this one while we waited
+        if (!player.isAlive() || !actors.valid(enemy) || !actors.isAlive(enemy)) return Wait::Done;
+        log.push(playerTurn ? MsgId::YouRoll : MsgId::EnemyRolls, {}, true);
+        indicator = true;
+        delayMs = kRollDelayMs;
+        phase = Phase::Roll;
+        return Wait::Delay;
+
+      case Phase::Roll:
+        if (!player.isAlive() || !actors.valid(enemy) || !actors.isAlive(enemy)) return Wait::Done;
+        if (playerTurn) {
+          auto r = combat::resolveAttack(rng, combat::fromPlayer(player),
+                                         combat::fromEntity(actors, enemy));
+          actors.takeDamage(enemy, r.dmg);
+          log.push(MsgId::YouHit, { r.base, player.getAttack(), r.atkDice,
+                                    actors.getDefense(enemy), r.flat, r.defDice, r.dmg });
+          turnPassed = true;
+        } else {
+          auto r = combat::resolveAttack(rng, combat::fromEntity(actors, enemy),
+                                         combat::fromPlayer(player));
+          player.takeDamage(r.dmg);
+          log.push(MsgId::EnemyHits, { r.base, actors.getAttack(enemy), r.atkDice,
+                                       player.getDefense(), r.flat, r.defDice, r.dmg });
+        }
+        indicator = true;
+        phase = Phase::Result;
+        return Wait::Key;
+
+      case Phase::Result:
+        if (!player.isAlive()) {
+          log.push(MsgId::YouDied);
+          indicator = true;
+          phase = Phase::Died;
+          return Wait::Key;
+        }
+        if (!actors.isAlive(enemy)) {
+          log.push(MsgId::Victory);
+          indicator = false;
+          if (advance && running) player.setPos(ax, ay);
+          return Wait::Done;
+        }
+        playerTurn = order.playerNext();
+        phase = Phase::Announce;
+        break;
+
+      case Phase::Died:
+        running = false;
+        return Wait::Done;
     }
-
-    ui.renderFrame(map, player, enemy, npc, lastMessage, /*indicator*/true);
-    wait_key_and_restore_timeout();
-
-    if (!player.isAlive() || !enemy.isAlive()) break;
-    playerTurn = !playerTurn;
   }
-
-  if (!player.isAlive()) {
-    lastMessage = "You died! Press any key to exit.";
-    ui.renderFrame(map, player, enemy, npc, lastMessage, true);
-    wait_key_and_restore_timeout();
-    running = false;
-    return;
-  }
-
-  lastMessage = "You defeated the enemy! (+Victory)";
-  ui.renderFrame(map, player, enemy, npc, lastMessage, false);
 }
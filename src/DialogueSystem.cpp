@@ -1,20 +1,21 @@
 #include "DialogueSystem.h"
 
-void DialogueSystem::run(const NPC& npc, Map& map,
-                         const Player& player, const Enemy& enemy,
-                         Ui& ui, std::string& lastMessage) {
-  nodelay(stdscr, FALSE);
-
-  const auto& lines = npc.getDialog();
-  for (size_t i = 0; i < lines.size(); ++i) {
-    lastMessage = "[NPC] " + lines[i];
-    ui.renderFrame(map, player, enemy, npc, lastMessage, i == 0); // indicator only on first
-    getch();
+Task::Wait DialogueTask::step() {
+  static const std::vector<std::string> none;
+  // looked up on every step: the table may grow while we wait
+  const auto& lines = actors.valid(npc) ? actors.getDialog(npc) : none;
+  if (line < lines.size()) {
+    log.push(MsgId::NpcSays, lines[line]);
+    indicator = (line == 0);
+    ++line;
+    return Wait::Key;
   }
-
-  lastMessage = "You talked to the NPC.";
-  ui.renderFrame(map, player, enemy, npc, lastMessage, false);
-  getch();
-
-  nodelay(stdscr, TRUE);
+  if (line == lines.size()) {
+    log.push(MsgId::TalkDone);
+    indicator = false;
+    ++line;
+    return Wait::Key;
+  }
+  player.setPos(ax, ay);
+  return Wait::Done;
 }
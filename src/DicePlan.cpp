@@ -0,0 +1,226 @@
+#include "DicePlan.h"
+#include "Rng.h"
+#include <algorithm>
+#include <cctype>
+
+static constexpr long kMaxCount = 1000;
+static constexpr long kMaxSides = 10000;
+static constexpr long kMaxConstant = 1000000;
+
+// One roll of a modified term; draw() gives a 0-based face.
+template <class Draw>
+static int rollModified(const DiceTerm& t, Draw&& draw) {
+  if (t.mode == DiceTerm::Explode) {
+    int sum = 0;
+    for (int d = 0; d < t.count; ++d)
+      for (int r = 0; ; ++r) {
+        const int face = 1 + (int)draw();
+        sum += face;
+        if (face != t.sides || r == DicePlan::kMaxExplode) break;
+      }
+    return sum;
+  }
+  // Track whichever side is smaller, the kept dice or the dropped ones, in
+  // a short sorted list updated with min/max only (no branches to miss).
+  const int drop = t.count - t.keep;
+  const bool trackKept = t.keep <= drop;
+  const int m = trackKept ? t.keep : drop;
+  const bool large = (t.mode == DiceTerm::KeepHigh) == trackKept;
+  int ext[DicePlan::kMaxPool];
+  std::fill(ext, ext + m, large ? 0 : t.sides + 1);
+  int total = 0;
+  for (int d = 0; d < t.count; ++d) {
+    int x = 1 + (int)draw();
+    total += x;
+    for (int j = 0; j < m; ++j) {
+      const int keepHere = large ? std::max(ext[j], x) : std::min(ext[j], x);
+      x = large ? std::min(ext[j], x) : std::max(ext[j], x);
+      ext[j] = keepHere;
+    }
+  }
+  int sum = 0;
+  for (int j = 0; j < m; ++j) sum += ext[j];
+  return trackKept ? sum : total - sum;
+}
+
+static int rollTerm(Rng& rng, const DiceTerm& t) {
+  if (t.mode == DiceTerm::Plain) return rng.rollDice(t.count, t.sides);
+  return rollModified(t, [&] { return rng.bounded((uint32_t)t.sides); });
+}
+
+bool DicePlan::add(const DiceTerm& in) {
+  DiceTerm t = in;
+  if (t.mode != DiceTerm::Plain && t.mode != DiceTerm::Explode) {
+    if (t.keep <= 0) return true;                 // keeps nothing
+    if (t.keep >= t.count) t.mode = DiceTerm::Plain;
+  }
+  if (t.count <= 0) return true;
+  if (t.sides == 1) {                             // every die shows 1
+    bias += t.sign * (t.mode == DiceTerm::Plain ? t.count : t.keep);
+    return true;
+  }
+  if (terms > 0) {
+    DiceTerm& last = parts[terms - 1];
+    if (t.mode == DiceTerm::Plain && last.mode == DiceTerm::Plain &&
+        last.sides == t.sides && last.sign == t.sign && last.count + t.count <= kMaxCount) {
+      last.count += t.count;
+      return true;
+    }
+  }
+  if (terms == kMaxTerms) return false;
+  parts[terms++] = t;
+  return true;
+}
+
+bool DicePlan::compile(const std::string& text, DicePlan& out, std::string& err) {
+  DicePlan plan;
+  const size_t n = text.size();
+  size_t i = 0;
+  long bias = 0;
+
+  auto fail = [&](const std::string& msg) {
+    err = "dice '" + text + "': " + msg;
+    return false;
+  };
+  auto skipSpace = [&] { while (i < n && std::isspace((unsigned char)text[i])) ++i; };
+  auto number = [&](long& v) {
+    if (i >= n || !std::isdigit((unsigned char)text[i])) return false;
+    v = 0;
+    while (i < n && std::isdigit((unsigned char)text[i])) {
+      v = v * 10 + (text[i++] - '0');
+      if (v > kMaxConstant) v = kMaxConstant + 1;   // rejected below
+    }
+    return true;
+  };
+  auto lower = [&](size_t k) { return k < n ? (char)std::tolower((unsigned char)text[k]) : '\0'; };
+
+  skipSpace();
+  if (i == n) { out = plan; return true; }
+
+  int sign = 1;
+  if (text[i] == '-') { sign = -1; ++i; }
+  else if (text[i] == '+') ++i;
+
+  for (;;) {
+    skipSpace();
+    long count = 1;
+    const bool haveCount = number(count);
+    if (lower(i) == 'd') {
+      ++i;
+      long sides = 0;
+      if (!number(sides)) return fail("missing die size");
+      if (count > kMaxCount) return fail("too many dice");
+      if (sides < 1 || sides > kMaxSides) return fail("die size out of range");
+      DiceTerm t;
+      t.count = (int32_t)count;
+      t.sides = (int32_t)sides;
+      t.sign = (int8_t)sign;
+      for (;;) {
+        if (i < n && text[i] == '!') {
+          if (t.mode != DiceTerm::Plain) return fail("'!' cannot be combined with keep");
+          if (sides == 1) return fail("a d1 cannot explode");
+          t.mode = DiceTerm::Explode;
+          ++i;
+        } else if (lower(i) == 'k') {
+          if (t.mode != DiceTerm::Plain) return fail("one modifier per term");
+          ++i;
+          t.mode = DiceTerm::KeepHigh;
+          if (lower(i) == 'h') ++i;
+          else if (lower(i) == 'l') { t.mode = DiceTerm::KeepLow; ++i; }
+          long keep = 0;
+          if (!number(keep)) return fail("keep needs a count");
+          if (count > kMaxPool) return fail("at most " + std::to_string(kMaxPool) + " dice with keep");
+          t.keep = (int16_t)std::min(keep, count);
+        } else {
+          break;
+        }
+      }
+      if (!plan.add(t)) return fail("too many terms");
+    } else if (haveCount) {
+      if (count > kMaxConstant) return fail("constant out of range");
+      bias += sign * count;
+      if (bias > kMaxConstant || bias < -kMaxConstant) return fail("constant out of range");
+    } else {
+      return fail(i < n ? std::string("unexpected '") + text[i] + "'" : "expression ends early");
+    }
+
+    skipSpace();
+    if (i == n) break;
+    if (text[i] == '+' || text[i] == ',') sign = 1;
+    else if (text[i] == '-') sign = -1;
+    else return fail(std::string("unexpected '") + text[i] + "'");
+    ++i;
+  }
+
+  plan.bias += (int32_t)bias;
+  out = plan;
+  return true;
+}
+
+DicePlan DicePlan::dice(int count, int sides) {
+  DicePlan plan;
+  if (count > 0 && sides > 0) {
+    DiceTerm t;
+    t.count = count;
+    t.sides = sides;
+    plan.add(t);
+  }
+  return plan;
+}
+
+int DicePlan::roll(Rng& rng) const {
+  int sum = bias;
+  for (int k = 0; k < terms; ++k) sum += parts[k].sign * rollTerm(rng, parts[k]);
+  return sum;
+}
+
+void DicePlan::rollMany(Rng& rng, int* out, size_t n) const {
+  std::fill(out, out + n, (int)bias);
+  for (int k = 0; k < terms; ++k) {
+    const DiceTerm& t = parts[k];
+    if (t.mode == DiceTerm::Plain) {
+      for (size_t i = 0; i < n; ++i) out[i] += t.sign * rng.rollDice(t.count, t.sides);
+    } else {
+      for (size_t i = 0; i < n; ++i) out[i] += t.sign * rollTerm(rng, t);
+    }
+  }
+}
+
+void DicePlan::rollMany(RngBatch& batch, int* out, size_t n) const {
+  std::fill(out, out + n, (int)bias);
+  constexpr size_t kChunk = 256;
+  int tmp[kChunk];
+  for (int k = 0; k < terms; ++k) {
+    const DiceTerm& t = parts[k];
+    if (t.mode == DiceTerm::Plain) {
+      for (size_t i = 0; i < n; i += kChunk) {
+        const size_t m = std::min(kChunk, n - i);
+        batch.roll(tmp, m, t.count, t.sides);
+        for (size_t j = 0; j < m; ++j) out[i + j] += t.sign * tmp[j];
+      }
+    } else {
+      auto draw = [&] {
+        uint32_t face;
+        batch.bounded(&face, 1, (uint32_t)t.sides);
+        return face;
+      };
+      for (size_t i = 0; i < n; ++i) out[i] += t.sign * rollModified(t, draw);
+    }
+  }
+}
+
+std::string DicePlan::toString() const {
+  std::string s;
+  for (int k = 0; k < terms; ++k) {
+    const DiceTerm& t = parts[k];
+    if (t.sign < 0) s += '-';
+    else if (!s.empty()) s += '+';
+    s += std::to_string(t.count) + "d" + std::to_string(t.sides);
+    if (t.mode == DiceTerm::KeepHigh) s += "kh" + std::to_string(t.keep);
+    if (t.mode == DiceTerm::KeepLow)  s += "kl" + std::to_string(t.keep);
+    if (t.mode == DiceTerm::Explode)  s += '!';
+  }
+  if (bias > 0 && !s.empty()) s += '+';
+  if (bias != 0) s += std::to_string(bias);
+  return s;
+}
@@ -0,0 +1,314 @@
+#include "DungeonGenerator.h"
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <atomic>
+#include <thread>
+#include "Profiler.h"
+#include "Rng.h"
+
+namespace {
+
+constexpr uint8_t kRock  = (uint8_t)Tile::Void;
+constexpr uint8_t kFloor = (uint8_t)Tile::Floor;
+constexpr uint8_t kWall  = (uint8_t)Tile::Wall;
+
+// Whole-map byte grid; regions write disjoint rectangles of it.
+struct Grid {
+  int w, h;
+  std::vector<uint8_t> t;
+  Grid(int w, int h) : w(w), h(h), t((size_t)w * h, kRock) {}
+  uint8_t& at(int x, int y) { return t[(size_t)y * w + x]; }
+  uint8_t  at(int x, int y) const { return t[(size_t)y * w + x]; }
+  bool inside(int x, int y) const { return x >= 0 && y >= 0 && x < w && y < h; }
+};
+
+struct Rect { int x0, y0, x1, y1; };   // inclusive interior bounds
+
+void carveRoom(Grid& g, const Room& r) {
+  for (int y = r.y; y < r.y + r.h; ++y)
+    for (int x = r.x; x < r.x + r.w; ++x) g.at(x, y) = kFloor;
+}
+
+// L-shaped corridor, clipped to `clip`.
+void carveCorridor(Grid& g, int ax, int ay, int bx, int by, bool horizFirst, const Rect& clip) {
+  auto put = [&](int x, int y) {
+    if (x >= clip.x0 && x <= clip.x1 && y >= clip.y0 && y <= clip.y1) g.at(x, y) = kFloor;
+  };
+  int x = ax, y = ay;
+  auto walkX = [&] { while (x != bx) { put(x, y); x += (bx > x) ? 1 : -1; } };
+  auto walkY = [&] { while (y != by) { put(x, y); y += (by > y) ? 1 : -1; } };
+  if (horizFirst) { walkX(); walkY(); } else { walkY(); walkX(); }
+  put(bx, by);
+}
+
+// --- BSP rooms ---
+void bsp(Grid& g, const Rect& area, const Rect& clip, Rng& rng, std::vector<Room>& rooms,
+         int& outX, int& outY) {
+  const int aw = area.x1 - area.x0 + 1, ah = area.y1 - area.y0 + 1;
+  const int minLeaf = 10;
+  const bool canSplitX = aw >= 2 * minLeaf, canSplitY = ah >= 2 * minLeaf;
+
+  if (!canSplitX && !canSplitY) {
+    // leaf: one room with a 1-tile margin
+    Room r;
+    r.w = 3 + (int)rng.bounded((uint32_t)std::max(1, aw - 4));
+    r.h = 3 + (int)rng.bounded((uint32_t)std::max(1, ah - 4));
+    r.w = std::min(r.w, aw - 2); r.h = std::min(r.h, ah - 2);
+    r.x = area.x0 + 1 + (int)rng.bounded((uint32_t)std::max(1, aw - r.w - 1));
+    r.y = area.y0 + 1 + (int)rng.bounded((uint32_t)std::max(1, ah - r.h - 1));
+    r.anchorX = r.x + r.w / 2;
+    r.anchorY = r.y + r.h / 2;
+    carveRoom(g, r);
+    rooms.push_back(r);
+    outX = r.anchorX; outY = r.anchorY;
+    return;
+  }
+
+  bool splitX = canSplitX && (!canSplitY || (aw >= ah ? rng.bounded(4) != 0 : rng.bounded(4) == 0));
+  Rect a = area, b = area;
+  if (splitX) {
+    int cut = area.x0 + minLeaf + (int)rng.bounded((uint32_t)(aw - 2 * minLeaf + 1));
+    a.x1 = cut - 1; b.x0 = cut;
+  } else {
+    int cut = area.y0 + minLeaf + (int)rng.bounded((uint32_t)(ah - 2 * minLeaf + 1));
+    a.y1 = cut - 1; b.y0 = cut;
+  }
+  int ax, ay, bx, by;
+  bsp(g, a, clip, rng, rooms, ax, ay);
+  bsp(g, b, clip, rng, rooms, bx, by);
+  carveCorridor(g, ax, ay, bx, by, rng.bounded(2) == 0, clip);
+  outX = ax; outY = ay;
+}
+
+// --- cellular-automata cave ---
+void cave(Grid& g, const Rect& area, Rng& rng, std::vector<Room>& rooms,
+          std::vector<uint8_t>& a, std::vector<uint8_t>& b) {
+  const int w = area.x1 - area.x0 + 1, h = area.y1 - area.y0 + 1;
+  a.assign((size_t)w * h, 0);
+  b.assign((size_t)w * h, 0);
+  for (int y = 1; y < h - 1; ++y)
+    for (int x = 1; x < w - 1; ++x)
+      a[(size_t)y * w + x] = rng.bounded(100) < 55 ? 1 : 0;   // 1 = floor
+
+  for (int it = 0; it < 5; ++it) {
+    for (int y = 0; y < h; ++y)
+      for (int x = 0; x < w; ++x) {
+        if (x == 0 || y == 0 || x == w - 1 || y == h - 1) { b[(size_t)y * w + x] = 0; continue; }
+        int walls = 0;
+        for (int dy = -1; dy <= 1; ++dy)
+          for (int dx = -1; dx <= 1; ++dx)
+            walls += a[(size_t)(y + dy) * w + (x + dx)] == 0;
+        b[(size_t)y * w + x] = walls < 5 ? 1 : 0;
+      }
+    a.swap(b);
+  }
+
+  // keep only the largest connected pocket (b reused as a visited mark)
+  std::fill(b.begin(), b.end(), 0);
+  std::vector<int> stack;
+  int bestSize = 0, bestSeed = -1;
+  for (int i = 0; i < w * h; ++i) {
+    if (!a[i] || b[i]) continue;
+    int size = 0;
+    stack.assign(1, i);
+    b[i] = 1;
+    while (!stack.empty()) {
+      int c = stack.back(); stack.pop_back(); ++size;
+      const int cx = c % w, cy = c / w;
+      const int nb[4] = { c - 1, c + 1, c - w, c + w };
+      const bool ok[4] = { cx > 0, cx < w - 1, cy > 0, cy < h - 1 };
+      for (int k = 0; k < 4; ++k)
+        if (ok[k] && a[nb[k]] && !b[nb[k]]) { b[nb[k]] = 1; stack.push_back(nb[k]); }
+    }
+    if (size > bestSize) { bestSize = size; bestSeed = i; }
+  }
+  if (bestSeed < 0) return;   // nothing survived: the caller falls back to rooms
+
+  Room r;
+  r.cave = true;
+  r.x = area.x1; r.y = area.y1; int rx1 = area.x0, ry1 = area.y0;
+  // flood the winner again, copying it into the grid
+  std::fill(b.begin(), b.end(), 0);
+  stack.assign(1, bestSeed);
+  b[bestSeed] = 1;
+  while (!stack.empty()) {
+    int c = stack.back(); stack.pop_back();
+    const int cx = c % w, cy = c / w;
+    const int gx = area.x0 + cx, gy = area.y0 + cy;
+    g.at(gx, gy) = kFloor;
+    r.x = std::min(r.x, gx); r.y = std::min(r.y, gy);
+    rx1 = std::max(rx1, gx); ry1 = std::max(ry1, gy);
+    const int nb[4] = { c - 1, c + 1, c - w, c + w };
+    const bool ok[4] = { cx > 0, cx < w - 1, cy > 0, cy < h - 1 };
+    for (int k = 0; k < 4; ++k)
+      if (ok[k] && a[nb[k]] && !b[nb[k]]) { b[nb[k]] = 1; stack.push_back(nb[k]); }
+  }
+  r.w = rx1 - r.x + 1; r.h = ry1 - r.y + 1;
+  r.anchorX = area.x0 + bestSeed % w;
+  r.anchorY = area.y0 + bestSeed / w;
+  rooms.push_back(r);
+}
+
+// Rock next to floor in `src` becomes wall in `dst`, inside `clip` only.
+// Reading a separate grid lets neighbouring clips run at the same time.
+void outline(const Grid& src, Grid& dst, const Rect& clip) {
+  for (int y = clip.y0; y <= clip.y1; ++y)
+    for (int x = clip.x0; x <= clip.x1; ++x) {
+      if (src.at(x, y) != kRock) continue;
+      for (int dy = -1; dy <= 1; ++dy)
+        for (int dx = -1; dx <= 1; ++dx) {
+          const int nx = x + dx, ny = y + dy;
+          if (src.inside(nx, ny) && src.at(nx, ny) == kFloor) { dst.at(x, y) = kWall; dx = dy = 2; }
+        }
+    }
+}
+
+struct RegionOut {
+  std::vector<Room> rooms;
+  int portX = -1, portY = -1;   // where inter-region corridors attach
+};
+
+} // namespace
+
+Map generateDungeon(const DungeonConfig& cfg, DungeonLayout& layout) {
+  ProfileScope scope("generateDungeon");
+  const int W = std::max(8, cfg.width), H = std::max(8, cfg.height);
+  const int rs = std::max(Map::kChunkSize,
+                          (cfg.regionSize + Map::kChunkMask) & ~Map::kChunkMask);
+  const int rx = (W + rs - 1) / rs, ry = (H + rs - 1) / rs;
+  const int regions = rx * ry;
+
+  Grid g(W, H);
+  std::vector<RegionOut> outs(regions);
+  const Rng root(cfg.seed);
+
+  // --- 1. regions in parallel (disjoint rectangles, one stream each) ---
+  auto regionRect = [&](int r) {
+    const int gx = r % rx, gy = r / rx;
+    Rect a{ gx * rs, gy * rs, std::min(W, (gx + 1) * rs) - 1, std::min(H, (gy + 1) * rs) - 1 };
+    return a;
+  };
+  auto work = [&](int r) {
+    ProfileScope regionScope("generateDungeon/region");
+    Rng rng = root.split((uint64_t)r);
+    Rect area = regionRect(r);
+    // keep the outer map border solid
+    Rect inner{ std::max(area.x0, 1), std::max(area.y0, 1),
+                std::min(area.x1, W - 2), std::min(area.y1, H - 2) };
+    if (inner.x1 - inner.x0 < 6 || inner.y1 - inner.y0 < 6) return;
+    RegionOut& o = outs[r];
+    std::vector<uint8_t> a, b;
+    if ((int)rng.bounded(100) < cfg.cavePercent) cave(g, inner, rng, o.rooms, a, b);
+    if (o.rooms.empty()) {
+      int px, py;
+      bsp(g, inner, inner, rng, o.rooms, px, py);
+    }
+    o.portX = o.rooms.front().anchorX;
+    o.portY = o.rooms.front().anchorY;
+  };
+
+  unsigned threads = cfg.threads ? cfg.threads : std::thread::hardware_concurrency();
+  threads = std::max(1u, std::min<unsigned>(threads, (unsigned)regions));
+  std::atomic<int> nextRegion{ 0 };
+  auto worker = [&] { for (int r; (r = nextRegion.fetch_add(1)) < regions; ) work(r); };
+  std::vector<std::thread> pool;
+  for (unsigned t = 1; t < threads; ++t) pool.emplace_back(worker);
+  worker();
+  for (auto& th : pool) th.join();
+
+  // --- 2. stitch neighbouring regions (serial, fixed order) ---
+  Rect all{ 1, 1, W - 2, H - 2 };
+  Rng stitch = root.split(0x5717C4ull);
+  for (int r = 0; r < regions; ++r) {
+    if (outs[r].portX < 0) continue;
+    const int gx = r % rx, gy = r / rx;
+    const int right = (gx + 1 < rx) ? r + 1 : -1;
+    const int down  = (gy + 1 < ry) ? r + rx : -1;
+    for (int n : { right, down }) {
+      if (n < 0 || outs[n].portX < 0) continue;
+      carveCorridor(g, outs[r].portX, outs[r].portY, outs[n].portX, outs[n].portY,
+                    stitch.bounded(2) == 0, all);
+    }
+  }
+
+  layout = DungeonLayout();
+  for (auto& o : outs)
+    layout.rooms.insert(layout.rooms.end(), o.rooms.begin(), o.rooms.end());
+  if (layout.rooms.empty()) {
+    // degenerate size: fall back to one room
+    Room r; r.x = 1; r.y = 1; r.w = W - 2; r.h = H - 2;
+    r.anchorX = W / 2; r.anchorY = H / 2;
+    carveRoom(g, r);
+    layout.rooms.push_back(r);
+  }
+
+  // --- 3. connectivity: flood from the spawn, repair unreachable rooms ---
+  layout.spawnRoom = 0;
+  layout.spawnX = layout.rooms[0].anchorX;
+  layout.spawnY = layout.rooms[0].anchorY;
+
+  std::vector<uint8_t> reached((size_t)W * H, 0);
+  std::vector<int> queue;
+  auto flood = [&](int sx, int sy) {
+    const size_t s = (size_t)sy * W + sx;
+    if (reached[s] || g.t[s] != kFloor) return;
+    reached[s] = 1;
+    queue.assign(1, (int)s);
+    while (!queue.empty()) {
+      const int c = queue.back(); queue.pop_back();
+      const int nb[4] = { c - 1, c + 1, c - W, c + W };
+      for (int n : nb)
+        if (n >= 0 && n < W * H && !reached[n] && g.t[n] == kFloor) { reached[n] = 1; queue.push_back(n); }
+    }
+  };
+  flood(layout.spawnX, layout.spawnY);
+  for (size_t i = 0; i < layout.rooms.size(); ++i) {
+    const Room& room = layout.rooms[i];
+    if (reached[(size_t)room.anchorY * W + room.anchorX]) continue;
+    // nearest reachable room anchor
+    int best = 0, bestD = INT32_MAX;
+    for (size_t j = 0; j < layout.rooms.size(); ++j) {
+      const Room& o = layout.rooms[j];
+      if (!reached[(size_t)o.anchorY * W + o.anchorX]) continue;
+      const int d = std::abs(o.anchorX - room.anchorX) + std::abs(o.anchorY - room.anchorY);
+      if (d < bestD) { bestD = d; best = (int)j; }
+    }
+    carveCorridor(g, room.anchorX, room.anchorY,
+                  layout.rooms[best].anchorX, layout.rooms[best].anchorY, true, all);
+    ++layout.repairs;
+    // the corridor ends on reached floor: flooding from the room adds it
+    flood(room.anchorX, room.anchorY);
+  }
+
+  // --- 4. walls around floor, per region in parallel ---
+  // Each region writes its own rect of `g` but looks one tile into its
+  // neighbours, so everyone reads the finished floor plan from a copy.
+  const Grid plan = g;
+  nextRegion = 0;
+  auto wallWorker = [&] {
+    for (int r; (r = nextRegion.fetch_add(1)) < regions; ) outline(plan, g, regionRect(r));
+  };
+  pool.clear();
+  for (unsigned t = 1; t < threads; ++t) pool.emplace_back(wallWorker);
+  wallWorker();
+  for (auto& th : pool) th.join();
+
+  // --- 5. copy into the chunked map (all-rock chunks stay unallocated) ---
+  Map map(W, H, false);
+  for (int y = 0; y < H; ++y) {
+    const uint8_t* row = &g.t[(size_t)y * W];
+    for (int x = 0; x < W; ++x)
+      if (row[x] != kRock) map.setTile(x, y, (Tile)row[x]);
+  }
+  return map;
+}
+
+void randomRoomTile(const Map& map, const Room& room, Rng& rng, int& x, int& y) {
+  for (int tries = 0; tries < 64; ++tries) {
+    const int tx = room.x + (int)rng.bounded((uint32_t)std::max(1, room.w));
+    const int ty = room.y + (int)rng.bounded((uint32_t)std::max(1, room.h));
+    if (map.isWalkable(tx, ty)) { x = tx; y = ty; return; }
+  }
+  x = room.anchorX; y = room.anchorY;
+}
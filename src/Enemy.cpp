@@ -17,6 +17,16 @@ bool Enemy::isAlive() const { return alive; }
 
 void Enemy::setPos(int nx, int ny) { x = nx; y = ny; }
 
+void Enemy::equip(ItemId id) {
+    if (id == kNoItem) return;
+    switch (ItemRegistry::global().get(id).slot) {
+        case EquipSlot::Weapon: weapon = id; break;
+        case EquipSlot::Helmet: helmet = id; break;
+        case EquipSlot::Chest:  chest  = id; break;
+        case EquipSlot::Boots:  break;   // enemies wear no boots
+    }
+}
+
 void Enemy::takeDamage(int dmg) {
     if (!alive) return;
     hp -= dmg;
@@ -0,0 +1,212 @@
+#include "EntityStore.h"
+#include <algorithm>
+
+EntityHandle EntityStore::allocate() {
+  uint32_t s;
+  if (freeHead != kFree) {
+    s = freeHead;
+    freeHead = slots[s].nextFree;
+  } else {
+    s = (uint32_t)slots.size();
+    slots.emplace_back();
+  }
+  slots[s].dense = (uint32_t)kind.size();
+  slots[s].nextFree = kFree;
+  markBookkeeping(s);
+
+  denseSlot.push_back(s);
+  kind.push_back(EntityKind::Enemy);
+  xs.push_back(0); ys.push_back(0);
+  hp.push_back(0); speed.push_back(0); attack.push_back(0); defense.push_back(0);
+  alive.push_back(1);
+  weapon.push_back(kNoItem); helmet.push_back(kNoItem); chest.push_back(kNoItem);
+  dialog.push_back(0);
+  return { s, slots[s].gen };
+}
+
+EntityHandle EntityStore::spawnEnemy(const Enemy& proto) {
+  EntityHandle h = allocate();
+  const uint32_t i = d(h);
+  kind[i]    = EntityKind::Enemy;
+  xs[i]      = proto.getX();
+  ys[i]      = proto.getY();
+  hp[i]      = proto.getHP();
+  speed[i]   = proto.getSpeed();
+  attack[i]  = proto.getAttack();
+  defense[i] = proto.getDefense();
+  alive[i]   = proto.isAlive() ? 1 : 0;
+  weapon[i]  = proto.weaponId();
+  helmet[i]  = proto.helmetId();
+  chest[i]   = proto.chestId();
+  index.insert(h.slot, xs[i], ys[i]);
+  markDirty(h.slot);
+  return h;
+}
+
+EntityHandle EntityStore::spawnNPC(const NPC& proto) {
+  EntityHandle h = allocate();
+  const uint32_t i = d(h);
+  kind[i]   = EntityKind::NPC;
+  xs[i]     = proto.getX();
+  ys[i]     = proto.getY();
+  dialog[i] = internDialog(proto.getDialog());
+  index.insert(h.slot, xs[i], ys[i]);
+  markDirty(h.slot);
+  return h;
+}
+
+void EntityStore::despawn(EntityHandle h) {
+  if (!valid(h)) return;
+  index.remove(h.slot);
+  const uint32_t hole = d(h);
+  const uint32_t last = (uint32_t)kind.size() - 1;
+
+  if (hole != last) {
+    // move the last entity into the hole
+    denseSlot[hole] = denseSlot[last];
+    kind[hole] = kind[last];
+    xs[hole] = xs[last]; ys[hole] = ys[last];
+    hp[hole] = hp[last]; speed[hole] = speed[last];
+    attack[hole] = attack[last]; defense[hole] = defense[last];
+    alive[hole] = alive[last];
+    weapon[hole] = weapon[last]; helmet[hole] = helmet[last]; chest[hole] = chest[last];
+    dialog[hole] = dialog[last];
+    slots[denseSlot[hole]].dense = hole;
+    markBookkeeping(denseSlot[hole]);
+  }
+  denseSlot.pop_back(); kind.pop_back();
+  xs.pop_back(); ys.pop_back();
+  hp.pop_back(); speed.pop_back(); attack.pop_back(); defense.pop_back();
+  alive.pop_back();
+  weapon.pop_back(); helmet.pop_back(); chest.pop_back();
+  dialog.pop_back();
+
+  Slot& s = slots[h.slot];
+  s.dense = kFree;
+  ++s.gen;                 // invalidates outstanding handles
+  s.nextFree = freeHead;
+  freeHead = h.slot;
+  markBookkeeping(h.slot);
+}
+
+void EntityStore::clear() {
+  while (size() > 0) despawn(handleAt(size() - 1));
+}
+
+void EntityStore::reserve(size_t n) {
+  slots.reserve(n); denseSlot.reserve(n); kind.reserve(n);
+  xs.reserve(n); ys.reserve(n);
+  hp.reserve(n); speed.reserve(n); attack.reserve(n); defense.reserve(n);
+  alive.reserve(n);
+  weapon.reserve(n); helmet.reserve(n); chest.reserve(n);
+  dialog.reserve(n);
+}
+
+EntityHandle EntityStore::at(int x, int y) const {
+  const int cx = SpatialIndex::cellOf(x), cy = SpatialIndex::cellOf(y);
+  for (uint32_t s = index.first(cx, cy); s != SpatialIndex::kNone; s = index.next(s)) {
+    const uint32_t i = slots[s].dense;
+    if (xs[i] == x && ys[i] == y && alive[i]) return { s, slots[s].gen };
+  }
+  return {};
+}
+
+void EntityStore::takeDamage(EntityHandle h, int dmg) {
+  const uint32_t i = d(h);
+  if (!alive[i]) return;
+  hp[i] -= dmg;
+  if (hp[i] <= 0) { hp[i] = 0; alive[i] = 0; }
+  markDirty(h.slot);
+}
+
+EntityStore::Record EntityStore::recordAt(size_t i) const {
+  Record r;
+  r.kind = kind[i]; r.alive = alive[i]; r.dialog = dialog[i];
+  r.x = xs[i]; r.y = ys[i];
+  r.hp = hp[i]; r.speed = speed[i]; r.attack = attack[i]; r.defense = defense[i];
+  r.weapon = weapon[i]; r.helmet = helmet[i]; r.chest = chest[i];
+  return r;
+}
+
+void EntityStore::restore(std::vector<Slot> slotTable, uint32_t freeList,
+                          const std::vector<uint32_t>& denseOrder,
+                          const std::vector<Record>& records,
+                          const std::vector<uint32_t>& insertOrder,
+                          std::vector<std::vector<std::string>> dialogLines) {
+  const size_t n = std::min(denseOrder.size(), records.size());
+  slots = std::move(slotTable);
+  freeHead = freeList;
+  denseSlot.assign(denseOrder.begin(), denseOrder.begin() + n);
+  kind.resize(n); xs.resize(n); ys.resize(n);
+  hp.resize(n); speed.resize(n); attack.resize(n); defense.resize(n);
+  alive.resize(n); weapon.resize(n); helmet.resize(n); chest.resize(n); dialog.resize(n);
+  index.clear();
+  for (size_t i = 0; i < n; ++i) {
+    const Record& r = records[i];
+    kind[i] = r.kind; alive[i] = r.alive; dialog[i] = r.dialog;
+    xs[i] = r.x; ys[i] = r.y;
+    hp[i] = r.hp; speed[i] = r.speed; attack[i] = r.attack; defense[i] = r.defense;
+    weapon[i] = r.weapon; helmet[i] = r.helmet; chest[i] = r.chest;
+  }
+  for (uint32_t s : insertOrder)
+    if (s < slots.size() && slots[s].dense < n)
+      index.insert(s, xs[slots[s].dense], ys[slots[s].dense]);
+  dialogs = std::move(dialogLines);
+  dirtyFlag.assign(slots.size(), 0);
+  dirtyList.clear();
+  bookFlag.assign(slots.size(), 0);
+  bookList.clear();
+  index.clearTouched();
+}
+
+std::vector<uint64_t> EntityStore::indexBuckets() const {
+  std::vector<uint64_t> keys;
+  for (size_t i = 0; i < size(); ++i) {
+    const int cx = SpatialIndex::cellOf(xs[i]), cy = SpatialIndex::cellOf(ys[i]);
+    if (index.first(cx, cy) == denseSlot[i]) keys.push_back(SpatialIndex::key(cx, cy));
+  }
+  return keys;
+}
+
+std::vector<uint64_t> EntityStore::dirtyBuckets() const {
+  std::vector<uint64_t> keys = index.touchedBuckets();
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+  return keys;
+}
+
+void EntityStore::bucketChain(uint64_t bucket, std::vector<uint32_t>& out) const {
+  // insert() links at the head, so the chain goes in tail first
+  out.clear();
+  for (uint32_t s = index.firstIn(bucket); s != SpatialIndex::kNone; s = index.next(s))
+    out.push_back(s);
+  std::reverse(out.begin(), out.end());
+}
+
+void EntityStore::clearDirty() {
+  for (uint32_t s : dirtyList) dirtyFlag[s] = 0;
+  dirtyList.clear();
+  for (uint32_t s : bookList) bookFlag[s] = 0;
+  bookList.clear();
+  index.clearTouched();
+}
+
+uint16_t EntityStore::internDialog(const std::vector<std::string>& lines) {
+  for (size_t i = 0; i < dialogs.size(); ++i)
+    if (dialogs[i] == lines) return (uint16_t)i;
+  dialogs.push_back(lines);
+  return (uint16_t)(dialogs.size() - 1);
+}
+
+const std::vector<std::string>& EntityStore::getDialog(EntityHandle h) const {
+  static const std::vector<std::string> empty;
+  const uint16_t id = dialog[d(h)];
+  return id < dialogs.size() ? dialogs[id] : empty;
+}
+
+size_t EntityStore::memoryBytes() const {
+  const size_t perEntity = sizeof(uint32_t) + sizeof(EntityKind) +
+                           2 * sizeof(int32_t) + 4 * sizeof(int32_t) +
+                           sizeof(uint8_t) + 3 * sizeof(ItemId) + sizeof(uint16_t);
+  return slots.capacity() * sizeof(Slot) + kind.capacity() * perEntity;
+}
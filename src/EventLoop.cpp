@@ -0,0 +1,131 @@
+#include "EventLoop.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <poll.h>
+
+static uint64_t steadyMs() {
+  return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static const uint64_t kEpochMs = steadyMs();
+
+EventLoop::EventLoop() : cursor(nowTick()) {}
+
+uint64_t EventLoop::nowTick() const {
+  return (steadyMs() - kEpochMs) / kTickMs;
+}
+
+EventLoop::TimerId EventLoop::after(uint32_t ms, Callback cb) {
+  return schedule(ms, 0, std::move(cb));
+}
+
+EventLoop::TimerId EventLoop::every(uint32_t ms, Callback cb) {
+  return schedule(ms, std::max<uint32_t>(ms, 1), std::move(cb));
+}
+
+EventLoop::TimerId EventLoop::schedule(uint32_t ms, uint32_t periodMs, Callback cb) {
+  Timer t;
+  t.id = nextId++;
+  // round up, and never into a tick that was already processed
+  t.tick = std::max(nowTick() + (ms + kTickMs - 1) / kTickMs, cursor + 1);
+  t.period = (periodMs + kTickMs - 1) / kTickMs;
+  t.cb = std::move(cb);
+  const TimerId id = t.id;
+  insert(std::move(t));
+  return id;
+}
+
+void EventLoop::insert(Timer t) {
+  due[t.id] = t.tick;
+  slots[t.tick & (kSlots - 1)].push_back(std::move(t));
+}
+
+void EventLoop::cancel(TimerId id) {
+  auto it = due.find(id);
+  if (it == due.end()) return;
+  auto& slot = slots[it->second & (kSlots - 1)];
+  for (size_t i = 0; i < slot.size(); ++i)
+    if (slot[i].id == id) { slot[i] = std::move(slot.back()); slot.pop_back(); break; }
+  due.erase(it);
+}
+
+// The game keeps a handful of timers, so a scan beats a second index.
+int EventLoop::nextTimeoutMs() const {
+  if (due.empty()) return -1;
+  uint64_t first = UINT64_MAX;
+  for (const auto& d : due) first = std::min(first, d.second);
+  const uint64_t now = nowTick();
+  return first <= now ? 0 : (int)std::min<uint64_t>((first - now) * kTickMs, INT32_MAX);
+}
+
+void EventLoop::runDue() {
+  const uint64_t now = nowTick();
+  if (now <= cursor) return;
+
+  // collect everything due from the buckets we are passing over
+  firing.clear();
+  const uint64_t steps = std::min<uint64_t>(now - cursor, kSlots);
+  for (uint64_t k = 1; k <= steps; ++k) {
+    auto& slot = slots[(cursor + k) & (kSlots - 1)];
+    for (size_t i = 0; i < slot.size(); ) {
+      if (slot[i].tick <= now) {
+        firing.push_back(std::move(slot[i]));
+        slot[i] = std::move(slot.back());
+        slot.pop_back();
+      } else {
+        ++i;
+      }
+    }
+  }
+  cursor = now;
+  std::sort(firing.begin(), firing.end(), [](const Timer& a, const Timer& b) {
+    return a.tick != b.tick ? a.tick < b.tick : a.id < b.id;
+  });
+
+  // a callback may cancel or schedule timers, including ones in `firing`
+  std::vector<Timer> batch;
+  batch.swap(firing);
+  for (Timer& t : batch) {
+    auto it = due.find(t.id);
+    if (it == due.end() || it->second != t.tick) continue;   // cancelled
+    if (t.period) {
+      Timer again;
+      again.id = t.id;
+      again.tick = std::max(t.tick + t.period, now + 1);   // skip missed periods
+      again.period = t.period;
+      again.cb = t.cb;
+      insert(std::move(again));
+    } else {
+      due.erase(it);
+    }
+    t.cb();
+  }
+  batch.clear();
+  if (firing.empty()) firing.swap(batch);   // keep the capacity
+}
+
+void EventLoop::watch(int fd, Callback cb) {
+  if (fd >= 0) watches.push_back(Watch{ fd, std::move(cb) });
+}
+
+bool EventLoop::wait(int fd) {
+  const int timeout = nextTimeoutMs();
+  fds.clear();
+  fds.push_back(pollfd{ fd, POLLIN, 0 });
+  for (const Watch& w : watches) fds.push_back(pollfd{ w.fd, POLLIN, 0 });
+  int r;
+  Profiler::idleBegin();
+  {
+    ProfileScope scope("EventLoop::wait");
+    r = ::poll(fds.data(), (nfds_t)fds.size(), timeout);
+  }
+  Profiler::idleEnd();
+  ++wakes;
+  if (r > 0)
+    for (size_t i = 0; i < watches.size(); ++i)
+      if (fds[i + 1].revents) watches[i].cb();
+  runDue();
+  return r < 0 || fds[0].revents != 0;   // input, or interrupted by a signal (resize)
+}
@@ -0,0 +1,225 @@
+#include "FightSolver.h"
+#include <algorithm>
+
+Pmf constantPmf(int value) {
+  Pmf r;
+  r.lo = value;
+  r.p = { 1.0 };
+  return r;
+}
+
+Pmf diePmf(int sides) {
+  if (sides <= 0) return constantPmf(0);
+  Pmf r;
+  r.lo = 1;
+  r.p.assign(sides, 1.0 / sides);
+  return r;
+}
+
+Pmf convolve(const Pmf& a, const Pmf& b) {
+  Pmf r;
+  r.lo = a.lo + b.lo;
+  r.p.assign(a.p.size() + b.p.size() - 1, 0.0);
+  for (size_t i = 0; i < a.p.size(); ++i) {
+    if (a.p[i] == 0.0) continue;
+    for (size_t j = 0; j < b.p.size(); ++j)
+      r.p[i + j] += a.p[i] * b.p[j];
+  }
+  return r;
+}
+
+Pmf negate(const Pmf& a) {
+  Pmf r;
+  r.lo = -a.hi();
+  r.p.assign(a.p.rbegin(), a.p.rend());
+  return r;
+}
+
+// Exploding die: j re-rolls (j < cap) end on a non-top face, each path
+// with probability sides^-(j+1); at the cap any face ends it.
+static Pmf explodingDiePmf(int sides) {
+  const int cap = DicePlan::kMaxExplode;
+  Pmf r;
+  r.lo = 1;
+  r.p.assign((size_t)sides * (cap + 1), 0.0);
+  double pj = 1.0 / sides;
+  for (int j = 0; j <= cap; ++j, pj /= sides) {
+    const int last = j < cap ? sides - 1 : sides;
+    for (int f = 1; f <= last; ++f) r.p[(size_t)sides * j + f - 1] += pj;
+  }
+  return r;
+}
+
+// Sum of the `keep` highest (or lowest) of `count` dice. Faces are handed
+// out from the kept end: dp[m][s] is the mass of having placed m dice
+// with s the sum kept so far, and choosing c dice of face v weighs
+// C(count - m, c) / sides^c.
+static Pmf keptDicePmf(int count, int sides, int keep, bool high) {
+  const int maxSum = keep * sides;
+  std::vector<std::vector<double>> dp(count + 1, std::vector<double>(maxSum + 1, 0.0));
+  std::vector<std::vector<double>> next = dp;
+  std::vector<double> choose(count + 1);
+  dp[0][0] = 1.0;
+  for (int step = 0; step < sides; ++step) {
+    const int v = high ? sides - step : 1 + step;
+    for (auto& row : next) std::fill(row.begin(), row.end(), 0.0);
+    for (int m = 0; m <= count; ++m) {
+      // choose[c] = C(count - m, c) / sides^c
+      choose[0] = 1.0;
+      for (int c = 1; c <= count - m; ++c)
+        choose[c] = choose[c - 1] * (count - m - c + 1) / c / sides;
+      for (int sum = 0; sum <= maxSum; ++sum) {
+        const double q = dp[m][sum];
+        if (q == 0.0) continue;
+        const int room = std::max(0, keep - m);
+        for (int c = 0; m + c <= count; ++c)
+          next[m + c][sum + std::min(c, room) * v] += q * choose[c];
+      }
+    }
+    dp.swap(next);
+  }
+  Pmf r;
+  r.lo = 0;
+  r.p = dp[count];
+  return r;
+}
+
+Pmf termPmf(const DiceTerm& t) {
+  Pmf sum = constantPmf(0);
+  if (t.count <= 0 || t.sides <= 0) return sum;   // same as rollDice
+  if (t.mode == DiceTerm::KeepHigh || t.mode == DiceTerm::KeepLow) {
+    sum = keptDicePmf(t.count, t.sides, t.keep, t.mode == DiceTerm::KeepHigh);
+  } else {
+    const Pmf die = t.mode == DiceTerm::Explode ? explodingDiePmf(t.sides) : diePmf(t.sides);
+    for (int i = 0; i < t.count; ++i) sum = convolve(sum, die);
+  }
+  return t.sign < 0 ? negate(sum) : sum;
+}
+
+Pmf planPmf(const DicePlan& plan) {
+  Pmf sum = constantPmf(plan.constant());
+  for (int i = 0; i < plan.termCount(); ++i) sum = convolve(sum, termPmf(plan.term(i)));
+  return sum;
+}
+
+std::vector<double> damagePmf(const combat::Combatant& attacker,
+                              const combat::Combatant& defender) {
+  // offense = d6 + ATK + weapon dice
+  Pmf offense = convolve(diePmf(6), constantPmf(attacker.attack));
+  if (attacker.weapon) offense = convolve(offense, planPmf(attacker.weapon->attackDice));
+
+  // defense = DEF + flat + armor dice
+  int flat = defender.defense;
+  Pmf defense = constantPmf(0);
+  for (int i = 0; i < defender.armorCount; ++i) {
+    const Equipment* a = defender.armor[i];
+    if (!a) continue;
+    flat += a->flatDefBonus;
+    defense = convolve(defense, planPmf(a->defenseDice));
+  }
+  defense = convolve(defense, constantPmf(flat));
+
+  Pmf raw = convolve(offense, negate(defense));
+  std::vector<double> dmg(std::max(2, raw.hi() + 1), 0.0);
+  for (size_t i = 0; i < raw.p.size(); ++i) {
+    int v = raw.lo + (int)i;
+    dmg[v < 1 ? 1 : v] += raw.p[i];
+  }
+  return dmg;
+}
+
+// Key covers everything damagePmf reads.
+static std::string loadoutKey(const combat::Combatant& attacker,
+                              const combat::Combatant& defender) {
+  std::string k;
+  auto put = [&](int v){ k.append(reinterpret_cast<const char*>(&v), sizeof v); };
+  auto putDice = [&](const DicePlan& plan){
+    put(plan.constant());
+    put(plan.termCount());
+    for (int i = 0; i < plan.termCount(); ++i) {
+      const DiceTerm& t = plan.term(i);
+      put(t.count); put(t.sides); put(t.keep); put(t.mode); put(t.sign);
+    }
+  };
+  put(attacker.attack);
+  if (attacker.weapon) putDice(attacker.weapon->attackDice); else put(-1);
+  put(defender.defense);
+  put(defender.armorCount);
+  for (int i = 0; i < defender.armorCount; ++i) {
+    const Equipment* a = defender.armor[i];
+    if (!a) { put(-1); continue; }
+    put(a->flatDefBonus);
+    putDice(a->defenseDice);
+  }
+  return k;
+}
+
+const std::vector<double>& FightSolver::cachedDamage(const combat::Combatant& attacker,
+                                                     const combat::Combatant& defender) {
+  std::string key = loadoutKey(attacker, defender);
+  auto it = cache.find(key);
+  if (it != cache.end()) return it->second;
+  return cache.emplace(std::move(key), damagePmf(attacker, defender)).first->second;
+}
+
+FightOdds FightSolver::solve(const combat::Combatant& player,
+                             const combat::Combatant& enemy) {
+  FightOdds odds;
+  if (player.hp <= 0) return odds;
+  if (enemy.hp  <= 0) { odds.playerWin = 1.0; return odds; }
+
+  const auto& toEnemy  = cachedDamage(player, enemy);
+  const auto& toPlayer = cachedDamage(enemy, player);
+
+  // State (ph, eh, k): k is the position in the repeating turn order, so
+  // whose attack comes next is order[k]. Every hit deals >= 1, so HP only
+  // goes down and the chain is acyclic: fill in increasing (ph, eh) order.
+  //   player's turn: win(ph,eh,k) = sum_d P(d) * (d >= eh ? 1 : win(ph,eh-d,k+1))
+  //   enemy's turn:  win(ph,eh,k) = sum_d Q(d) * (d >= ph ? 0 : win(ph-d,eh,k+1))
+  order = combat::turnCycle(player.speed, enemy.speed);
+  const size_t L = order.size();
+  const int PH = player.hp, EH = enemy.hp;
+  const size_t stride = (size_t)EH + 1;
+  const size_t cells  = ((size_t)PH + 1) * stride;
+  win.assign(cells * L, 0.0);
+  turns.assign(cells * L, 0.0);
+  auto at = [stride, cells](int ph, int eh, size_t k) {
+    return k * cells + (size_t)ph * stride + eh;
+  };
+
+  for (int ph = 1; ph <= PH; ++ph) {
+    for (int eh = 1; eh <= EH; ++eh) {
+      for (size_t k = 0; k < L; ++k) {
+        const size_t k1 = k + 1 == L ? 0 : k + 1;
+        double w = 0.0, t = 1.0;
+        if (order[k]) {
+          for (int d = 1; d < (int)toEnemy.size(); ++d) {
+            const double p = toEnemy[d];
+            if (p == 0.0) continue;
+            if (d >= eh) { w += p; continue; }         // enemy dies: win 1
+            w += p * win[at(ph, eh - d, k1)];
+            t += p * turns[at(ph, eh - d, k1)];
+          }
+        } else {
+          for (int d = 1; d < (int)toPlayer.size(); ++d) {
+            const double q = toPlayer[d];
+            if (q == 0.0 || d >= ph) continue;         // player dies: win 0
+            w += q * win[at(ph - d, eh, k1)];
+            t += q * turns[at(ph - d, eh, k1)];
+          }
+        }
+        win[at(ph, eh, k)] = w;
+        turns[at(ph, eh, k)] = t;
+      }
+    }
+  }
+
+  odds.playerWin     = win[at(PH, EH, 0)];
+  odds.expectedTurns = turns[at(PH, EH, 0)];
+  return odds;
+}
+
+FightOdds solveFight(const combat::Combatant& player, const combat::Combatant& enemy) {
+  FightSolver s;
+  return s.solve(player, enemy);
+}
@@ -0,0 +1,137 @@
+#include "Fov.h"
+#include <algorithm>
+
+Fov::Fov(const Map& map, int radius)
+: map(map), r(std::max(1, radius)), side(2 * r + 1),
+  visible(((size_t)side * side + 63) / 64, 0),
+  exploredIdx((size_t)((map.getWidth()  + Map::kChunkMask) >> Map::kChunkShift) *
+              ((map.getHeight() + Map::kChunkMask) >> Map::kChunkShift), -1) {
+  stack.reserve(4 * (size_t)r);
+}
+
+bool Fov::update(int x, int y) {
+  if (valid && x == vx && y == vy && map.version() == mapVersion) return false;
+  vx = x; vy = y;
+  compute();
+  return true;
+}
+
+void Fov::restoreExplored(std::vector<int32_t> index, std::vector<uint64_t> words) {
+  if (index.size() != exploredIdx.size()) return;
+  for (int32_t c : index)
+    if (c >= 0 && (size_t)c * 16 + 16 > words.size()) return;   // corrupt: keep ours
+  exploredIdx = std::move(index);
+  exploredBits = std::move(words);
+  exploredFlag.assign(exploredIdx.size(), 0);
+  exploredDirty.clear();
+  valid = false;
+}
+
+void Fov::clearExploredDirty() {
+  for (uint32_t c : exploredDirty) exploredFlag[c] = 0;
+  exploredDirty.clear();
+}
+
+bool Fov::isExplored(int x, int y) const {
+  if (x < 0 || y < 0 || x >= map.getWidth() || y >= map.getHeight()) return false;
+  const int cpr = (map.getWidth() + Map::kChunkMask) >> Map::kChunkShift;
+  const int32_t c = exploredIdx[(size_t)(y >> Map::kChunkShift) * cpr + (x >> Map::kChunkShift)];
+  if (c < 0) return false;
+  const int i = ((y & Map::kChunkMask) << Map::kChunkShift) | (x & Map::kChunkMask);
+  return (exploredBits[(size_t)c * 16 + (i >> 6)] >> (i & 63)) & 1u;
+}
+
+void Fov::reveal(int x, int y) {
+  const int dx = x - vx, dy = y - vy;
+  if (dx * dx + dy * dy > r * r) return;                 // circular radius
+  if (x < 0 || y < 0 || x >= map.getWidth() || y >= map.getHeight()) return;
+
+  const size_t i = (size_t)(y - oy) * side + (x - ox);
+  visible[i >> 6] |= 1ull << (i & 63);
+
+  const int cpr = (map.getWidth() + Map::kChunkMask) >> Map::kChunkShift;
+  const size_t ci = (size_t)(y >> Map::kChunkShift) * cpr + (x >> Map::kChunkShift);
+  int32_t& c = exploredIdx[ci];
+  if (c < 0) {
+    c = (int32_t)(exploredBits.size() / 16);
+    exploredBits.resize(exploredBits.size() + 16, 0);
+  }
+  const int t = ((y & Map::kChunkMask) << Map::kChunkShift) | (x & Map::kChunkMask);
+  uint64_t& word = exploredBits[(size_t)c * 16 + (t >> 6)];
+  const uint64_t bit = 1ull << (t & 63);
+  if (word & bit) return;
+  word |= bit;
+  if (exploredFlag.size() != exploredIdx.size()) exploredFlag.resize(exploredIdx.size(), 0);
+  if (!exploredFlag[ci]) { exploredFlag[ci] = 1; exploredDirty.push_back((uint32_t)ci); }
+}
+
+void Fov::compute() {
+  ox = vx - r; oy = vy - r;
+  mapVersion = map.version();
+  valid = true;
+  ++ver;
+  std::fill(visible.begin(), visible.end(), 0);
+
+  reveal(vx, vy);
+  for (int q = 0; q < 4; ++q) scanQuadrant(q);
+}
+
+// floor(a / b) for b > 0
+static int floorDiv(int a, int b) { return a >= 0 ? a / b : -((-a + b - 1) / b); }
+
+// Quadrant q maps (depth, col) to map coordinates: 0 north, 1 east,
+// 2 south, 3 west. Slopes are kept as exact fractions num/den.
+void Fov::scanQuadrant(int q) {
+  auto toMap = [&](int depth, int col, int& x, int& y) {
+    switch (q) {
+      case 0:  x = vx + col;   y = vy - depth; break;
+      case 1:  x = vx + depth; y = vy + col;   break;
+      case 2:  x = vx + col;   y = vy + depth; break;
+      default: x = vx - depth; y = vy + col;   break;
+    }
+  };
+
+  stack.clear();
+  stack.push_back({ 1, -1, 1, 1, 1 });
+
+  while (!stack.empty()) {
+    Row row = stack.back();
+    stack.pop_back();
+    if (row.depth > r) continue;
+
+    // min_col = round_ties_up(depth * start), max_col = round_ties_down(depth * end)
+    const int minCol = floorDiv(2 * row.depth * row.startNum + row.startDen, 2 * row.startDen);
+    const int maxCol = -floorDiv(-(2 * row.depth * row.endNum - row.endDen), 2 * row.endDen);
+
+    int prev = -1;    // -1 none, 0 floor, 1 wall
+    for (int col = minCol; col <= maxCol; ++col) {
+      int x, y;
+      toMap(row.depth, col, x, y);
+      const int wall = opaque(x, y) ? 1 : 0;
+
+      // symmetric: floor tiles only if the centre lies within the slopes
+      const bool symmetric =
+          (long long)col * row.startDen >= (long long)row.depth * row.startNum &&
+          (long long)col * row.endDen   <= (long long)row.depth * row.endNum;
+      if (wall || symmetric) reveal(x, y);
+
+      if (prev == 1 && !wall) {               // wall -> floor: new start slope
+        row.startNum = 2 * col - 1;
+        row.startDen = 2 * row.depth;
+      }
+      if (prev == 0 && wall) {                // floor -> wall: scan below it
+        Row next = row;
+        next.depth = row.depth + 1;
+        next.endNum = 2 * col - 1;
+        next.endDen = 2 * row.depth;
+        stack.push_back(next);
+      }
+      prev = wall;
+    }
+    if (prev == 0) {
+      Row next = row;
+      next.depth = row.depth + 1;
+      stack.push_back(next);
+    }
+  }
+}
@@ -1,22 +1,76 @@
 #include "Game.h"
+#include "AnsiRenderer.h"
+#include "NcursesRenderer.h"
+#include "StartingGear.h"
+#include <algorithm>
 #include <chrono>
+#include <cstdio>
+#include <cstdlib>
 #include <ncurses.h>
+#include <unistd.h>
 
-Game::Game()
-: map(30, 15),
-  player(map.getWidth()/2, map.getHeight()/2),
-  enemy(0, 0),
-  npc(0, 0),
-  d6(1, 6),        // <-- move d6 before combat
-  ui(18, 5),
-  combat(rng)
+Game::Game(const GameOptions& opts, Input& input, Level* level, std::unique_ptr<Renderer> screen)
+: seed(opts.seed ? opts.seed : clockSeed()),
+  spawns(level ? std::move(level->spawns) : std::vector<LevelSpawn>()),
+  map(takeMap(level, seed, spawns, layout)),
+  player(layout.spawnX, layout.spawnY),
+  levels(seed, !input.replaying() && !input.remoteKeys()),
+  chase(map, 32),
+  fov(map, kSightRadius),
+  jobs(opts.threads),
+  headless(input.replaying()),
+  remote(input.remoteKeys()),
+  tracing(!opts.profilePath.empty()),
+  input(input),
+  ui(18, 5)
 {
-  // ncurses base
+  if (screen) {
+    ui.setRenderer(std::move(screen));
+  } else if (!headless && !remote) {
+    initTerminal();
+    if (opts.renderer == "ansi") {
+      refresh();   // getch() would paint the blank stdscr over our first frame
+      ui.setRenderer(std::make_unique<AnsiRenderer>(STDOUT_FILENO));
+    } else {
+      ui.setRenderer(std::make_unique<NcursesRenderer>());
+    }
+  }
+
+  // rng seed (same seed as the dungeon, separate stream)
+  rng.seed(seed, 1);
+
+  // first message
+  log.push(MsgId::Welcome);
+
+  // place actors
+  // starting gear (see StartingGear.cpp)
+  giveStartingGear(player);
+  spawnEnemies();
+  spawnNPC();
+  if (!level) {
+    placeStairs(map, layout, 0);   // uses no RNG, so actors land where they always did
+    map.markPristine();
+  }
+  resetSchedule();
+  // both only read the map (and write their own tables)
+  sight.add([this]{ fov.update(player.getX(), player.getY()); });
+  sight.add([this]{ chase.update(player.getX(), player.getY()); });
+  loop.watch(levels.readyFd(), [this]{
+    if (levels.collect()) finishStairs();
+  });
+
+  // create windows
+  ui.setVisibility(&fov);
+  ui.layout();
+}
+
+void Game::initTerminal() {
+  // ncurses base (keys always come through it)
   initscr();
   noecho();
   curs_set(FALSE);
   keypad(stdscr, TRUE);
-  timeout(50); // non-blocking input with ~20 FPS
+  nodelay(stdscr, TRUE); // reads never block; run() sleeps in EventLoop::wait
 
   // colors
   if (has_colors()) {
@@ -27,142 +81,444 @@ Game::Game()
     init_pair(3, COLOR_CYAN,  -1); // player
     init_pair(5, COLOR_WHITE, -1); // text/hud
   }
+}
 
-  // rng seed
-  auto seed = static_cast<unsigned>(
-      std::chrono::high_resolution_clock::now().time_since_epoch().count());
-  rng.seed(seed);
+Game::~Game() {
+  if (!headless && !remote) endwin(); // Ui destructor already deletes windows; this restores terminal
+}
 
-  // first message
-  lastMessage = "Explore the map. Move with WASD/Arrows, press Q to quit. Step on 'g' to battle, 'N' to talk.";
+std::string Game::summary() const {
+  size_t alive = 0, enemies = 0;
+  for (size_t i = 0; i < actors.size(); ++i) {
+    if (actors.kindAt(i) != EntityKind::Enemy) continue;
+    ++enemies;
+    alive += actors.aliveAt(i);
+  }
+  uint64_t st[4];
+  rng.getState(st);
+  char buf[160];
+  std::snprintf(buf, sizeof buf,
+                "seed %llu turns %llu player (%d,%d) hp %d enemies %zu/%zu rng %016llx",
+                (unsigned long long)seed, (unsigned long long)turns,
+                player.getX(), player.getY(), player.getHP(), alive, enemies,
+                (unsigned long long)st[0]);
+  // only below the first level, so older recordings still match
+  if (depth > 0) return std::string(buf) + " depth " + std::to_string(depth);
+  return buf;
+}
 
-  // place actors
-  spawnEnemy();
-  spawnNPC();
-  // --- Starting gear for PLAYER ---
-  // Sword: adds +1d8 to damage
-  Equipment sword;
-  sword.name = "Sword";
-  sword.slot = EquipSlot::Weapon;
-  sword.attackDice = { {1,8} };
-
-  // Helmet: reduce incoming by 1d2
-  Equipment helmet;
-  helmet.name = "Helmet";
-  helmet.slot = EquipSlot::Helmet;
-  helmet.defenseDice = { {1,2} };
-
-  // Chest plate: reduce incoming by (1 + 1d4)
-  Equipment chest;
-  chest.name = "Chest Plate";
-  chest.slot = EquipSlot::Chest;
-  chest.flatDefBonus = 1;           // the "+1" part
-  chest.defenseDice  = { {1,4} };   // the "d4" part
-
-  // Boots: +2 speed, reduce incoming by 1d2
-  Equipment boots;
-  boots.name = "Boots";
-  boots.slot = EquipSlot::Boots;
-  boots.spdBonus = 2;
-  boots.defenseDice = { {1,2} };
-
-  player.setWeapon(sword);
-  player.setHelmet(helmet);
-  player.setChest(chest);
-  player.setBoots(boots);
-
-  // --- Starting gear for ENEMY ---
-  // Mace: adds +2d4 to damage
-  Equipment mace;
-  mace.name = "Mace";
-  mace.slot = EquipSlot::Weapon;
-  mace.attackDice = { {2,4} };
-
-  // Helmet & Chest equal to the player's (no boots)
-  enemy.setWeapon(mace);
-  enemy.setHelmet(helmet);
-  enemy.setChest(chest);
+void Game::autosaveTo(const std::string& path) {
+  saver = std::make_unique<SaveWriter>(path);
+  autosave(true);
+}
 
-  // create windows
+std::string Game::saveError() const {
+  std::string why;
+  if (saver && saver->failed(&why)) return why.empty() ? saver->path() : why;
+  return {};
+}
+
+void Game::restore(SaveState& st) {
+  restoreSave(st, saveView());
+  findStairs(map, layout);
+  resetSchedule();   // not saved: everyone starts the next turn afresh
+  fov.invalidate();
+  chase.invalidate();
   ui.layout();
 }
 
-Game::~Game() {
-  endwin(); // Ui destructor already deletes windows; this restores terminal
+SaveView Game::saveView() {
+  return SaveView{ map, player, actors, foe, rng, fov, log, seed, depth, turns, levels };
+}
+
+// Cheap to call every turn: only encodes when the interval has passed.
+// Fights and conversations are not part of a save, so none is taken while
+// one runs; the next comes once they are over.
+void Game::autosave(bool force) {
+  if (!saver || !tasks.empty()) return;
+  const auto now = std::chrono::steady_clock::now();
+  if (!force && (!unsaved || now - lastSave < kAutosaveEvery)) return;
+  ProfileScope scope("Game::autosave");
+  saver->save(saveView());
+  lastSave = now;
+  unsaved = false;
 }
 
-void Game::spawnEnemy() {
-  for (int tries = 0; tries < 1000; ++tries) {
-    int ex = 1 + (rng() % (map.getWidth()  - 2));
-    int ey = 1 + (rng() % (map.getHeight() - 2));
-    if (!map.isWalkable(ex, ey)) continue;
-    if (ex == player.getX() && ey == player.getY()) continue;
-    enemy.setPos(ex, ey);
+// One timer per pending save, due kAutosaveEvery after the previous one.
+void Game::scheduleAutosave() {
+  if (!saver || !unsaved || !tasks.empty() || loop.scheduled(saveTimer)) return;
+  const auto since = std::chrono::steady_clock::now() - lastSave;
+  const auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(kAutosaveEvery - since);
+  saveTimer = loop.after((uint32_t)std::max<int64_t>(0, wait.count()), [this]{ autosave(false); });
+}
+
+uint64_t Game::clockSeed() {
+  return static_cast<uint64_t>(
+      std::chrono::high_resolution_clock::now().time_since_epoch().count());
+}
+
+Map Game::takeMap(Level* level, uint64_t seed, const std::vector<LevelSpawn>& spawns,
+                  DungeonLayout& layout) {
+  if (!level) return generateDungeon(areaConfig(seed, 0), layout);
+  // level files have no rooms: actors come from the spawn table
+  layout = DungeonLayout();
+  for (const LevelSpawn& s : spawns)
+    if (s.kind == LevelSpawn::Player) { layout.spawnX = s.x; layout.spawnY = s.y; break; }
+  return std::move(level->map);
+}
+
+// Enemies from the level's spawn table, or else one per room (see
+// spawnRoomEnemies, which also stocks the deeper levels).
+void Game::spawnEnemies() {
+  if (spawns.empty()) {
+    foe = spawnRoomEnemies(map, layout, actors, rng, kAreaEnemies, player.getX(), player.getY());
     return;
   }
-  enemy.setPos(1, 1);
+  Enemy proto;
+  giveStartingGear(proto);
+  for (const LevelSpawn& s : spawns) {
+    if (s.kind != LevelSpawn::Enemy) continue;
+    proto.setPos(s.x, s.y);
+    EntityHandle h = actors.spawnEnemy(proto);
+    if (!actors.valid(foe)) foe = h;
+  }
 }
 
+// The NPC waits in the spawn room, so the first conversation is close by.
 void Game::spawnNPC() {
-  for (int tries = 0; tries < 1000; ++tries) {
-    int nx = 1 + (rng() % (map.getWidth()  - 2));
-    int ny = 1 + (rng() % (map.getHeight() - 2));
-    if (!map.isWalkable(nx, ny)) continue;
-    if ((nx == player.getX() && ny == player.getY()) ||
-        (nx == enemy.getX()  && ny == enemy.getY())) continue;
-    npc.setPos(nx, ny);
+  if (spawns.empty()) {
+    spawnRoomNPC(map, layout, actors, rng, player.getX(), player.getY());
     return;
   }
-  npc.setPos(map.getWidth()-2, map.getHeight()-2);
+  for (const LevelSpawn& s : spawns)
+    if (s.kind == LevelSpawn::NPC) actors.spawnNPC(NPC(s.x, s.y));
 }
 
 bool Game::tryMovePlayer(int dx, int dy) {
+  ProfileScope scope("Game::tryMovePlayer");
   int nx = player.getX() + dx;
   int ny = player.getY() + dy;
 
   if (!map.isWalkable(nx, ny)) return false;
 
+  EntityHandle who = actors.at(nx, ny);
+
+  unsaved = true;
+  ++turns;
+
   // NPC: talk, then step into tile
-  if (nx == npc.getX() && ny == npc.getY()) {
-    dialog.run(npc, map, player, enemy, ui, lastMessage);
-    player.setPos(nx, ny);
+  if (actors.valid(who) && actors.kindOf(who) == EntityKind::NPC) {
+    tasks.push_back(std::make_unique<DialogueTask>(who, actors, player, log, nx, ny));
     return true;
   }
 
   // Enemy: battle, then step into tile if you win
-  if (enemy.isAlive() && enemy.getX() == nx && enemy.getY() == ny) {
-    combat.run(map, player, enemy, npc, ui, running, lastMessage);
-    if (running && player.isAlive() && !enemy.isAlive()) {
-      player.setPos(nx, ny);
-    }
+  if (actors.valid(who)) {
+    fight(who, true, nx, ny);
     return true;
   }
 
-  // normal move
+  // normal move; enemies get their turn afterwards
   player.setPos(nx, ny);
+  moveEnemies();
+  prefetchStairs();
   return true;
 }
 
+// Taking the stairs is a turn. The level is usually built already (see
+// prefetchStairs); if not, keys wait in the terminal until the worker
+// delivers it, while the loop keeps drawing.
+void Game::useStairs(int step) {
+  const Tile want = step > 0 ? Tile::StairsDown : Tile::StairsUp;
+  if (!tasks.empty() || map.getTile(player.getX(), player.getY()) != want) {
+    log.push(MsgId::NoStairs);
+    return;
+  }
+  unsaved = true;
+  ++turns;
+  pendingDepth = depth + step;
+  levels.request(pendingDepth);
+  finishStairs();
+  if (pendingDepth >= 0) log.push(MsgId::StairsWait, {}, true);
+}
+
+void Game::finishStairs() {
+  if (pendingDepth < 0) return;
+  std::unique_ptr<Area> next = levels.take(pendingDepth);
+  if (!next) {
+    levels.request(pendingDepth);   // no-op while it is being built
+    return;
+  }
+  pendingDepth = -1;
+  enterArea(std::move(next));
+  redraw = true;
+}
+
+// Swaps the current level out for `next`. Everything that points at the
+// level (FOV, flow field, UI) holds on to `map`, which stays the same
+// object, so only the contents move.
+void Game::enterArea(std::unique_ptr<Area> next) {
+  ProfileScope scope("Game::enterArea");
+  const bool down = next->depth > depth;
+
+  auto prev = std::make_unique<Area>();
+  prev->seed = seed;
+  prev->depth = depth;
+  prev->map = std::move(map);
+  prev->layout = std::move(layout);
+  prev->actors = std::move(actors);
+  prev->exploredIdx = fov.exploredIndex();
+  prev->exploredBits = fov.exploredWords();
+
+  depth = next->depth;
+  map = std::move(next->map);
+  layout = std::move(next->layout);
+  actors = std::move(next->actors);
+  fov.restoreExplored(std::move(next->exploredIdx), std::move(next->exploredBits));
+  levels.store(std::move(prev));
+
+  foe = EntityHandle();
+  if (down) player.setPos(layout.upX, layout.upY);
+  else      player.setPos(layout.downX, layout.downY);
+  fov.invalidate();
+  chase.invalidate();
+  resetSchedule();
+  if (saver) saver->rebase();   // the whole map changed: no delta for that
+  log.push(down ? MsgId::StairsDown : MsgId::StairsUp, { depth });
+  prefetchStairs();
+}
+
+// Asks for the level behind a staircase once the player is near it, so it
+// is usually ready by the time they get there.
+void Game::prefetchStairs() {
+  const int px = player.getX(), py = player.getY();
+  auto near = [&](int x, int y) {
+    return x >= 0 && std::max(std::abs(x - px), std::abs(y - py)) <= kPrefetchRange;
+  };
+  if (near(layout.downX, layout.downY)) levels.request(depth + 1);
+  if (near(layout.upX, layout.upY))     levels.request(depth - 1);
+}
+
+void Game::fight(EntityHandle who, bool advance, int ax, int ay) {
+  // the previous foe's body is no longer needed once a new fight starts
+  if (who != foe && actors.valid(foe) && !actors.isAlive(foe) && !engaged(foe))
+    actors.despawn(foe);
+  foe = who;
+  tasks.push_back(std::make_unique<CombatTask>(rng, player, actors, who, log, running,
+                                               advance, ax, ay));
+}
+
+// The player starts with an empty schedule and the first turn.
+void Game::resetSchedule() {
+  schedule.clear();
+  schedule.add(kPlayerActor, player.getSpeed(), true);
+  schedule.next();
+}
+
+// The player has used a turn. Enemies that can see the player (symmetric
+// FOV, so one bit test) and are within aggro range join the schedule, and
+// then everyone on it acts, by speed, until the player's turn comes round
+// again: a speed 3 enemy gets three moves to the player's seven.
+//
+// FOV and flow field are rebuilt as two jobs side by side. The aggro scan
+// covers at most a (2 * kAggroRange + 1)^2 square at a bit test and a
+// lookup per candidate, far too little to split, so it and the enemies'
+// moves stay on this thread in scan/schedule order; more threads never
+// change what happens.
+void Game::moveEnemies() {
+  ProfileScope scope("Game::moveEnemies");
+  const int px = player.getX(), py = player.getY();
+  jobs.run(sight);
+
+  // (nobody moves during the scan, so the spatial hash can be walked)
+  nearby.clear();
+  actors.forEachInRect(px - kAggroRange, py - kAggroRange,
+                       2 * kAggroRange + 1, 2 * kAggroRange + 1,
+                       [&](size_t i){ nearby.push_back((uint32_t)i); });
+  for (uint32_t i : nearby) {
+    const bool joins = actors.kindAt(i) == EntityKind::Enemy && actors.aliveAt(i) &&
+                       fov.viewerCanSee(actors.xAt(i), actors.yAt(i)) &&
+                       chase.distance(actors.xAt(i), actors.yAt(i)) <= (uint32_t)kAggroRange;
+    if (!joins) continue;
+    const EntityHandle h = actors.handleAt(i);
+    if (!schedule.scheduled(h.slot + 1)) schedule.add(h.slot + 1, actors.getSpeed(h));
+  }
+
+  schedule.done(kPlayerActor);
+  for (;;) {
+    const TurnScheduler::ActorId id = schedule.next();
+    if (id == kPlayerActor || id == TurnScheduler::kNone) break;
+    if (enemyTurn(actors.handleOfSlot(id - 1))) schedule.done(id);
+    else schedule.remove(id);
+  }
+}
+
+// One step along the shared flow field; reaching the player's tile starts
+// a fight. False when the enemy is gone or has lost the player, which
+// takes it off the schedule until it sees them again.
+bool Game::enemyTurn(EntityHandle h) {
+  if (!actors.valid(h) || !actors.isAlive(h)) return false;
+  if (engaged(h)) return true;   // already fighting
+  const int ex = actors.getX(h), ey = actors.getY(h);
+  if (!fov.viewerCanSee(ex, ey) || chase.distance(ex, ey) > (uint32_t)kAggroRange) return false;
+  int dx = 0, dy = 0;
+  if (!chase.step(ex, ey, dx, dy)) return true;
+  const int nx = ex + dx, ny = ey + dy;
+  if (nx == player.getX() && ny == player.getY()) {
+    fight(h);
+    return true;
+  }
+  if (!actors.valid(actors.at(nx, ny))) actors.setPos(h, nx, ny);
+  return true;
+}
+
+void Game::handleKey(int ch) {
+  redraw = true;
+  if (ch == KEY_RESIZE) {
+    // stdscr is never drawn on; keep getch() from repainting it over the frame
+    if (!remote) untouchwin(stdscr);
+    ui.layout();   // recreate/resize panels
+    return;
+  }
+  // scrolling the log is not an answer to a prompt
+  if (ch == KEY_PPAGE) { ui.scrollLog(+Ui::kLogScrollStep); return; }
+  if (ch == KEY_NPAGE) { ui.scrollLog(-Ui::kLogScrollStep); return; }
+
+  // a fight or conversation waiting for "any key" gets it
+  if (Task* t = front(); t && t->state == Task::State::AwaitKey) {
+    t->state = Task::State::Ready;
+    pumpTasks();
+    return;
+  }
+
+  switch (ch) {
+    case 'q': running = false; break;
+    case 'f': ui.setShowStats(!ui.statsShown()); break;
+    case 'p': toggleProfile(); break;
+    case KEY_UP:
+    case 'w': tryMovePlayer(0, -1); break;
+    case KEY_DOWN:
+    case 's': tryMovePlayer(0,  1); break;
+    case KEY_LEFT:
+    case 'a': tryMovePlayer(-1, 0); break;
+    case KEY_RIGHT:
+    case 'd': tryMovePlayer(1,  0); break;
+    case '>': useStairs(+1); break;
+    case '<': useStairs(-1); break;
+    default: redraw = false; break;
+  }
+  pumpTasks();   // start whatever that key began
+}
+
+// Keys are read only when someone can use them: with every task in the
+// middle of a delay they stay in the terminal (as they did during the old
+// blocking pauses) and are dropped when the next prompt appears. The same
+// goes for stairs taken before their level is ready.
+bool Game::acceptsKeys() const {
+  if (pendingDepth >= 0) return false;   // the next level is still being built
+  const Task* t = front();
+  return !t || t->state == Task::State::AwaitKey;
+}
+
+Task* Game::front() const {
+  for (const auto& t : tasks)
+    if (t->state == Task::State::AwaitKey) return t.get();
+  return tasks.empty() ? nullptr : tasks.front().get();
+}
+
+bool Game::engaged(EntityHandle h) const {
+  for (const auto& t : tasks)
+    if (t->involves(h)) return true;
+  return false;
+}
+
+// Steps every ready task until each one waits or ends. Indices, not
+// iterators: a step can start new fights (enemies move after each attack).
+void Game::pumpTasks() {
+  for (size_t i = 0; i < tasks.size(); ) {
+    Task* t = tasks[i].get();
+    if (t->state != Task::State::Ready) { ++i; continue; }
+
+    Task::Wait w;
+    {
+      ProfileScope scope("Task::step");
+      w = t->step();
+    }
+    redraw = true;
+    const bool turn = t->turnPassed;
+    t->turnPassed = false;
+
+    if (w == Task::Wait::Done) {
+      tasks.erase(tasks.begin() + i);
+    } else if (w == Task::Wait::Key) {
+      t->state = Task::State::AwaitKey;
+      input.discardPending();   // the prompt wants a fresh key
+      ++i;
+    } else if (!headless) {
+      t->state = Task::State::Delayed;
+      t->timer = loop.after((uint32_t)t->delayMs, [this, t]{
+        t->state = Task::State::Ready;
+        redraw = true;
+      });
+      ++i;
+    }
+    // (headless: a delay ends at once, so the same task steps again)
+
+    if (turn && running && player.isAlive()) moveEnemies();
+  }
+}
+
+// The overlay's numbers change without input, so a timer redraws the HUD.
+void Game::toggleProfile() {
+  // the profiler is process-wide: one server session must not switch it
+  // on for all of them (or keep itself awake redrawing the overlay)
+  if (remote) return;
+  ui.setShowProfile(!ui.profileShown());
+  Profiler::setEnabled(tracing || ui.profileShown());
+  loop.cancel(overlayTimer);
+  if (ui.profileShown())
+    overlayTimer = loop.every(Ui::kProfileRefreshMs, [this]{ ui.refreshProfile(); redraw = true; });
+}
+
+bool Game::tick() {
+  // everything the terminal has buffered, then at most one frame
+  // (a replay takes one key per frame, like the live game did)
+  int ch = ERR;
+  while (running && acceptsKeys() && (ch = input.poll()) != ERR) {
+    handleKey(ch);
+    if (headless) break;
+  }
+  if (ch == ERR && input.exhausted()) return false;   // replay finished
+  pumpTasks();   // resumed by timers
+  scheduleAutosave();
+
+  if (redraw) {
+    {
+      ProfileScope scope("Fov::update");
+      fov.update(player.getX(), player.getY());   // no-op unless the player moved
+    }
+    const Task* t = front();
+    if (t && actors.valid(t->opponent())) foe = t->opponent();
+    ui.renderFrame(map, player, actors, foe, log, t && t->indicator);
+    redraw = false;
+  }
+  return running;
+}
+
 void Game::run() {
-  while (running) {
-    int ch = getch();
-    if (ch == KEY_RESIZE) {
-      ui.layout(); // recreate/resize windows
+  while (tick()) {
+    if (headless) {
+      // nothing to wait for; timers (autosave) still run on wall time
+      Profiler::idleBegin();
+      Profiler::idleEnd();
+      loop.runDue();
     } else {
-      switch (ch) {
-        case 'q': running = false; break;
-        case KEY_UP:
-        case 'w': tryMovePlayer(0, -1); break;
-        case KEY_DOWN:
-        case 's': tryMovePlayer(0,  1); break;
-        case KEY_LEFT:
-        case 'a': tryMovePlayer(-1, 0); break;
-        case KEY_RIGHT:
-        case 'd': tryMovePlayer(1,  0); break;
-        default: break;
-      }
+      // stdin only when a key would be used (poll ignores fd -1)
+      loop.wait(acceptsKeys() ? STDIN_FILENO : -1);
     }
-
-    ui.renderFrame(map, player, enemy, npc, lastMessage, /*showIndicator=*/false);
   }
+
+  // a finished run (death) is not worth resuming
+  if (player.isAlive()) autosave(true);
+  if (saver) saver->flush();
 }
@@ -0,0 +1,48 @@
+#include "GameOptions.h"
+#include <cstdlib>
+#include <cstring>
+
+bool parseGameOptions(int argc, char** argv, GameOptions& out, std::string& err) {
+  for (int i = 1; i < argc; ++i) {
+    const char* a = argv[i];
+    auto value = [&](std::string& dst) {
+      if (i + 1 >= argc) { err = std::string(a) + " needs a value"; return false; }
+      dst = argv[++i];
+      return true;
+    };
+    if (!std::strcmp(a, "--seed")) {
+      std::string v;
+      if (!value(v)) return false;
+      out.seed = std::strtoull(v.c_str(), nullptr, 10);
+    }
+    else if (!std::strcmp(a, "--threads")) {
+      std::string v;
+      if (!value(v)) return false;
+      out.threads = (unsigned)std::strtoul(v.c_str(), nullptr, 10);
+    }
+    else if (!std::strcmp(a, "--save"))   { if (!value(out.savePath))   return false; }
+    else if (!std::strcmp(a, "--load"))   { if (!value(out.loadPath))   return false; }
+    else if (!std::strcmp(a, "--record")) { if (!value(out.recordPath)) return false; }
+    else if (!std::strcmp(a, "--replay")) { if (!value(out.replayPath)) return false; }
+    else if (!std::strcmp(a, "--profile")) { if (!value(out.profilePath)) return false; }
+    else if (!std::strcmp(a, "--items"))  { if (!value(out.itemsPath))  return false; }
+    else if (!std::strcmp(a, "--renderer")) {
+      if (!value(out.renderer)) return false;
+      if (out.renderer != "ncurses" && out.renderer != "ansi") {
+        err = "--renderer must be ncurses or ansi";
+        return false;
+      }
+    }
+    else if (a[0] != '-') out.levelPath = a;
+    else { err = std::string("unknown option ") + a; return false; }
+  }
+  if (!out.recordPath.empty() && !out.loadPath.empty()) {
+    err = "--record needs a fresh game (it cannot start from --load)";
+    return false;
+  }
+  if (!out.replayPath.empty() && (!out.loadPath.empty() || !out.recordPath.empty())) {
+    err = "--replay cannot be combined with --load or --record";
+    return false;
+  }
+  return true;
+}
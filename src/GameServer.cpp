@@ -0,0 +1,319 @@
+#include "GameServer.h"
+#include "AnsiRenderer.h"
+#include "Game.h"
+#include "GameOptions.h"
+#include "Input.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <ncurses.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+uint64_t nowMs() {
+  return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Client bytes to getch()-style keys, as ncurses' keypad mode would decode
+// them, plus the two sequences the server answers itself. A sequence may
+// be split across reads.
+class KeyDecoder {
+public:
+  enum class Kind { Key, Resize, Ping };
+  struct Event { Kind kind; int key, rows, cols; };
+
+  template <class F>
+  void feed(const char* p, size_t n, F&& emit) {
+    for (size_t i = 0; i < n; ++i) {
+      const unsigned char c = (unsigned char)p[i];
+      if (seq.empty()) {
+        if (c == 27) seq.push_back((char)c);
+        else emit(Event{ Kind::Key, c, 0, 0 });
+        continue;
+      }
+      seq.push_back((char)c);
+      if (seq.size() == 2) {
+        if (c == '[' || c == 'O') continue;
+        // a lone ESC followed by an ordinary key
+        seq.clear();
+        emit(Event{ Kind::Key, 27, 0, 0 });
+        --i;
+        continue;
+      }
+      if (seq[1] == 'O' || (c >= 0x40 && c <= 0x7e)) {
+        finish(emit);
+        seq.clear();
+      } else if (seq.size() > kMaxSeq) {
+        seq.clear();   // nothing we know is this long
+      }
+    }
+  }
+
+private:
+  static constexpr size_t kMaxSeq = 24;
+  std::string seq;   // unfinished escape sequence, ESC included
+
+  template <class F>
+  void finish(F&& emit) {
+    const char fin = seq.back();
+    const std::string params = seq.substr(2, seq.size() - 3);
+    switch (fin) {
+      case 'A': emit(Event{ Kind::Key, KEY_UP, 0, 0 }); return;
+      case 'B': emit(Event{ Kind::Key, KEY_DOWN, 0, 0 }); return;
+      case 'C': emit(Event{ Kind::Key, KEY_RIGHT, 0, 0 }); return;
+      case 'D': emit(Event{ Kind::Key, KEY_LEFT, 0, 0 }); return;
+      default: break;
+    }
+    if (seq[1] != '[') return;
+    if (fin == '~' && params == "5") emit(Event{ Kind::Key, KEY_PPAGE, 0, 0 });
+    else if (fin == '~' && params == "6") emit(Event{ Kind::Key, KEY_NPAGE, 0, 0 });
+    else if (fin == 'n' && params == "5") emit(Event{ Kind::Ping, 0, 0, 0 });
+    else if (fin == 't') {
+      int op = 0, rows = 0, cols = 0;
+      if (std::sscanf(params.c_str(), "%d;%d;%d", &op, &rows, &cols) == 3 && op == 8)
+        emit(Event{ Kind::Resize, 0, rows, cols });
+    }
+  }
+};
+
+}   // namespace
+
+struct GameServer::Session {
+  int fd = -1;
+  uint64_t serial = 0;
+  std::string out;          // bytes for the client; out[0, sent) are gone
+  size_t sent = 0;
+  Input input;
+  AnsiRenderer* screen = nullptr;   // owned by `game`, appends to `out`
+  std::unique_ptr<Game> game;
+  KeyDecoder keys;
+  bool writing = false;     // EPOLLOUT is on
+  bool over = false;        // game ended; close once `out` is sent
+  uint64_t timerAt = 0;     // deadline queued in `timers` (0 = none)
+};
+
+GameServer::GameServer(const ServerConfig& c) : cfg(c) {
+  if (cfg.seed == 0) cfg.seed = Game::clockSeed();
+}
+
+GameServer::~GameServer() {
+  for (auto& s : byFd)
+    if (s) close(*s);
+  if (epollFd >= 0) ::close(epollFd);
+  if (listenFd >= 0) {
+    ::close(listenFd);
+    ::unlink(cfg.socketPath.c_str());
+  }
+}
+
+bool GameServer::listen(std::string& err) {
+  auto fail = [&](const char* what) {
+    err = std::string(what) + ": " + std::strerror(errno);
+    return false;
+  };
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  if (cfg.socketPath.empty() || cfg.socketPath.size() >= sizeof addr.sun_path) {
+    err = "bad socket path '" + cfg.socketPath + "'";
+    return false;
+  }
+  std::memcpy(addr.sun_path, cfg.socketPath.c_str(), cfg.socketPath.size() + 1);
+
+  listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (listenFd < 0) return fail("socket");
+  ::unlink(cfg.socketPath.c_str());
+  if (::bind(listenFd, (sockaddr*)&addr, sizeof addr) != 0) return fail(cfg.socketPath.c_str());
+  if (::listen(listenFd, SOMAXCONN) != 0) return fail("listen");
+
+  epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+  if (epollFd < 0) return fail("epoll_create1");
+  epoll_event ev{};
+  ev.events = EPOLLIN;
+  ev.data.fd = listenFd;
+  if (::epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &ev) != 0) return fail("epoll_ctl");
+  return true;
+}
+
+bool GameServer::run(std::string& err) {
+  epoll_event events[256];
+  while (!stopping) {
+    const int n = ::epoll_wait(epollFd, events, 256, waitMs());
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      err = std::string("epoll_wait: ") + std::strerror(errno);
+      return false;
+    }
+    for (int i = 0; i < n; ++i) {
+      const int fd = events[i].data.fd;
+      if (fd == listenFd) { acceptAll(); continue; }
+      if ((size_t)fd >= byFd.size() || !byFd[fd]) continue;
+      Session& s = *byFd[fd];
+      if (events[i].events & (EPOLLERR | EPOLLHUP)) { close(s); continue; }
+      if (events[i].events & EPOLLOUT) flush(s);
+      if ((size_t)fd < byFd.size() && byFd[fd] && (events[i].events & EPOLLIN)) readFrom(s);
+    }
+    runDueTimers();
+  }
+  return true;
+}
+
+void GameServer::acceptAll() {
+  for (;;) {
+    const int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) return;   // EAGAIN, or a connection that died in the backlog
+    if (open >= cfg.maxSessions) {
+      ::close(fd);
+      ++st.refused;
+      continue;
+    }
+    auto s = std::make_unique<Session>();
+    s->fd = fd;
+    s->serial = ++serials;
+    s->out = "\x1b[?1049h";   // the client's alternate screen, until finish()
+    auto screen = std::make_unique<AnsiRenderer>(&s->out);
+    s->screen = screen.get();
+    s->input.useRemote();
+    GameOptions opts;
+    opts.seed = cfg.seed + st.accepted;
+    opts.threads = 1;   // thousands of sessions share the cores already
+    s->game = std::make_unique<Game>(opts, s->input, nullptr, std::move(screen));
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    ::epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+    if ((size_t)fd >= byFd.size()) byFd.resize((size_t)fd + 1);
+    byFd[fd] = std::move(s);
+    ++st.accepted;
+    st.peak = std::max(st.peak, ++open);
+    pump(*byFd[fd]);   // first frame
+    if (byFd[fd]) flush(*byFd[fd]);
+  }
+}
+
+void GameServer::readFrom(Session& s) {
+  char buf[4096];
+  for (;;) {
+    const ssize_t n = ::recv(s.fd, buf, sizeof buf, 0);
+    if (n == 0) { close(s); return; }
+    if (n < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+      if (errno == EINTR) continue;
+      close(s);
+      return;
+    }
+    st.bytesIn += (uint64_t)n;
+    if (s.over) continue;   // keys after the end go nowhere
+    s.keys.feed(buf, (size_t)n, [&](const KeyDecoder::Event& e) {
+      if (s.over) return;
+      switch (e.kind) {
+        case KeyDecoder::Kind::Key:
+          s.input.push(e.key);
+          break;
+        case KeyDecoder::Kind::Resize:
+          s.screen->resize(std::clamp(e.rows, 10, 500), std::clamp(e.cols, 40, 1000));
+          s.input.push(KEY_RESIZE);
+          break;
+        case KeyDecoder::Kind::Ping:
+          pump(s);   // answer only after what came before is on its way
+          s.out += "\x1b[0n";
+          break;
+      }
+    });
+  }
+  if (!s.over) pump(s);
+  const int fd = s.fd;
+  if (byFd[fd]) flush(s);
+}
+
+// Runs the session until it waits again (keys, tasks, due timers, one
+// frame), then queues its output and its next timer.
+void GameServer::pump(Session& s) {
+  if (s.over) return;
+  ++st.pumps;
+  s.game->runTimers();
+  if (!s.game->tick()) {
+    finish(s);
+    return;
+  }
+  const int ms = s.game->nextTimeoutMs();
+  const uint64_t at = ms < 0 ? 0 : nowMs() + (uint64_t)ms;
+  if (at != 0 && at != s.timerAt) timers.push(Due{ at, s.fd, s.serial });
+  s.timerAt = at;
+}
+
+void GameServer::flush(Session& s) {
+  while (s.sent < s.out.size()) {
+    const ssize_t n = ::send(s.fd, s.out.data() + s.sent, s.out.size() - s.sent,
+                             MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      if (errno != EAGAIN && errno != EWOULDBLOCK) { close(s); return; }
+      if (s.out.size() - s.sent > kMaxBacklog) { close(s); return; }   // not reading
+      watchWrites(s, true);
+      return;
+    }
+    st.bytesOut += (uint64_t)n;
+    s.sent += (size_t)n;
+  }
+  s.out.clear();
+  s.sent = 0;
+  watchWrites(s, false);
+  if (s.over) close(s);
+}
+
+// The game is over ('q' or death): restore the client's terminal, send
+// the last bytes, then hang up.
+void GameServer::finish(Session& s) {
+  s.over = true;
+  s.timerAt = 0;
+  s.game.reset();   // the renderer's last bytes: plain attributes, cursor back
+  s.screen = nullptr;
+  s.out += "\x1b[?1049l";
+}
+
+void GameServer::close(Session& s) {
+  const int fd = s.fd;
+  ::epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+  ::close(fd);
+  ++st.closed;
+  --open;
+  byFd[fd].reset();
+}
+
+void GameServer::watchWrites(Session& s, bool on) {
+  if (s.writing == on) return;
+  s.writing = on;
+  epoll_event ev{};
+  ev.events = on ? EPOLLIN | EPOLLOUT : EPOLLIN;
+  ev.data.fd = s.fd;
+  ::epoll_ctl(epollFd, EPOLL_CTL_MOD, s.fd, &ev);
+}
+
+void GameServer::runDueTimers() {
+  const uint64_t now = nowMs();
+  while (!timers.empty() && timers.top().at <= now) {
+    const Due d = timers.top();
+    timers.pop();
+    if ((size_t)d.fd >= byFd.size() || !byFd[d.fd]) continue;
+    Session& s = *byFd[d.fd];
+    if (s.serial != d.serial || s.timerAt != d.at) continue;   // stale
+    s.timerAt = 0;
+    pump(s);
+    if (byFd[d.fd]) flush(s);
+  }
+}
+
+int GameServer::waitMs() const {
+  if (timers.empty()) return -1;
+  const uint64_t now = nowMs(), at = timers.top().at;
+  return at <= now ? 0 : (int)std::min<uint64_t>(at - now, 60000);
+}
@@ -0,0 +1,99 @@
+#include "Input.h"
+#include "Profiler.h"
+#include <cerrno>
+#include <cstring>
+#include <ncurses.h>
+
+static constexpr const char* kLogMagic = "twindisseia-replay 1";
+
+Input::~Input() {
+  if (log) std::fclose(log);
+}
+
+bool Input::record(const std::string& path, uint64_t seed, const std::string& level,
+                   std::string& err) {
+  log = std::fopen(path.c_str(), "w");
+  if (!log) { err = path + ": " + std::strerror(errno); return false; }
+  std::fprintf(log, "%s\nseed %llu\nlevel %s\n", kLogMagic, (unsigned long long)seed,
+               level.empty() ? "-" : level.c_str());
+  std::fflush(log);
+  start = std::chrono::steady_clock::now();
+  return true;
+}
+
+bool Input::replay(const std::string& path, uint64_t& seed, std::string& level,
+                   std::string& err) {
+  FILE* f = std::fopen(path.c_str(), "r");
+  if (!f) { err = path + ": " + std::strerror(errno); return false; }
+
+  char line[4096], lvl[4096];
+  unsigned long long s = 0;
+  bool ok = std::fgets(line, sizeof line, f) &&
+            !std::strncmp(line, kLogMagic, std::strlen(kLogMagic)) &&
+            std::fgets(line, sizeof line, f) && std::sscanf(line, "seed %llu", &s) == 1 &&
+            std::fgets(line, sizeof line, f) && !std::strncmp(line, "level ", 6);
+  if (!ok) { std::fclose(f); err = path + ": not a replay log"; return false; }
+  std::snprintf(lvl, sizeof lvl, "%s", line + 6);
+  lvl[std::strcspn(lvl, "\r\n")] = 0;
+  level = std::strcmp(lvl, "-") ? lvl : "";
+  seed = s;
+
+  events.clear();
+  unsigned ms;
+  int key;
+  while (std::fscanf(f, "%u %d", &ms, &key) == 2) events.push_back({ ms, key });
+  expected.clear();
+  if (std::fgets(line, sizeof line, f) && !std::strncmp(line, "end ", 4)) {
+    expected = line + 4;
+    expected.erase(expected.find_last_not_of("\r\n") + 1);
+  }
+  std::fclose(f);
+
+  playback = true;
+  pos = 0;
+  return true;
+}
+
+void Input::finish(const std::string& summary) {
+  if (!log) return;
+  std::fprintf(log, "end %s\n", summary.c_str());
+  std::fclose(log);
+  log = nullptr;
+}
+
+int Input::next() {
+  if (pos >= events.size()) return ERR;
+  ++reads;
+  return events[pos++].key;
+}
+
+int Input::nextPushed() {
+  if (pushedPos >= pushed.size()) return ERR;
+  const int key = pushed[pushedPos++];
+  if (pushedPos == pushed.size()) { pushed.clear(); pushedPos = 0; }
+  return key;
+}
+
+int Input::note(int key) {
+  if (key == ERR) return key;
+  ++reads;
+  if (log) {
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    std::fprintf(log, "%lld %d\n", (long long)ms, key);
+    std::fflush(log);   // keep the log usable if the game crashes
+  }
+  return key;
+}
+
+// Never blocks: the main loop sleeps in EventLoop::wait() instead.
+int Input::poll() {
+  const int ch = playback ? next() : note(remote ? nextPushed() : getch());
+  if (ch != ERR) Profiler::inputArrived();
+  return ch;
+}
+
+void Input::discardPending() {
+  if (remote) { pushed.clear(); pushedPos = 0; }
+  else if (!playback) flushinp();
+}
@@ -0,0 +1,210 @@
+#include "ItemRegistry.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+// Same as data/items.ini; used until (or unless) a file is loaded.
+static const char* kBuiltinItems = R"(
+[item Sword]
+slot = weapon
+attack = 1d8
+
+[item Mace]
+slot = weapon
+attack = 2d4
+
+[item Helmet]
+slot = helmet
+defense = 1d2
+
+[item Chest Plate]
+slot = chest
+defense = 1d4
+flat = 1
+
+[item Boots]
+slot = boots
+defense = 1d2
+speed = 2
+
+[loadout player]
+weapon = Sword
+helmet = Helmet
+chest = Chest Plate
+boots = Boots
+
+[loadout enemy]
+weapon = Mace
+helmet = Helmet
+chest = Chest Plate
+)";
+
+static std::string trim(const std::string& s) {
+  const char* ws = " \t\r";
+  const size_t b = s.find_first_not_of(ws);
+  if (b == std::string::npos) return {};
+  return s.substr(b, s.find_last_not_of(ws) - b + 1);
+}
+
+static bool parseSlot(const std::string& s, EquipSlot& out) {
+  if      (s == "weapon") out = EquipSlot::Weapon;
+  else if (s == "helmet") out = EquipSlot::Helmet;
+  else if (s == "chest")  out = EquipSlot::Chest;
+  else if (s == "boots")  out = EquipSlot::Boots;
+  else return false;
+  return true;
+}
+
+static bool parseInt(const std::string& s, int& out) {
+  char* end = nullptr;
+  errno = 0;
+  const long v = std::strtol(s.c_str(), &end, 10);
+  if (s.empty() || *end || errno || v < -1000000 || v > 1000000) return false;
+  out = (int)v;
+  return true;
+}
+
+ItemRegistry& ItemRegistry::global() {
+  static ItemRegistry reg = [] {
+    ItemRegistry r;
+    std::string err;
+    r.parse(kBuiltinItems, "builtin", err);
+    return r;
+  }();
+  return reg;
+}
+
+bool ItemRegistry::load(const std::string& path, std::string& err) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) { err = path + ": " + std::strerror(errno); return false; }
+  std::ostringstream text;
+  text << in.rdbuf();
+  return parse(text.str(), path, err);
+}
+
+bool ItemRegistry::parse(const std::string& text, const std::string& source, std::string& err) {
+  if (inUse) { err = source + ": items are already in use"; return false; }
+  ItemRegistry next;
+  // loadouts may name items defined further down: resolve them at the end
+  struct Pending { std::string loadout, key, item; int line; };
+  std::vector<Pending> pending;
+
+  enum class Section { None, Item, Loadout } section = Section::None;
+  std::string sectionName;
+  Equipment item;
+  bool haveSlot = false;
+  int line = 0, itemLine = 0;
+
+  auto fail = [&](int at, const std::string& msg) {
+    err = source + ":" + std::to_string(at) + ": " + msg;
+    return false;
+  };
+  auto finishItem = [&]() {
+    if (section != Section::Item) return true;
+    if (!haveSlot) return fail(itemLine, "item '" + item.name + "' has no slot");
+    if (next.byName.count(item.name)) return fail(itemLine, "item '" + item.name + "' defined twice");
+    if (next.items.size() >= kNoItem) return fail(itemLine, "too many items");
+    next.byName[item.name] = (ItemId)next.items.size();
+    next.items.push_back(item);
+    return true;
+  };
+
+  std::istringstream in(text);
+  for (std::string raw; std::getline(in, raw); ) {
+    ++line;
+    const std::string l = trim(raw.substr(0, raw.find('#')));
+    if (l.empty()) continue;
+
+    if (l.front() == '[') {
+      if (l.back() != ']') return fail(line, "unterminated section header");
+      if (!finishItem()) return false;
+      const std::string head = trim(l.substr(1, l.size() - 2));
+      const size_t sp = head.find(' ');
+      const std::string kind = head.substr(0, sp);
+      sectionName = sp == std::string::npos ? std::string() : trim(head.substr(sp));
+      if (sectionName.empty()) return fail(line, "section needs a name");
+      if (kind == "item") {
+        section = Section::Item;
+        item = Equipment{};
+        item.name = sectionName;
+        haveSlot = false;
+        itemLine = line;
+      } else if (kind == "loadout") {
+        section = Section::Loadout;
+        next.loadouts[sectionName];
+      } else {
+        return fail(line, "unknown section '" + kind + "'");
+      }
+      continue;
+    }
+
+    const size_t eq = l.find('=');
+    if (eq == std::string::npos) return fail(line, "expected key = value");
+    const std::string key = trim(l.substr(0, eq)), value = trim(l.substr(eq + 1));
+
+    if (section == Section::Item) {
+      bool ok;
+      std::string why;
+      if      (key == "slot")    ok = haveSlot = parseSlot(value, item.slot);
+      else if (key == "attack")  ok = DicePlan::compile(value, item.attackDice, why);
+      else if (key == "defense") ok = DicePlan::compile(value, item.defenseDice, why);
+      else if (key == "flat")    ok = parseInt(value, item.flatDefBonus);
+      else if (key == "speed")   ok = parseInt(value, item.spdBonus);
+      else return fail(line, "unknown item key '" + key + "'");
+      if (!ok) return fail(line, why.empty() ? "bad value for " + key + ": '" + value + "'" : why);
+    } else if (section == Section::Loadout) {
+      EquipSlot slot;
+      if (!parseSlot(key, slot)) return fail(line, "unknown loadout slot '" + key + "'");
+      pending.push_back({ sectionName, key, value, line });
+    } else {
+      return fail(line, "key outside of a section");
+    }
+  }
+  if (!finishItem()) return false;
+
+  for (const Pending& p : pending) {
+    const ItemId id = next.find(p.item);
+    if (id == kNoItem) return fail(p.line, "unknown item '" + p.item + "'");
+    EquipSlot slot;
+    parseSlot(p.key, slot);
+    if (next.items[id].slot != slot) return fail(p.line, "'" + p.item + "' is not a " + p.key);
+    Loadout& lo = next.loadouts[p.loadout];
+    switch (slot) {
+      case EquipSlot::Weapon: lo.weapon = id; break;
+      case EquipSlot::Helmet: lo.helmet = id; break;
+      case EquipSlot::Chest:  lo.chest  = id; break;
+      case EquipSlot::Boots:  lo.boots  = id; break;
+    }
+  }
+
+  *this = std::move(next);
+  inUse = false;
+  return true;
+}
+
+ItemId ItemRegistry::find(const std::string& name) const {
+  inUse = true;
+  auto it = byName.find(name);
+  return it == byName.end() ? kNoItem : it->second;
+}
+
+ItemId ItemRegistry::intern(const Equipment& e) {
+  if (e.name.empty() && e.attackDice.empty() && e.defenseDice.empty() &&
+      e.flatDefBonus == 0 && e.spdBonus == 0)
+    return kNoItem;
+  const ItemId id = find(e.name);
+  if (id != kNoItem || items.size() >= kNoItem) return id;
+  byName[e.name] = (ItemId)items.size();
+  items.push_back(e);
+  return (ItemId)(items.size() - 1);
+}
+
+const Loadout& ItemRegistry::loadout(const std::string& name) const {
+  static const Loadout empty;
+  inUse = true;
+  auto it = loadouts.find(name);
+  return it == loadouts.end() ? empty : it->second;
+}
@@ -0,0 +1,211 @@
+#include "JobSystem.h"
+#include <algorithm>
+
+namespace {
+// which deque the current thread owns (threads not started by a
+// JobSystem count as its owner, deque 0)
+thread_local const JobSystem* tlsSystem = nullptr;
+thread_local unsigned tlsIndex = 0;
+
+constexpr int kSpins = 64;   // empty searches before a worker sleeps
+}
+
+// --- deque (Lê, Pop, Cohen, Zappa Nardelli: "Correct and Efficient
+// Work-Stealing for Weak Memory Models") ---
+
+bool JobSystem::Deque::push(Job* j) {
+  const int64_t b = bottom.load(std::memory_order_relaxed);
+  const int64_t t = top.load(std::memory_order_acquire);
+  if (b - t >= kSize) return false;
+  ring[b & (kSize - 1)].store(j, std::memory_order_relaxed);
+  bottom.store(b + 1, std::memory_order_release);   // publishes the job to thieves
+  return true;
+}
+
+JobSystem::Job* JobSystem::Deque::pop() {
+  const int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+  bottom.store(b, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int64_t t = top.load(std::memory_order_relaxed);
+  if (t > b) {   // empty
+    bottom.store(b + 1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  Job* j = ring[b & (kSize - 1)].load(std::memory_order_relaxed);
+  if (t == b) {
+    // the last job: race the thieves for it
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                     std::memory_order_relaxed))
+      j = nullptr;
+    bottom.store(b + 1, std::memory_order_relaxed);
+  }
+  return j;
+}
+
+JobSystem::Job* JobSystem::Deque::steal() {
+  int64_t t = top.load(std::memory_order_acquire);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  const int64_t b = bottom.load(std::memory_order_acquire);
+  if (t >= b) return nullptr;
+  Job* j = ring[t & (kSize - 1)].load(std::memory_order_relaxed);
+  if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                   std::memory_order_relaxed))
+    return nullptr;   // lost to the owner or another thief
+  return j;
+}
+
+// --- system ---
+
+JobSystem::JobSystem(unsigned threads) {
+  if (threads == 0) threads = std::thread::hardware_concurrency();
+  count = std::max(1u, threads);
+  if (count == 1) return;
+  for (unsigned i = 0; i < count; ++i) deques.push_back(std::make_unique<Deque>());
+  workers.reserve(count - 1);
+  for (unsigned i = 1; i < count; ++i) workers.emplace_back(&JobSystem::workerLoop, this, i);
+}
+
+JobSystem::~JobSystem() {
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    stop = true;
+  }
+  wake.notify_all();
+  for (auto& w : workers) w.join();
+}
+
+unsigned JobSystem::self() const {
+  return tlsSystem == this ? tlsIndex : 0;
+}
+
+void JobSystem::submit(Job* j, bool notifyAll) {
+  // pairs with workerLoop: either it sees `queued` or we see it sleeping
+  queued.fetch_add(1);
+  if (!deques[self()]->push(j)) {
+    queued.fetch_sub(1, std::memory_order_relaxed);
+    execute(j);   // full: no room to share it
+    return;
+  }
+  if (sleepers.load() == 0) return;
+  { std::lock_guard<std::mutex> lock(sleepMutex); }
+  if (notifyAll) wake.notify_all();
+  else           wake.notify_one();
+}
+
+void JobSystem::execute(Job* j) {
+  j->fn(j->ctx, j->begin, j->end);
+  for (uint32_t i = 0; i < j->nextCount; ++i)
+    if (j->next[i]->waiting.fetch_sub(1, std::memory_order_acq_rel) == 1) submit(j->next[i]);
+  j->left->fetch_sub(1, std::memory_order_release);
+}
+
+// Own deque first (newest job), then the others, starting next door.
+JobSystem::Job* JobSystem::find(unsigned me) {
+  Job* j = deques[me]->pop();
+  const unsigned n = threads();
+  for (unsigned k = 1; !j && k < n; ++k) {
+    j = deques[(me + k) % n]->steal();
+    if (j) stolen.fetch_add(1, std::memory_order_relaxed);
+  }
+  if (j) queued.fetch_sub(1, std::memory_order_relaxed);
+  return j;
+}
+
+void JobSystem::helpUntil(const std::atomic<size_t>& left) {
+  const unsigned me = self();
+  while (left.load(std::memory_order_acquire) != 0) {
+    if (Job* j = find(me)) execute(j);
+    else std::this_thread::yield();   // the rest is running elsewhere
+  }
+}
+
+void JobSystem::workerLoop(unsigned me) {
+  tlsSystem = this;
+  tlsIndex = me;
+  int idle = 0;
+  while (!stop.load(std::memory_order_relaxed)) {
+    if (Job* j = find(me)) {
+      execute(j);
+      idle = 0;
+      continue;
+    }
+    if (++idle < kSpins) {
+      std::this_thread::yield();
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(sleepMutex);
+    sleepers.fetch_add(1);
+    wake.wait(lock, [&] { return stop.load() || queued.load() != 0; });
+    sleepers.fetch_sub(1);
+    idle = 0;
+  }
+}
+
+void JobSystem::forChunks(size_t n, size_t grain, void* ctx,
+                          void (*fn)(void*, size_t, size_t)) {
+  const size_t chunks = (n + grain - 1) / grain;
+  std::unique_ptr<Job[]> jobs(new Job[chunks]);
+  std::atomic<size_t> left{ chunks };
+  // pushed last to first, so the owner pops them in order while thieves
+  // take the far end
+  for (size_t c = chunks; c-- > 0; ) {
+    Job& j = jobs[c];
+    j.fn = fn;
+    j.ctx = ctx;
+    j.begin = c * grain;
+    j.end = std::min(n, j.begin + grain);
+    j.left = &left;
+  }
+  for (size_t c = chunks; c-- > 0; ) submit(&jobs[c], c == 0);
+  helpUntil(left);
+}
+
+void JobSystem::run(JobGraph& g) {
+  const size_t n = g.nodes.size();
+  if (count == 1) {
+    // nodes only wait for earlier ones, so index order is a valid order
+    for (JobGraph::Node& node : g.nodes) node.fn();
+    return;
+  }
+  if (n == 0) return;
+  if (!g.built) {
+    g.jobs.reset(new Job[n]);
+    g.edges.clear();
+    for (const JobGraph::Node& node : g.nodes)
+      for (JobGraph::NodeId d : node.next) g.edges.push_back(&g.jobs[d]);
+    size_t e = 0;
+    for (size_t i = 0; i < n; ++i) {
+      Job& j = g.jobs[i];
+      j.fn = [](void* ctx, size_t, size_t) { (*(std::function<void()>*)ctx)(); };
+      j.ctx = &g.nodes[i].fn;
+      j.nextCount = (uint32_t)g.nodes[i].next.size();
+      j.next = j.nextCount ? &g.edges[e] : nullptr;
+      e += j.nextCount;
+    }
+    g.built = true;
+  }
+
+  std::atomic<size_t> left{ n };
+  for (size_t i = 0; i < n; ++i) {
+    g.jobs[i].waiting.store(g.nodes[i].deps, std::memory_order_relaxed);
+    g.jobs[i].left = &left;
+  }
+  // roots go last to first, so the caller starts with the first one
+  for (size_t i = n; i-- > 0; )
+    if (g.nodes[i].deps == 0) submit(&g.jobs[i], true);
+  helpUntil(left);
+}
+
+JobGraph::NodeId JobGraph::add(std::function<void()> fn, std::initializer_list<NodeId> after) {
+  const NodeId id = (NodeId)nodes.size();
+  Node node;
+  node.fn = std::move(fn);
+  for (NodeId a : after) {
+    if (a >= id) continue;   // only earlier nodes
+    nodes[a].next.push_back(id);
+    ++node.deps;
+  }
+  nodes.push_back(std::move(node));
+  built = false;
+  return id;
+}
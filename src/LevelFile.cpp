@@ -0,0 +1,245 @@
+#include "LevelFile.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char     kMagic[4] = { 'T', 'W', 'L', 'V' };
+constexpr uint32_t kVersion  = 1;
+constexpr uint32_t kNoChunk  = UINT32_MAX;
+constexpr uint64_t kAlign    = 4096;   // chunk data starts on a page
+
+struct Header {
+  char     magic[4];
+  uint32_t version;
+  int32_t  width, height;
+  int32_t  chunksX, chunksY;
+  uint32_t chunkCount;     // stored (non-Void) chunks
+  uint32_t spawnCount;
+  uint32_t chunkBytes;     // sizeof(Map::Chunk) when written
+  uint32_t reserved;
+  uint64_t dirOffset;
+  uint64_t spawnOffset;
+  uint64_t chunkOffset;
+  uint64_t metaChecksum;   // header (this field zeroed) + directory + spawns
+  uint64_t dataChecksum;   // chunk data
+};
+static_assert(sizeof(Header) == 80, "level header layout");
+static_assert(sizeof(LevelSpawn) == 12, "spawn record layout");
+static_assert(offsetof(Map::Chunk, walk) == Map::kChunkTiles, "chunk layout");
+
+// FNV-1a, 64-bit.
+uint64_t fnv(const void* data, size_t n, uint64_t h = 0xCBF29CE484222325ull) {
+  const uint8_t* p = (const uint8_t*)data;
+  for (size_t i = 0; i < n; ++i) { h ^= p[i]; h *= 0x100000001B3ull; }
+  return h;
+}
+
+uint64_t metaChecksum(Header h, const uint8_t* dir, size_t dirBytes,
+                      const uint8_t* spawns, size_t spawnBytes) {
+  h.metaChecksum = 0;
+  uint64_t c = fnv(&h, sizeof h);
+  c = fnv(dir, dirBytes, c);
+  return fnv(spawns, spawnBytes, c);
+}
+
+bool writeAll(int fd, const void* data, size_t n) {
+  const uint8_t* p = (const uint8_t*)data;
+  while (n) {
+    ssize_t w = ::write(fd, p, n);
+    if (w <= 0) return false;
+    p += w; n -= (size_t)w;
+  }
+  return true;
+}
+
+// Private copy-on-write mapping of a whole file: tile edits land in our
+// own copies of the touched pages and never reach the file. Unmapped when
+// the last owner goes away.
+struct Mapping {
+  void*  addr = MAP_FAILED;
+  size_t size = 0;
+  ~Mapping() { if (addr != MAP_FAILED) munmap(addr, size); }
+};
+
+// Maps `path` privately (writes stay in memory) and checks the header.
+std::shared_ptr<Mapping> openLevel(const std::string& path, const Header*& hdr,
+                                   std::string& err) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) { err = path + ": " + std::strerror(errno); return nullptr; }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(Header)) {
+    ::close(fd);
+    err = path + ": not a level file";
+    return nullptr;
+  }
+  auto m = std::make_shared<Mapping>();
+  m->size = (size_t)st.st_size;
+  m->addr = mmap(nullptr, m->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (m->addr == MAP_FAILED) { err = path + ": mmap failed"; return nullptr; }
+
+  const uint8_t* base = (const uint8_t*)m->addr;
+  hdr = (const Header*)base;
+  const Header& h = *hdr;
+  if (std::memcmp(h.magic, kMagic, 4) != 0) { err = path + ": bad magic"; return nullptr; }
+  if (h.version != kVersion) { err = path + ": unsupported version"; return nullptr; }
+  if (h.chunkBytes != sizeof(Map::Chunk) || h.width < 0 || h.height < 0 ||
+      h.chunksX != (h.width + Map::kChunkMask) >> Map::kChunkShift ||
+      h.chunksY != (h.height + Map::kChunkMask) >> Map::kChunkShift) {
+    err = path + ": bad header";
+    return nullptr;
+  }
+  const uint64_t dirBytes   = (uint64_t)h.chunksX * h.chunksY * sizeof(uint32_t);
+  const uint64_t spawnBytes = (uint64_t)h.spawnCount * sizeof(LevelSpawn);
+  const uint64_t dataBytes  = (uint64_t)h.chunkCount * sizeof(Map::Chunk);
+  if (h.dirOffset + dirBytes > m->size || h.spawnOffset + spawnBytes > m->size ||
+      h.chunkOffset % kAlign != 0 || h.chunkOffset + dataBytes > m->size) {
+    err = path + ": truncated";
+    return nullptr;
+  }
+  if (metaChecksum(h, base + h.dirOffset, dirBytes, base + h.spawnOffset, spawnBytes) !=
+      h.metaChecksum) {
+    err = path + ": checksum mismatch";
+    return nullptr;
+  }
+  return m;
+}
+
+} // namespace
+
+bool saveLevel(const std::string& path, const Map& map,
+               const std::vector<LevelSpawn>& spawns, std::string& err) {
+  Header h{};
+  std::memcpy(h.magic, kMagic, 4);
+  h.version = kVersion;
+  h.width = map.getWidth();
+  h.height = map.getHeight();
+  h.chunksX = map.chunksAcross();
+  h.chunksY = map.chunksDown();
+  h.spawnCount = (uint32_t)spawns.size();
+  h.chunkBytes = sizeof(Map::Chunk);
+
+  std::vector<uint32_t> dir((size_t)h.chunksX * h.chunksY, kNoChunk);
+  std::vector<const Map::Chunk*> stored;
+  for (int cy = 0; cy < h.chunksY; ++cy)
+    for (int cx = 0; cx < h.chunksX; ++cx)
+      if (const Map::Chunk* c = map.chunkAt(cx, cy)) {
+        dir[(size_t)cy * h.chunksX + cx] = (uint32_t)stored.size();
+        stored.push_back(c);
+      }
+  h.chunkCount = (uint32_t)stored.size();
+
+  const uint64_t dirBytes   = dir.size() * sizeof(uint32_t);
+  const uint64_t spawnBytes = spawns.size() * sizeof(LevelSpawn);
+  h.dirOffset   = sizeof(Header);
+  h.spawnOffset = h.dirOffset + dirBytes;
+  h.chunkOffset = (h.spawnOffset + spawnBytes + kAlign - 1) & ~(kAlign - 1);
+
+  h.dataChecksum = 0xCBF29CE484222325ull;
+  for (const Map::Chunk* c : stored) h.dataChecksum = fnv(c, sizeof *c, h.dataChecksum);
+  h.metaChecksum = metaChecksum(h, (const uint8_t*)dir.data(), dirBytes,
+                                (const uint8_t*)spawns.data(), spawnBytes);
+
+  const std::string tmp = path + ".tmp";
+  int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) { err = tmp + ": " + std::strerror(errno); return false; }
+  static const uint8_t zeros[kAlign] = {};
+  bool ok = writeAll(fd, &h, sizeof h) &&
+            writeAll(fd, dir.data(), dirBytes) &&
+            writeAll(fd, spawns.data(), spawnBytes) &&
+            writeAll(fd, zeros, h.chunkOffset - (h.spawnOffset + spawnBytes));
+  for (size_t i = 0; ok && i < stored.size(); ++i) ok = writeAll(fd, stored[i], sizeof(Map::Chunk));
+  ok = (::close(fd) == 0) && ok;
+  // write-then-rename: a crash never leaves a half-written level behind
+  if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0) {
+    ::unlink(tmp.c_str());
+    err = path + ": write failed";
+    return false;
+  }
+  return true;
+}
+
+bool loadLevel(const std::string& path, Level& out, std::string& err) {
+  const Header* hp = nullptr;
+  std::shared_ptr<Mapping> m = openLevel(path, hp, err);
+  if (!m) return false;
+  const Header& h = *hp;
+  uint8_t* base = (uint8_t*)m->addr;
+
+  const uint32_t* dir = (const uint32_t*)(base + h.dirOffset);
+  Map::Chunk* data = (Map::Chunk*)(base + h.chunkOffset);
+  std::vector<Map::Chunk*> chunks((size_t)h.chunksX * h.chunksY, nullptr);
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    if (dir[i] == kNoChunk) continue;
+    if (dir[i] >= h.chunkCount) { err = path + ": bad chunk directory"; return false; }
+    chunks[i] = data + dir[i];
+  }
+  // chunk pages are read on first touch, in no particular order
+  if (h.chunkCount)
+    madvise(base + h.chunkOffset, (size_t)h.chunkCount * sizeof(Map::Chunk), MADV_RANDOM);
+
+  const LevelSpawn* sp = (const LevelSpawn*)(base + h.spawnOffset);
+  out.spawns.assign(sp, sp + h.spawnCount);
+  out.map = Map(h.width, h.height, false);
+  out.map.attachChunks(chunks, std::move(m));
+  return true;
+}
+
+bool verifyLevel(const std::string& path, std::string& err) {
+  const Header* hp = nullptr;
+  std::shared_ptr<Mapping> m = openLevel(path, hp, err);
+  if (!m) return false;
+  const uint8_t* data = (const uint8_t*)m->addr + hp->chunkOffset;
+  madvise((void*)data, (size_t)hp->chunkCount * sizeof(Map::Chunk), MADV_SEQUENTIAL);
+  if (fnv(data, (size_t)hp->chunkCount * sizeof(Map::Chunk)) != hp->dataChecksum) {
+    err = path + ": chunk data checksum mismatch";
+    return false;
+  }
+  return true;
+}
+
+bool parseAsciiLevel(const std::string& text, Level& out, std::string& err) {
+  // measure first so the map is allocated once
+  int w = 0, h = 0, len = 0;
+  for (char c : text) {
+    if (c == '\n') { w = std::max(w, len); len = 0; ++h; }
+    else if (c != '\r') ++len;
+  }
+  if (len) { w = std::max(w, len); ++h; }
+  if (w == 0 || h == 0) { err = "empty layout"; return false; }
+
+  out.map = Map(w, h, false);
+  out.spawns.clear();
+  int x = 0, y = 0;
+  for (char c : text) {
+    if (c == '\n') { x = 0; ++y; continue; }
+    if (c == '\r') continue;
+    LevelSpawn s;
+    s.x = x; s.y = y;
+    switch (c) {
+      case '#': out.map.setTile(x, y, Tile::Wall); break;
+      case '.': out.map.setTile(x, y, Tile::Floor); break;
+      case ' ': break;
+      case '@': s.kind = LevelSpawn::Player; break;
+      case 'g': s.kind = LevelSpawn::Enemy;  break;
+      case 'N': s.kind = LevelSpawn::NPC;    break;
+      default:
+        err = "unknown character '" + std::string(1, c) + "' at line " + std::to_string(y + 1);
+        return false;
+    }
+    if (c == '@' || c == 'g' || c == 'N') {
+      out.map.setTile(x, y, Tile::Floor);
+      out.spawns.push_back(s);
+    }
+    ++x;
+  }
+  return true;
+}
@@ -1,35 +1,166 @@
 #include "Map.h"
 #include <algorithm>
+#include <cstring>
+#include <sys/mman.h>
+#include <unistd.h>
 
-Map::Map(int w, int h) : width(w), height(h), grid(h, std::string(w, '.')) {
+const Map::Chunk Map::emptyChunk = {};
+
+Map::Map(int w, int h, bool bordered)
+    : width(std::max(0, w)), height(std::max(0, h)),
+      chunksX((width  + kChunkMask) >> kChunkShift),
+      chunksY((height + kChunkMask) >> kChunkShift),
+      dir((size_t)chunksX * chunksY, const_cast<Chunk*>(&emptyChunk)),
+      dirtyFlag(dir.size(), 0), editedFlag(dir.size(), 0) {
+    if (!bordered) return;
+
+    fillRect(0, 0, width, height, Tile::Floor);
     // walls (border)
-    for (int i = 0; i < width; ++i) {
-        grid[0][i] = '#';
-        grid[height - 1][i] = '#';
+    fillRect(0, 0, width, 1, Tile::Wall);
+    fillRect(0, height - 1, width, 1, Tile::Wall);
+    fillRect(0, 0, 1, height, Tile::Wall);
+    fillRect(width - 1, 0, 1, height, Tile::Wall);
+}
+
+Map::Chunk* Map::chunkForWrite(int cx, int cy) {
+    Chunk*& slot = dir[(size_t)cy * chunksX + cx];
+    if (slot == &emptyChunk) {
+        store.push_back(std::make_unique<Chunk>(emptyChunk));
+        slot = store.back().get();
     }
-    for (int i = 0; i < height; ++i) {
-        grid[i][0] = '#';
-        grid[i][width - 1] = '#';
+    return slot;
+}
+
+Tile Map::getTile(int x, int y) const {
+    if (x < 0 || y < 0 || x >= width || y >= height) return Tile::Void;
+    const Chunk* c = dir[(y >> kChunkShift) * chunksX + (x >> kChunkShift)];
+    return (Tile)c->tiles[((y & kChunkMask) << kChunkShift) | (x & kChunkMask)];
+}
+
+void Map::setTile(int x, int y, Tile t) {
+    if (x < 0 || y < 0 || x >= width || y >= height) return;
+    const int cx = x >> kChunkShift, cy = y >> kChunkShift;
+    if (t == Tile::Void && dir[(size_t)cy * chunksX + cx] == &emptyChunk) return;
+
+    Chunk* c = chunkForWrite(cx, cy);
+    const int i = ((y & kChunkMask) << kChunkShift) | (x & kChunkMask);
+    if (c->tiles[i] == (uint8_t)t) return;
+    c->tiles[i] = (uint8_t)t;
+    ++ver;
+    const size_t ci = (size_t)cy * chunksX + cx;
+    if (!dirtyFlag[ci]) { dirtyFlag[ci] = 1; dirtyList.push_back((uint32_t)ci); }
+    markEdited(ci);
+    const uint64_t bit = 1ull << (i & 63);
+    if (walkable(t)) c->walk[i >> 6] |= bit;
+    else             c->walk[i >> 6] &= ~bit;
+}
+
+void Map::fillRect(int x0, int y0, int w, int h, Tile t) {
+    const int x1 = std::min(width,  x0 + w), y1 = std::min(height, y0 + h);
+    x0 = std::max(0, x0); y0 = std::max(0, y0);
+    for (int y = y0; y < y1; ++y)
+        for (int x = x0; x < x1; ++x)
+            setTile(x, y, t);
+}
+
+char Map::glyph(Tile t) {
+    switch (t) {
+        case Tile::Floor: return '.';
+        case Tile::Wall:  return '#';
+        case Tile::StairsDown: return '>';
+        case Tile::StairsUp:   return '<';
+        default:          return ' ';
     }
 }
 
-void Map::drawTo(WINDOW* win) const {
+int Map::viewOrigin(int center, int mapSize, int viewSize) {
+    if (mapSize <= viewSize) return 0;
+    int o = center - viewSize / 2;
+    return std::clamp(o, 0, mapSize - viewSize);
+}
+
+void Map::drawTo(WINDOW* win, int originX, int originY) const {
     if (!win) return;
     int h = 0, w = 0;
     getmaxyx(win, h, w);
 
-    const int rows = std::min(height, h);
-    const int cols = std::min(width,  w);
+    const int rows = std::min(height - originY, h);
+    const int cols = std::min(width  - originX, w);
+    if (rows <= 0 || cols <= 0) return;
+
+    std::vector<char> line(cols);
     for (int y = 0; y < rows; ++y) {
+        const int my = originY + y;
+        const Chunk* const* row = &dir[(size_t)(my >> kChunkShift) * chunksX];
+        const int ry = (my & kChunkMask) << kChunkShift;
+        for (int x = 0; x < cols; ++x) {
+            const int mx = originX + x;
+            line[x] = glyph((Tile)row[mx >> kChunkShift]->tiles[ry | (mx & kChunkMask)]);
+        }
         // draw only the visible slice
-        mvwaddnstr(win, y, 0, grid[y].c_str(), cols);
+        mvwaddnstr(win, y, 0, line.data(), cols);
     }
 }
 
-bool Map::isWalkable(int x, int y) const {
-    if (x < 0 || y < 0 || x >= width || y >= height) return false;
-    return grid[y][x] != '#';
-}
-
 int Map::getWidth()  const { return width;  }
 int Map::getHeight() const { return height; }
+
+void Map::attachChunks(const std::vector<Chunk*>& chunks, std::shared_ptr<void> mem) {
+    if (chunks.size() != dir.size()) return;
+    store.clear();
+    attached = 0;
+    for (size_t i = 0; i < dir.size(); ++i) {
+        dir[i] = chunks[i] ? chunks[i] : const_cast<Chunk*>(&emptyChunk);
+        attached += chunks[i] != nullptr;
+        markEdited(i);
+    }
+    backing = std::move(mem);
+    ++ver;
+}
+
+void Map::writeChunk(int cx, int cy, const Chunk& data) {
+    if (cx < 0 || cy < 0 || cx >= chunksX || cy >= chunksY) return;
+    *chunkForWrite(cx, cy) = data;
+    markEdited((size_t)cy * chunksX + cx);
+    ++ver;
+}
+
+void Map::clearDirty() {
+    for (uint32_t ci : dirtyList) dirtyFlag[ci] = 0;
+    dirtyList.clear();
+}
+
+void Map::markPristine() {
+    for (uint32_t ci : editedList) editedFlag[ci] = 0;
+    editedList.clear();
+}
+
+void Map::markEditsAgainst(const Map& base) {
+    markPristine();
+    const bool same = width == base.width && height == base.height;
+    for (size_t ci = 0; ci < dir.size(); ++ci)
+        if (!same || std::memcmp(dir[ci]->tiles, base.dir[ci]->tiles, sizeof(Chunk::tiles)) != 0)
+            markEdited(ci);
+}
+
+void Map::prefetch(int x0, int y0, int w, int h) const {
+    if (!backing || w <= 0 || h <= 0) return;
+    const int cx0 = std::max(0, x0) >> kChunkShift, cy0 = std::max(0, y0) >> kChunkShift;
+    const int cx1 = std::min(width  - 1, x0 + w - 1) >> kChunkShift;
+    const int cy1 = std::min(height - 1, y0 + h - 1) >> kChunkShift;
+    static const uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+    for (int cy = cy0; cy <= cy1; ++cy)
+        for (int cx = cx0; cx <= cx1; ++cx) {
+            const Chunk* c = dir[(size_t)cy * chunksX + cx];
+            if (c == &emptyChunk) continue;
+            const uintptr_t a = (uintptr_t)c & ~(page - 1);
+            const uintptr_t e = (uintptr_t)c + sizeof(Chunk);
+            madvise((void*)a, e - a, MADV_WILLNEED);
+        }
+}
+
+size_t Map::memoryBytes() const {
+    return dir.capacity() * sizeof(Chunk*) +
+           store.capacity() * sizeof(std::unique_ptr<Chunk>) +
+           store.size() * sizeof(Chunk);
+}
@@ -0,0 +1,139 @@
+#include "MessageLog.h"
+#include <algorithm>
+#include <charconv>
+
+// Indexed by MsgId. {0}..{7} are numeric arguments, {s} the string one.
+static const char* const kTemplates[] = {
+  "{s}",
+  "Explore the map. Move with WASD/Arrows, press Q to quit. Step on 'g' to battle, 'N' to talk, '>' to go down stairs.",
+  "Combat started! You act first.",
+  "Combat started! Enemy acts first.",
+  "You attack! Rolling...",
+  "Enemy attacks! Rolling...",
+  "You attack: d6={0} + atk={1} + w={2}  vs  def={3} + flat={4} + arm={5} -> {6} dmg.",
+  "Enemy attack: d6={0} + atk={1} + w={2}  vs  def={3} + flat={4} + arm={5} -> {6} dmg.",
+  "You died! Press any key to exit.",
+  "You defeated the enemy! (+Victory)",
+  "[NPC] {s}",
+  "You talked to the NPC.",
+  "You go down the stairs to depth {0}.",
+  "You climb the stairs back up to depth {0}.",
+  "The stairs lead into darkness...",
+  "There are no stairs here.",
+};
+static_assert(sizeof(kTemplates) / sizeof(kTemplates[0]) == (size_t)MsgId::NoStairs + 1,
+              "one template per MsgId");
+
+static constexpr size_t kSlotText = 160;   // reserved per slot; longer texts grow it once
+
+MessageLog::MessageLog() : ring(kCapacity) {
+  for (Slot& s : ring) s.text.reserve(kSlotText);
+}
+
+void MessageLog::store(const LogEntry& e) {
+  // a progress line is replaced by whatever comes next
+  if (count > 0 && slot(count - 1).e.transient) {
+    head = (head + kCapacity - 1) % kCapacity;
+    --count;
+  }
+  Slot& s = ring[head];
+  s.e = e;
+  s.formatted = false;
+  s.width = -1;
+  head = (head + 1) % kCapacity;
+  if (count < kCapacity) ++count;
+  ++changes;
+}
+
+void MessageLog::push(MsgId id, std::initializer_list<int> args, bool transient) {
+  LogEntry e;
+  e.id = id;
+  e.transient = transient;
+  for (int a : args) {
+    if (e.argc == LogEntry::kMaxArgs) break;
+    e.args[e.argc++] = a;
+  }
+  store(e);
+}
+
+void MessageLog::push(MsgId id, const std::string& s) {
+  LogEntry e;
+  e.id = id;
+  auto it = stringIds.find(s);
+  if (it == stringIds.end()) {
+    it = stringIds.emplace(s, (uint32_t)strings.size()).first;
+    strings.push_back(s);
+  }
+  e.str = it->second;
+  store(e);
+}
+
+void MessageLog::clear() {
+  head = count = 0;
+  strings.clear();
+  stringIds.clear();
+  ++changes;
+}
+
+void MessageLog::format(const LogEntry& e, std::string& out) const {
+  out.clear();
+  const size_t t = (size_t)e.id;
+  const char* p = t < sizeof(kTemplates) / sizeof(kTemplates[0]) ? kTemplates[t] : "";
+  while (*p) {
+    if (p[0] == '{' && p[1] && p[2] == '}') {
+      if (p[1] == 's') {
+        if (e.str < strings.size()) out += strings[e.str];
+      } else if (p[1] >= '0' && p[1] - '0' < e.argc) {
+        char buf[16];
+        auto r = std::to_chars(buf, buf + sizeof buf, e.args[p[1] - '0']);
+        out.append(buf, r.ptr);
+      }
+      p += 3;
+      continue;
+    }
+    out += *p++;
+  }
+}
+
+const std::string& MessageLog::text(size_t i) const {
+  Slot& s = slot(i);
+  if (!s.formatted) {
+    format(s.e, s.text);
+    s.formatted = true;
+  }
+  return s.text;
+}
+
+int MessageLog::wrap(size_t i, int width, const Span*& lines) const {
+  const std::string& t = text(i);
+  Slot& s = slot(i);
+  if (s.width != width) {
+    s.lineCount = wrapSpans(t.data(), t.size(), width, s.lines, kMaxLines);
+    s.width = width;
+  }
+  lines = s.lines;
+  return s.lineCount;
+}
+
+// Breaks at the last space that fits; words longer than a line are cut.
+// Spaces at line ends are dropped.
+int MessageLog::wrapSpans(const char* s, size_t n, int width, Span* out, int max) {
+  if (width <= 0) return 0;
+  n = std::min<size_t>(n, UINT16_MAX);
+  int lines = 0;
+  size_t i = 0;
+  while (i < n && lines < max) {
+    size_t len = std::min((size_t)width, n - i);
+    if (len == (size_t)width && i + len < n) {
+      size_t brk = len;
+      while (brk > 0 && s[i + brk - 1] != ' ' && s[i + brk] != ' ') --brk;
+      if (brk > 0) len = brk;
+    }
+    size_t end = i + len;
+    while (end > i && s[end - 1] == ' ') --end;
+    out[lines++] = Span{ (uint16_t)i, (uint16_t)(end - i) };
+    i += len;
+    while (i < n && s[i] == ' ') ++i;
+  }
+  return lines;
+}
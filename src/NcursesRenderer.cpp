@@ -0,0 +1,63 @@
+#include "NcursesRenderer.h"
+#include <algorithm>
+
+NcursesRenderer::~NcursesRenderer() {
+  for (WINDOW*& w : win)
+    if (w) { delwin(w); w = nullptr; }
+}
+
+void NcursesRenderer::measure(int& rows, int& cols) {
+  rows = LINES;
+  cols = COLS;
+}
+
+void NcursesRenderer::place(Panel p, int y, int x, int h, int w) {
+  if (win[p]) delwin(win[p]);
+  win[p] = newwin(h, w, y, x);
+  if (win[p] && p != Hud) keypad(win[p], TRUE);
+}
+
+chtype NcursesRenderer::attrOf(uint8_t style) {
+  chtype a = A_NORMAL;
+  if (style & kBold)      a |= A_BOLD;
+  if (style & kDim)       a |= A_DIM;
+  if (style & kReverse)   a |= A_REVERSE;
+  if (style & kLineChars) a |= A_ALTCHARSET;
+  if ((style & kColorBits) && has_colors()) a |= COLOR_PAIR(style & kColorBits);
+  return a;
+}
+
+void NcursesRenderer::clear(Panel p) {
+  if (win[p]) werase(win[p]);
+}
+
+void NcursesRenderer::text(Panel p, int y, int x, const char* s, int n, uint8_t style) {
+  WINDOW* w = win[p];
+  if (!w) return;
+  n = std::min(n, getmaxx(w) - x);   // addnstr would wrap onto the next line
+  if (n <= 0) return;
+  wattrset(w, attrOf(style));
+  mvwaddnstr(w, y, x, s, n);
+  wattrset(w, A_NORMAL);
+}
+
+void NcursesRenderer::cells(Panel p, int y, int x, const Cell* c, int n) {
+  WINDOW* w = win[p];
+  if (!w || n <= 0) return;
+  row.resize((size_t)n + 1);
+  for (int i = 0; i < n; ++i) row[i] = (chtype)(unsigned char)c[i].ch | attrOf(c[i].style);
+  row[n] = 0;
+  mvwaddchnstr(w, y, x, row.data(), n);   // clips at the edge, no wrap
+}
+
+void NcursesRenderer::box(Panel p) {
+  if (win[p]) ::box(win[p], 0, 0);
+}
+
+void NcursesRenderer::touch(Panel p) {
+  if (win[p]) wnoutrefresh(win[p]);
+}
+
+void NcursesRenderer::present() {
+  doupdate();
+}
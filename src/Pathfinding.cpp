@@ -0,0 +1,157 @@
+#include "Pathfinding.h"
+#include <algorithm>
+#include <cstdlib>
+
+static const int kDX[4] = { 0, 0, -1, 1 };
+static const int kDY[4] = { -1, 1, 0, 0 };
+
+// ---------------- Pathfinder (A*) ----------------
+
+Pathfinder::Pathfinder(const Map& map, int maxNodes)
+: map(map), maxNodes(std::max(16, maxNodes)) {
+  size_t cap = 1;
+  while (cap < (size_t)this->maxNodes * 2) cap <<= 1;   // load factor <= 0.5
+  nodes.assign(cap, Node{ 0, 0, 0, 0, false });
+  open.reserve((size_t)this->maxNodes * 4);
+}
+
+uint32_t Pathfinder::lookup(uint64_t tile, bool& fresh) {
+  const size_t mask = nodes.size() - 1;
+  size_t i = (size_t)((tile * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+  while (nodes[i].stamp == curStamp) {
+    if (nodes[i].tile == tile) { fresh = false; return (uint32_t)i; }
+    i = (i + 1) & mask;
+  }
+  fresh = true;
+  Node& n = nodes[i];
+  n.tile = tile;
+  n.stamp = curStamp;
+  n.closed = false;
+  ++used;
+  return (uint32_t)i;
+}
+
+bool Pathfinder::findPath(int sx, int sy, int tx, int ty, std::vector<PathPoint>& out) {
+  out.clear();
+  expanded = 0;
+  if (!map.isWalkable(tx, ty)) return false;
+  if (sx == tx && sy == ty) return true;
+
+  // new query: bump the stamp instead of clearing the table
+  if (++curStamp == 0) {
+    for (auto& n : nodes) n.stamp = 0;
+    curStamp = 1;
+  }
+  used = 0;
+  open.clear();
+
+  const uint64_t W = (uint64_t)map.getWidth();
+  auto h = [&](int x, int y) { return (uint32_t)(std::abs(x - tx) + std::abs(y - ty)); };
+  auto cmp = [](const OpenItem& a, const OpenItem& b) {
+    return a.f != b.f ? a.f > b.f : a.g < b.g;   // min f, prefer deeper on ties
+  };
+
+  bool fresh;
+  uint32_t start = lookup((uint64_t)sy * W + sx, fresh);
+  nodes[start].g = 0;
+  nodes[start].parent = UINT32_MAX;
+  open.push_back({ h(sx, sy), 0, start });
+
+  while (!open.empty()) {
+    std::pop_heap(open.begin(), open.end(), cmp);
+    OpenItem cur = open.back();
+    open.pop_back();
+
+    Node& n = nodes[cur.node];
+    if (n.closed || cur.g != n.g) continue;        // stale heap entry
+    n.closed = true;
+    ++expanded;
+
+    const int x = (int)(n.tile % W), y = (int)(n.tile / W);
+    if (x == tx && y == ty) {
+      for (uint32_t k = cur.node; nodes[k].parent != UINT32_MAX; k = nodes[k].parent)
+        out.push_back({ (int)(nodes[k].tile % W), (int)(nodes[k].tile / W) });
+      std::reverse(out.begin(), out.end());
+      return true;
+    }
+    if (expanded >= maxNodes) break;
+
+    for (int k = 0; k < 4; ++k) {
+      const int nx = x + kDX[k], ny = y + kDY[k];
+      if (!map.isWalkable(nx, ny)) continue;
+      if (used >= (uint32_t)maxNodes * 2 - 1) break;  // table full
+      const uint32_t g = cur.g + 1;
+      uint32_t m = lookup((uint64_t)ny * W + nx, fresh);
+      Node& nb = nodes[m];
+      if (!fresh && (nb.closed || nb.g <= g)) continue;
+      nb.g = g;
+      nb.parent = cur.node;
+      open.push_back({ g + h(nx, ny), g, m });
+      std::push_heap(open.begin(), open.end(), cmp);
+    }
+  }
+  return false;
+}
+
+// ---------------- FlowField ----------------
+
+FlowField::FlowField(const Map& map, int radius)
+: map(map), r(std::max(1, radius)), side(2 * r + 1),
+  dist((size_t)side * side, kUnreached), dir((size_t)side * side, 0) {
+  queue.reserve((size_t)side * side);
+}
+
+bool FlowField::update(int x, int y) {
+  if (valid && x == tx && y == ty && map.version() == mapVersion) return false;
+  tx = x; ty = y;
+  rebuild();
+  return true;
+}
+
+void FlowField::rebuild() {
+  ox = tx - r; oy = ty - r;
+  mapVersion = map.version();
+  valid = true;
+  ++rebuildCount;
+
+  std::fill(dist.begin(), dist.end(), kUnreached);
+  std::fill(dir.begin(), dir.end(), 0);
+  queue.clear();
+
+  int ti;
+  if (!inWindow(tx, ty, ti)) return;
+  dist[ti] = 0;
+  queue.push_back((uint32_t)ti);
+
+  // unit costs: breadth-first order is Dijkstra order
+  for (size_t head = 0; head < queue.size(); ++head) {
+    const int i = (int)queue[head];
+    const int lx = i % side, ly = i / side;
+    const uint32_t d = dist[i];
+    for (int k = 0; k < 4; ++k) {
+      const int nx = lx + kDX[k], ny = ly + kDY[k];
+      if ((unsigned)nx >= (unsigned)side || (unsigned)ny >= (unsigned)side) continue;
+      const int j = ny * side + nx;
+      if (dist[j] != kUnreached) continue;
+      if (!map.isWalkable(ox + nx, oy + ny)) continue;
+      dist[j] = d + 1;
+      // neighbour j reached from i: stepping from j goes back toward i
+      dir[j] = (uint8_t)((k ^ 1) + 1);
+      queue.push_back((uint32_t)j);
+    }
+  }
+}
+
+bool FlowField::step(int x, int y, int& dx, int& dy) const {
+  int i;
+  if (!valid || !inWindow(x, y, i) || dir[i] == 0) return false;
+  dx = kDX[dir[i] - 1];
+  dy = kDY[dir[i] - 1];
+  return true;
+}
+
+uint32_t FlowField::distance(int x, int y) const {
+  int i;
+  if (!valid || !inWindow(x, y, i)) return kUnreached;
+  return dist[i];
+}
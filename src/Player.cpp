@@ -21,12 +21,22 @@ int  Player::getX() const { return x; }
 int  Player::getY() const { return y; }
 
 int  Player::getHP() const { return hp; }
-int  Player::getSpeed() const { return baseSpeed + boots.spdBonus; }
+int  Player::getSpeed() const { return baseSpeed + getBoots().spdBonus; }
 int  Player::getAttack() const { return baseAttack; }
 int  Player::getDefense() const { return baseDefense; }
 
 bool Player::isAlive() const { return hp > 0; }
 
+void Player::equip(ItemId id) {
+    if (id == kNoItem) return;
+    switch (ItemRegistry::global().get(id).slot) {
+        case EquipSlot::Weapon: weapon = id; break;
+        case EquipSlot::Helmet: helmet = id; break;
+        case EquipSlot::Chest:  chest  = id; break;
+        case EquipSlot::Boots:  boots  = id; break;
+    }
+}
+
 void Player::takeDamage(int dmg) {
     hp -= dmg;
     if (hp < 0) hp = 0;
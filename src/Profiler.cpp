@@ -0,0 +1,158 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+// One trace event. Fields are relaxed atomics so a dump racing a writer
+// reads stale values rather than undefined ones; `seq` (index + 1 once
+// written, 0 while being written) tells the reader whether they belong
+// together.
+struct Slot {
+  std::atomic<uint64_t> seq{0};
+  std::atomic<const char*> name{nullptr};
+  std::atomic<uint64_t> start{0}, dur{0};
+  std::atomic<uint32_t> tid{0};
+};
+
+Slot ring[Profiler::kRingSize];
+std::atomic<uint64_t> head{0};
+std::atomic<uint32_t> nextTid{1};
+
+const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+uint32_t threadId() {
+  thread_local const uint32_t id = nextTid.fetch_add(1, std::memory_order_relaxed);
+  return id;
+}
+uint32_t mainTid = 0;
+
+// Fixed windows of the newest samples (main thread only).
+struct Window {
+  uint64_t ns[Profiler::kSamples] = {};
+  size_t count = 0;
+
+  void push(uint64_t v) { ns[count++ % Profiler::kSamples] = v; }
+  size_t size() const { return std::min(count, Profiler::kSamples); }
+
+  void percentiles(double& p50, double& p99) const {
+    const size_t n = size();
+    if (n == 0) { p50 = p99 = 0; return; }
+    uint64_t tmp[Profiler::kSamples];
+    std::copy(ns, ns + n, tmp);
+    auto at = [&](size_t k) { std::nth_element(tmp, tmp + k, tmp + n); return tmp[k] / 1e6; };
+    p50 = at(n / 2);
+    p99 = at(std::min(n - 1, n * 99 / 100));
+  }
+};
+
+Window frames, inputs;
+uint64_t frameStart = 0;   // end of the last wait, 0 = unknown
+uint64_t keyAt = 0;        // oldest key not yet on screen, 0 = none
+bool frameWorked = false;
+
+}
+
+void Profiler::setEnabled(bool enable) {
+  if (enable == enabled()) return;
+  if (enable && !mainTid) mainTid = threadId();
+  // samples taken across an off period would be meaningless
+  frameStart = keyAt = 0;
+  frameWorked = false;
+  on.store(enable, std::memory_order_relaxed);
+}
+
+uint64_t Profiler::now() {
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - epoch).count();
+}
+
+void Profiler::record(const char* name, uint64_t startNs, uint64_t endNs) {
+  const uint64_t i = head.fetch_add(1, std::memory_order_relaxed);
+  Slot& s = ring[i & (kRingSize - 1)];
+  s.seq.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  s.name.store(name, std::memory_order_relaxed);
+  s.start.store(startNs, std::memory_order_relaxed);
+  s.dur.store(endNs - startNs, std::memory_order_relaxed);
+  s.tid.store(threadId(), std::memory_order_relaxed);
+  s.seq.store(i + 1, std::memory_order_release);
+}
+
+void Profiler::idleBegin() {
+  if (!enabled()) return;
+  if (frameStart && frameWorked) frames.push(now() - frameStart);
+  frameStart = 0;
+}
+
+void Profiler::idleEnd() {
+  if (!enabled()) return;
+  frameStart = now();
+  frameWorked = false;
+}
+
+void Profiler::inputArrived() {
+  if (!enabled()) return;
+  frameWorked = true;
+  if (!keyAt) keyAt = frameStart ? frameStart : now();
+}
+
+void Profiler::presented() {
+  if (!enabled()) return;
+  frameWorked = true;
+  if (keyAt) { inputs.push(now() - keyAt); keyAt = 0; }
+}
+
+ProfileSummary Profiler::summary() {
+  ProfileSummary s;
+  frames.percentiles(s.frameP50Ms, s.frameP99Ms);
+  inputs.percentiles(s.inputP50Ms, s.inputP99Ms);
+  s.frames = frames.size();
+  s.inputs = inputs.size();
+  return s;
+}
+
+uint64_t Profiler::eventsRecorded() {
+  return head.load(std::memory_order_relaxed);
+}
+
+bool Profiler::writeTrace(const std::string& path, size_t& written, std::string& err) {
+  struct Event { const char* name; uint64_t start, dur; uint32_t tid; };
+  std::vector<Event> events;
+  const uint64_t end = head.load(std::memory_order_acquire);
+  const uint64_t begin = end > kRingSize ? end - kRingSize : 0;
+  events.reserve((size_t)(end - begin));
+  for (uint64_t i = begin; i < end; ++i) {
+    const Slot& s = ring[i & (kRingSize - 1)];
+    const uint64_t seq = s.seq.load(std::memory_order_acquire);
+    if (seq != i + 1) continue;   // still being written, or already overwritten
+    Event e{ s.name.load(std::memory_order_relaxed), s.start.load(std::memory_order_relaxed),
+             s.dur.load(std::memory_order_relaxed), s.tid.load(std::memory_order_relaxed) };
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (s.seq.load(std::memory_order_relaxed) != seq || !e.name) continue;
+    events.push_back(e);
+  }
+
+  FILE* f = std::fopen(path.c_str(), "w");
+  if (!f) { err = path + ": " + std::strerror(errno); return false; }
+  std::fprintf(f, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+  std::fprintf(f, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, "
+                  "\"args\": {\"name\": \"twindisseia\"}}");
+  if (mainTid)
+    std::fprintf(f, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, "
+                    "\"args\": {\"name\": \"main\"}}", mainTid);
+  // names are string literals from the source, so they need no escaping
+  for (const Event& e : events)
+    std::fprintf(f, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, "
+                    "\"ts\": %.3f, \"dur\": %.3f}",
+                 e.name, e.tid, e.start / 1e3, e.dur / 1e3);
+  std::fprintf(f, "\n]}\n");
+  const bool ok = !std::ferror(f);
+  if (std::fclose(f) != 0 || !ok) { err = path + ": write failed"; return false; }
+  written = events.size();
+  return true;
+}
@@ -0,0 +1,177 @@
+#include "Rng.h"
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RNG_HAVE_X86 1
+#endif
+
+// SplitMix64: used only to expand seeds into full xoshiro state.
+static uint64_t splitmix64(uint64_t& x) {
+  uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+static uint64_t mixStream(uint64_t stream, uint64_t id) {
+  uint64_t x = stream ^ (id * 0xD1B54A32D192ED03ull);
+  return splitmix64(x);
+}
+
+Rng::Rng(uint64_t seedV, uint64_t stream) { seed(seedV, stream); }
+
+void Rng::seed(uint64_t seedV, uint64_t stream) {
+  seedKey = seedV;
+  streamKey = stream;
+  uint64_t x = seedV ^ mixStream(stream, 0x5EED);
+  for (int i = 0; i < 4; ++i) s[i] = splitmix64(x);
+  // all-zero state is the one invalid xoshiro state
+  if ((s[0] | s[1] | s[2] | s[3]) == 0) s[0] = 1;
+}
+
+Rng Rng::split(uint64_t id) const {
+  return Rng(seedKey, mixStream(streamKey, id + 1));
+}
+
+// ---------------- RngBatch ----------------
+
+RngBatch::RngBatch(const Rng& parent) : fallback(parent.split(~0ull)) {
+  for (int l = 0; l < kLanes; ++l) {
+    Rng lane = parent.split(0xBA7C0000ull + l);
+    for (int w = 0; w < 4; ++w) s[w][l] = lane();
+  }
+}
+
+bool RngBatch::usingSimd() {
+#ifdef RNG_HAVE_X86
+  static const bool avx2 = __builtin_cpu_supports("avx2");
+  return avx2;
+#else
+  return false;
+#endif
+}
+
+void RngBatch::bounded(uint32_t* out, size_t n, uint32_t bound) {
+  if (bound == 0) { std::fill(out, out + n, 0u); return; }
+#ifdef RNG_HAVE_X86
+  if (usingSimd()) { boundedAvx2(out, n, bound); return; }
+#endif
+  boundedScalar(out, n, bound);
+}
+
+// Element order in a block of 8: lane 0 low word, lane 0 high word, lane 1
+// low word, ... (the in-memory order of four uint64 results). Both paths
+// follow it, and both re-draw rejected elements from `fallback` in index
+// order, so results do not depend on the CPU.
+void RngBatch::boundedScalar(uint32_t* out, size_t n, uint32_t bound) {
+  const uint32_t threshold = (uint32_t)(-bound) % bound;
+  auto rotl = [](uint64_t x, int k){ return (x << k) | (x >> (64 - k)); };
+
+  for (size_t i = 0; i < n; i += 2 * kLanes) {
+    uint32_t block[2 * kLanes];
+    for (int l = 0; l < kLanes; ++l) {
+      uint64_t r = rotl(s[1][l] * 5, 7) * 9;
+      uint64_t t = s[1][l] << 17;
+      s[2][l] ^= s[0][l];
+      s[3][l] ^= s[1][l];
+      s[1][l] ^= s[2][l];
+      s[0][l] ^= s[3][l];
+      s[2][l] ^= t;
+      s[3][l] = rotl(s[3][l], 45);
+      block[2 * l]     = (uint32_t)r;
+      block[2 * l + 1] = (uint32_t)(r >> 32);
+    }
+    size_t m = std::min<size_t>(2 * kLanes, n - i);
+    for (size_t k = 0; k < m; ++k) {
+      uint64_t p = (uint64_t)block[k] * bound;
+      while ((uint32_t)p < threshold) p = (uint64_t)fallback.next32() * bound;
+      out[i + k] = (uint32_t)(p >> 32);
+    }
+  }
+}
+
+#ifdef RNG_HAVE_X86
+__attribute__((target("avx2")))
+static inline __m256i rotl64(__m256i x, int k) {
+  return _mm256_or_si256(_mm256_slli_epi64(x, k), _mm256_srli_epi64(x, 64 - k));
+}
+
+__attribute__((target("avx2")))
+void RngBatch::boundedAvx2(uint32_t* out, size_t n, uint32_t bound) {
+  const uint32_t threshold = (uint32_t)(-bound) % bound;
+  __m256i s0 = _mm256_load_si256((const __m256i*)s[0]);
+  __m256i s1 = _mm256_load_si256((const __m256i*)s[1]);
+  __m256i s2 = _mm256_load_si256((const __m256i*)s[2]);
+  __m256i s3 = _mm256_load_si256((const __m256i*)s[3]);
+  const __m256i vb  = _mm256_set1_epi64x(bound);
+  const __m256i thr = _mm256_set1_epi32((int)threshold);
+
+  alignas(32) uint32_t block[2 * kLanes];
+  alignas(32) uint32_t lows[2 * kLanes];
+  for (size_t i = 0; i < n; i += 2 * kLanes) {
+    // r = rotl(s1 * 5, 7) * 9, with the multiplies as shift + add
+    __m256i x5 = _mm256_add_epi64(_mm256_slli_epi64(s1, 2), s1);
+    __m256i rr = rotl64(x5, 7);
+    __m256i r  = _mm256_add_epi64(_mm256_slli_epi64(rr, 3), rr);
+
+    __m256i t = _mm256_slli_epi64(s1, 17);
+    s2 = _mm256_xor_si256(s2, s0);
+    s3 = _mm256_xor_si256(s3, s1);
+    s1 = _mm256_xor_si256(s1, s2);
+    s0 = _mm256_xor_si256(s0, s3);
+    s2 = _mm256_xor_si256(s2, t);
+    s3 = rotl64(s3, 45);
+
+    // Lemire: 32x32->64 products for even (low) and odd (high) words
+    __m256i pe = _mm256_mul_epu32(r, vb);
+    __m256i po = _mm256_mul_epu32(_mm256_srli_epi64(r, 32), vb);
+    __m256i res = _mm256_blend_epi32(_mm256_srli_epi64(pe, 32), po, 0xAA);
+    __m256i low = _mm256_blend_epi32(pe, _mm256_slli_epi64(po, 32), 0xAA);
+
+    size_t m = std::min<size_t>(2 * kLanes, n - i);
+    if (m == 2 * kLanes) _mm256_storeu_si256((__m256i*)(out + i), res);
+    else {
+      _mm256_store_si256((__m256i*)block, res);
+      std::copy(block, block + m, out + i);
+    }
+
+    // low >= threshold for every element -> no rejection (the usual case)
+    __m256i ok = _mm256_cmpeq_epi32(_mm256_max_epu32(low, thr), low);
+    if (_mm256_movemask_epi8(ok) != -1) {
+      _mm256_store_si256((__m256i*)lows, low);
+      for (size_t k = 0; k < m; ++k) {
+        if (lows[k] >= threshold) continue;
+        uint64_t p;
+        do p = (uint64_t)fallback.next32() * bound; while ((uint32_t)p < threshold);
+        out[i + k] = (uint32_t)(p >> 32);
+      }
+    }
+  }
+
+  _mm256_store_si256((__m256i*)s[0], s0);
+  _mm256_store_si256((__m256i*)s[1], s1);
+  _mm256_store_si256((__m256i*)s[2], s2);
+  _mm256_store_si256((__m256i*)s[3], s3);
+}
+#else
+void RngBatch::boundedAvx2(uint32_t* out, size_t n, uint32_t bound) {
+  boundedScalar(out, n, bound);
+}
+#endif
+
+void RngBatch::roll(int* out, size_t n, int count, int sides) {
+  if (count <= 0 || sides <= 0) { std::fill(out, out + n, 0); return; }
+
+  constexpr size_t kChunk = 256;
+  uint32_t faces[kChunk];
+  for (size_t i = 0; i < n; i += kChunk) {
+    size_t m = std::min(kChunk, n - i);
+    int* dst = out + i;
+    std::fill(dst, dst + m, count);          // faces are 0-based
+    for (int d = 0; d < count; ++d) {
+      bounded(faces, m, (uint32_t)sides);
+      for (size_t k = 0; k < m; ++k) dst[k] += (int)faces[k];
+    }
+  }
+}
@@ -0,0 +1,695 @@
+#include "SaveGame.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <type_traits>
+#include <unistd.h>
+
+namespace {
+
+constexpr char     kMagic[4] = { 'T', 'W', 'S', 'V' };
+constexpr uint32_t kVersion  = 7;
+constexpr uint32_t kFull = 0, kDelta = 1;
+
+struct RecordHeader {
+  char     magic[4];
+  uint32_t version;
+  uint32_t kind;
+  uint32_t seq;
+  uint64_t payloadBytes;
+  uint64_t checksum;       // FNV-1a over the payload
+};
+static_assert(sizeof(RecordHeader) == 32, "save record header layout");
+static_assert(std::is_trivially_copyable<EntityStore::Record>::value, "raw entity records");
+static_assert(std::is_trivially_copyable<EntityStore::Slot>::value, "raw slot table");
+
+uint64_t fnv(const uint8_t* p, size_t n) {
+  uint64_t h = 0xCBF29CE484222325ull;
+  for (size_t i = 0; i < n; ++i) { h ^= p[i]; h *= 0x100000001B3ull; }
+  return h;
+}
+
+// Appends raw values; tables go in with one memcpy each.
+struct Writer {
+  std::vector<uint8_t>& out;
+
+  void bytes(const void* p, size_t n) {
+    const uint8_t* b = (const uint8_t*)p;
+    out.insert(out.end(), b, b + n);
+  }
+  template <class T> void put(const T& v) { bytes(&v, sizeof v); }
+  template <class T> void table(const std::vector<T>& v) {
+    put((uint32_t)v.size());
+    bytes(v.data(), v.size() * sizeof(T));
+  }
+  void str(const std::string& s) { put((uint32_t)s.size()); bytes(s.data(), s.size()); }
+  void equipment(const Equipment& e) {
+    str(e.name);
+    put((uint8_t)e.slot);
+    str(e.attackDice.toString());
+    str(e.defenseDice.toString());
+    put((int32_t)e.flatDefBonus);
+    put((int32_t)e.spdBonus);
+  }
+};
+
+// Bounds-checked reader: any overrun sets `ok` to false and yields zeros.
+struct Reader {
+  const uint8_t* p;
+  const uint8_t* end;
+  bool ok = true;
+
+  bool bytes(void* dst, size_t n) {
+    if ((size_t)(end - p) < n) { ok = false; std::memset(dst, 0, n); return false; }
+    std::memcpy(dst, p, n);
+    p += n;
+    return true;
+  }
+  template <class T> T get() { T v{}; bytes(&v, sizeof v); return v; }
+  template <class T> void table(std::vector<T>& v) {
+    const uint32_t n = get<uint32_t>();
+    if (!ok || (size_t)(end - p) < (size_t)n * sizeof(T)) { ok = false; v.clear(); return; }
+    v.resize(n);
+    if (n) bytes(v.data(), (size_t)n * sizeof(T));
+  }
+  std::string str() {
+    const uint32_t n = get<uint32_t>();
+    if (!ok || (size_t)(end - p) < n) { ok = false; return {}; }
+    std::string s((const char*)p, n);
+    p += n;
+    return s;
+  }
+  // Start and count of entries appended to a table that holds `have`;
+  // every entry takes at least a byte, which bounds the count.
+  uint32_t more(size_t have) {
+    const uint32_t from = get<uint32_t>(), n = get<uint32_t>();
+    if (!ok || from != have || n > (size_t)(end - p)) { ok = false; return 0; }
+    return n;
+  }
+  void dice(DicePlan& d) {
+    std::string err;
+    if (!DicePlan::compile(str(), d, err)) ok = false;
+  }
+  Equipment equipment() {
+    Equipment e;
+    e.name = str();
+    e.slot = (EquipSlot)get<uint8_t>();
+    dice(e.attackDice);
+    dice(e.defenseDice);
+    e.flatDefBonus = get<int32_t>();
+    e.spdBonus = get<int32_t>();
+    return e;
+  }
+};
+
+using Dialogs = std::vector<std::vector<std::string>>;
+
+// Dialogue tables only grow: entries [from, size) go in.
+void putDialogs(Writer& w, const Dialogs& lines, size_t from) {
+  w.put((uint32_t)from);
+  w.put((uint32_t)(lines.size() - from));
+  for (size_t i = from; i < lines.size(); ++i) {
+    w.put((uint32_t)lines[i].size());
+    for (const auto& l : lines[i]) w.str(l);
+  }
+}
+
+// Whole spatial index chains, one per bucket (empty: the bucket emptied).
+void putChains(Writer& w, const EntityStore& a, const std::vector<uint64_t>& buckets) {
+  std::vector<uint32_t> chain;
+  w.put((uint32_t)buckets.size());
+  for (uint64_t b : buckets) {
+    a.bucketChain(b, chain);
+    w.put(b);
+    w.table(chain);
+  }
+}
+
+// Explored memory (1 bit per seen tile): the listed chunks, or every
+// chunk seen so far when `dirty` is null.
+void putExplored(Writer& w, const std::vector<int32_t>& idx, const std::vector<uint64_t>& bits,
+                 const std::vector<uint32_t>* dirty) {
+  std::vector<uint32_t> seen;
+  if (!dirty) {
+    for (size_t ci = 0; ci < idx.size(); ++ci)
+      if (idx[ci] >= 0) seen.push_back((uint32_t)ci);
+  }
+  const std::vector<uint32_t>& list = dirty ? *dirty : seen;
+  w.put((uint32_t)idx.size());
+  w.put((uint32_t)list.size());
+  for (uint32_t ci : list) {
+    w.put(ci);
+    w.bytes(&bits[(size_t)idx[ci] * 16], 16 * sizeof(uint64_t));
+  }
+}
+
+// A level the player has left: the chunks that differ from what its seed
+// generates, its actors whole and its explored memory.
+void putArea(Writer& w, const Area& area) {
+  w.put((int32_t)area.depth);
+  w.put(area.lastUsed);
+  const Map& m = area.map;
+  w.put((int32_t)m.getWidth());
+  w.put((int32_t)m.getHeight());
+  const Map::Chunk blank{};
+  w.put((uint32_t)m.editedChunks().size());
+  for (uint32_t ci : m.editedChunks()) {
+    const Map::Chunk* c = m.chunkAt((int)(ci % m.chunksAcross()), (int)(ci / m.chunksAcross()));
+    w.put(ci);
+    w.bytes(c ? c : &blank, sizeof(Map::Chunk));
+  }
+
+  const EntityStore& a = area.actors;
+  putDialogs(w, a.dialogTable(), 0);
+  w.table(a.slotTable());
+  w.put(a.freeListHead());
+  w.table(a.denseSlots());
+  putChains(w, a, a.indexBuckets());
+  w.put((uint32_t)a.size());
+  for (size_t i = 0; i < a.size(); ++i) w.put(a.recordAt(i));
+
+  putExplored(w, area.exploredIdx, area.exploredBits, nullptr);
+}
+
+// `items` and `dialogs` are how many table entries earlier records hold:
+// the tables only grow, so a record carries just the entries after those.
+void encode(std::vector<uint8_t>& out, const SaveView& v, bool full,
+            uint32_t items, uint32_t dialogs) {
+  Writer w{ out };
+
+  // game
+  uint64_t rs[4];
+  v.rng.getState(rs);
+  w.put(v.seed);
+  w.put((int32_t)v.depth);
+  w.put(v.turns);
+  w.put(v.rng.seedValue());
+  w.put(v.rng.streamValue());
+  w.bytes(rs, sizeof rs);
+  w.put(v.foe);
+  w.str(v.log.size() ? v.log.text(v.log.size() - 1) : std::string());
+
+  // player
+  const Player& p = v.player;
+  const int32_t ps[7] = { p.getX(), p.getY(), p.getMaxHP(), p.getBaseSpeed(),
+                          p.getAttack(), p.getDefense(), p.getHP() };
+  w.bytes(ps, sizeof ps);
+  const ItemId gear[4] = { p.weaponId(), p.helmetId(), p.chestId(), p.bootsId() };
+  w.bytes(gear, sizeof gear);
+
+  // shared tables: whole in a full record, new entries only in a delta
+  const ItemRegistry& reg = ItemRegistry::global();
+  if (full) items = 0;
+  w.put(items);
+  w.put((uint32_t)reg.size() - items);
+  for (size_t i = items; i < reg.size(); ++i) w.equipment(reg.get((ItemId)i));
+  const EntityStore& a = v.actors;
+  putDialogs(w, a.dialogTable(), full ? 0 : dialogs);
+
+  // entity bookkeeping: whole tables, or the entries of slots that were
+  // spawned, despawned or moved in the dense order
+  const auto& slots = a.slotTable();
+  const auto& dense = a.denseSlots();
+  if (full) {
+    w.table(slots);
+    w.put(a.freeListHead());
+    w.table(dense);
+  } else {
+    const auto& book = a.dirtyBookkeeping();
+    w.put((uint32_t)slots.size());
+    w.put((uint32_t)book.size());
+    for (uint32_t s : book) { w.put(s); w.put(slots[s]); }
+    w.put(a.freeListHead());
+    uint32_t n = 0;
+    for (uint32_t s : book) n += slots[s].dense != EntityStore::kFree;
+    w.put((uint32_t)dense.size());
+    w.put(n);
+    for (uint32_t s : book)
+      if (slots[s].dense != EntityStore::kFree) { w.put(slots[s].dense); w.put(s); }
+  }
+
+  // spatial index chains: all, or the buckets that changed
+  putChains(w, a, full ? a.indexBuckets() : a.dirtyBuckets());
+
+  auto putRecord = [&](uint32_t s) {
+    w.put(s);
+    w.put(a.recordAt(slots[s].dense));
+  };
+  if (full) {
+    w.put((uint32_t)a.size());
+    for (uint32_t s : a.denseSlots()) putRecord(s);
+  } else {
+    uint32_t n = 0;
+    for (uint32_t s : a.dirtySlots()) n += slots[s].dense != EntityStore::kFree;
+    w.put(n);
+    for (uint32_t s : a.dirtySlots())
+      if (slots[s].dense != EntityStore::kFree) putRecord(s);
+  }
+
+  // map
+  const Map& m = v.map;
+  w.put((int32_t)m.getWidth());
+  w.put((int32_t)m.getHeight());
+  std::vector<uint32_t> chunks;
+  if (full) {
+    for (int cy = 0; cy < m.chunksDown(); ++cy)
+      for (int cx = 0; cx < m.chunksAcross(); ++cx)
+        if (m.chunkAt(cx, cy)) chunks.push_back((uint32_t)(cy * m.chunksAcross() + cx));
+  } else {
+    chunks = m.dirtyChunks();
+  }
+  w.put((uint32_t)chunks.size());
+  for (uint32_t ci : chunks) {
+    const Map::Chunk* c = m.chunkAt((int)(ci % m.chunksAcross()), (int)(ci / m.chunksAcross()));
+    w.put(ci);
+    w.bytes(c, sizeof(Map::Chunk));   // dirty chunks are always allocated
+  }
+
+  // explored memory: every seen chunk, or the ones that gained bits
+  putExplored(w, v.fov.exploredIndex(), v.fov.exploredWords(),
+              full ? nullptr : &v.fov.dirtyExplored());
+
+  // levels left earlier. They only change when the player takes the
+  // stairs, which forces a full record, so a delta just names the ones
+  // still kept (some may have been evicted since).
+  const std::vector<const Area*> left = v.levels.visited();
+  w.put((uint32_t)left.size());
+  for (const Area* area : left) {
+    if (full) putArea(w, *area);
+    else      w.put((int32_t)area->depth);
+  }
+}
+
+bool getDialogs(Reader& r, Dialogs& dialogs) {
+  for (uint32_t n = r.more(dialogs.size()); n > 0 && r.ok; --n) {
+    std::vector<std::string> lines(r.get<uint32_t>());
+    if (lines.size() > (size_t)(r.end - r.p)) return false;
+    for (auto& l : lines) l = r.str();
+    dialogs.push_back(std::move(lines));
+  }
+  return r.ok;
+}
+
+bool getChains(Reader& r, std::map<uint64_t, std::vector<uint32_t>>& chains) {
+  const uint32_t buckets = r.get<uint32_t>();
+  for (uint32_t i = 0; i < buckets && r.ok; ++i) {
+    const uint64_t b = r.get<uint64_t>();
+    std::vector<uint32_t> chain;
+    r.table(chain);
+    if (chain.empty()) chains.erase(b);
+    else chains[b] = std::move(chain);
+  }
+  return r.ok;
+}
+
+// `chunks` is the map's chunk count, which a full record's table must match.
+bool getExplored(Reader& r, std::vector<int32_t>& idx, std::vector<uint64_t>& bits, bool full,
+                 size_t chunks) {
+  const uint32_t total = r.get<uint32_t>();
+  if (full) {
+    if (total != chunks) return false;
+    idx.assign(total, -1);
+    bits.clear();
+  } else if (total != idx.size()) {
+    return false;
+  }
+  const uint32_t seen = r.get<uint32_t>();
+  for (uint32_t i = 0; i < seen && r.ok; ++i) {
+    const uint32_t ci = r.get<uint32_t>();
+    if (ci >= idx.size()) return false;
+    int32_t& block = idx[ci];
+    if (block < 0) {
+      block = (int32_t)(bits.size() / 16);
+      bits.resize(bits.size() + 16);
+    }
+    r.bytes(&bits[(size_t)block * 16], 16 * sizeof(uint64_t));
+  }
+  return r.ok;
+}
+
+bool getArea(Reader& r, SavedArea& a) {
+  a.depth = r.get<int32_t>();
+  a.lastUsed = r.get<uint64_t>();
+  a.width = r.get<int32_t>();
+  a.height = r.get<int32_t>();
+  const uint32_t chunks = r.get<uint32_t>();
+  if (!r.ok || a.width < 0 || a.height < 0 || chunks > (size_t)(r.end - r.p) / sizeof(Map::Chunk))
+    return false;
+  a.chunks.resize(chunks);
+  for (auto& c : a.chunks) {
+    c.first = r.get<uint32_t>();
+    r.bytes(&c.second, sizeof c.second);
+  }
+
+  if (!getDialogs(r, a.dialogs)) return false;
+  r.table(a.slots);
+  a.freeHead = r.get<uint32_t>();
+  r.table(a.denseSlot);
+  if (!getChains(r, a.chains)) return false;
+  r.table(a.records);
+  if (!r.ok || a.records.size() != a.denseSlot.size()) return false;
+  const size_t across = ((size_t)a.width  + Map::kChunkMask) >> Map::kChunkShift;
+  const size_t down   = ((size_t)a.height + Map::kChunkMask) >> Map::kChunkShift;
+  return getExplored(r, a.exploredIdx, a.exploredBits, true, across * down);
+}
+
+bool decode(Reader& r, SaveState& st, bool full) {
+  st.seed = r.get<uint64_t>();
+  st.depth = r.get<int32_t>();
+  st.turns = r.get<uint64_t>();
+  st.rngSeed = r.get<uint64_t>();
+  st.rngStream = r.get<uint64_t>();
+  r.bytes(st.rngState, sizeof st.rngState);
+  st.foe = r.get<EntityHandle>();
+  st.message = r.str();
+
+  int32_t ps[7];
+  r.bytes(ps, sizeof ps);
+  st.player = Player(ps[0], ps[1], ps[2], ps[3], ps[4], ps[5]);
+  st.player.setHP(ps[6]);
+  r.bytes(st.playerItems, sizeof st.playerItems);
+
+  // tables continue where the previous record left them
+  for (uint32_t n = r.more(st.items.size()); n > 0 && r.ok; --n)
+    st.items.push_back(r.equipment());
+  if (!r.ok || !getDialogs(r, st.dialogs)) return false;
+
+  if (full) {
+    r.table(st.slots);
+    st.freeHead = r.get<uint32_t>();
+    r.table(st.denseSlot);
+  } else {
+    st.slots.resize(r.get<uint32_t>());
+    const uint32_t n = r.get<uint32_t>();
+    for (uint32_t i = 0; i < n && r.ok; ++i) {
+      const uint32_t s = r.get<uint32_t>();
+      const auto slot = r.get<EntityStore::Slot>();
+      if (s >= st.slots.size()) return false;
+      st.slots[s] = slot;
+    }
+    st.freeHead = r.get<uint32_t>();
+    st.denseSlot.resize(r.get<uint32_t>());
+    const uint32_t m = r.get<uint32_t>();
+    for (uint32_t i = 0; i < m && r.ok; ++i) {
+      const uint32_t pos = r.get<uint32_t>(), s = r.get<uint32_t>();
+      if (pos >= st.denseSlot.size()) return false;
+      st.denseSlot[pos] = s;
+    }
+  }
+  if (!r.ok || !getChains(r, st.chains)) return false;
+
+  st.bySlot.resize(st.slots.size());
+  const uint32_t records = r.get<uint32_t>();
+  for (uint32_t i = 0; i < records && r.ok; ++i) {
+    const uint32_t s = r.get<uint32_t>();
+    const auto rec = r.get<EntityStore::Record>();
+    if (s >= st.bySlot.size()) return false;
+    st.bySlot[s] = rec;
+  }
+
+  const int32_t w = r.get<int32_t>(), h = r.get<int32_t>();
+  if (!r.ok || w < 0 || h < 0) return false;
+  if (full) st.map = Map(w, h, false);
+  else if (w != st.map.getWidth() || h != st.map.getHeight()) return false;
+  const uint32_t chunks = r.get<uint32_t>();
+  const uint32_t across = (uint32_t)st.map.chunksAcross();
+  const uint32_t total  = across * (uint32_t)st.map.chunksDown();
+  Map::Chunk c;
+  for (uint32_t i = 0; i < chunks && r.ok; ++i) {
+    const uint32_t ci = r.get<uint32_t>();
+    if (!r.bytes(&c, sizeof c) || ci >= total) return false;
+    st.map.writeChunk((int)(ci % across), (int)(ci / across), c);
+  }
+
+  if (!getExplored(r, st.exploredIdx, st.exploredBits, full, total)) return false;
+
+  const uint32_t left = r.get<uint32_t>();
+  if (full) {
+    st.areas.clear();
+    for (uint32_t i = 0; i < left && r.ok; ++i) {
+      st.areas.emplace_back();
+      if (!getArea(r, st.areas.back())) return false;
+    }
+  } else {
+    std::vector<int32_t> kept(left);
+    for (int32_t& d : kept) d = r.get<int32_t>();
+    auto gone = [&](const SavedArea& a) {
+      return std::find(kept.begin(), kept.end(), a.depth) == kept.end();
+    };
+    st.areas.erase(std::remove_if(st.areas.begin(), st.areas.end(), gone), st.areas.end());
+  }
+  return r.ok && r.p == r.end;
+}
+
+bool sameItem(const Equipment& a, const Equipment& b) {
+  return a.name == b.name && a.slot == b.slot &&
+         a.attackDice.toString() == b.attackDice.toString() &&
+         a.defenseDice.toString() == b.defenseDice.toString() &&
+         a.flatDefBonus == b.flatDefBonus && a.spdBonus == b.spdBonus;
+}
+
+bool writeAll(int fd, const uint8_t* p, size_t n) {
+  while (n) {
+    ssize_t w = ::write(fd, p, n);
+    if (w < 0 && errno == EINTR) continue;
+    if (w <= 0) return false;
+    p += w; n -= (size_t)w;
+  }
+  return true;
+}
+
+} // namespace
+
+bool loadSave(const std::string& path, SaveState& out, std::string& err) {
+  FILE* f = std::fopen(path.c_str(), "rb");
+  if (!f) { err = path + ": " + std::strerror(errno); return false; }
+  std::vector<uint8_t> data;
+  uint8_t buf[1 << 16];
+  for (size_t n; (n = std::fread(buf, 1, sizeof buf, f)) > 0; ) data.insert(data.end(), buf, buf + n);
+  std::fclose(f);
+
+  out = SaveState();
+  size_t pos = 0;
+  uint32_t expectSeq = 0;
+  while (data.size() - pos >= sizeof(RecordHeader)) {
+    RecordHeader h;
+    std::memcpy(&h, data.data() + pos, sizeof h);
+    const uint8_t* payload = data.data() + pos + sizeof h;
+    const bool intact = std::memcmp(h.magic, kMagic, 4) == 0 && h.version == kVersion &&
+                        h.payloadBytes <= data.size() - pos - sizeof h &&
+                        fnv(payload, h.payloadBytes) == h.checksum;
+    const bool inOrder = out.records == 0 ? h.kind == kFull
+                                          : (h.kind == kDelta && h.seq == expectSeq);
+    if (!intact || !inOrder) break;   // damaged tail: keep what we have
+
+    // the checksum passed, so a payload that does not parse is a real error
+    Reader r{ payload, payload + h.payloadBytes };
+    if (!decode(r, out, h.kind == kFull)) {
+      err = path + ": corrupt record " + std::to_string(h.seq);
+      return false;
+    }
+    ++out.records;
+    expectSeq = h.seq + 1;
+    pos += sizeof h + h.payloadBytes;
+  }
+  if (out.records == 0) { err = path + ": not a save file"; return false; }
+
+  // item ids are per run: map the file's ids to ours by item name. The
+  // save keeps each definition, so an item file that changed one since
+  // is an error rather than new stats on old gear.
+  ItemRegistry& reg = ItemRegistry::global();
+  std::vector<ItemId> remap(out.items.size());
+  for (size_t i = 0; i < remap.size(); ++i) {
+    remap[i] = reg.intern(out.items[i]);
+    if (remap[i] != kNoItem && !sameItem(reg.get(remap[i]), out.items[i])) {
+      err = path + ": item '" + out.items[i].name + "' is defined differently than when saved";
+      return false;
+    }
+  }
+  auto local = [&](ItemId id) { return id < remap.size() ? remap[id] : kNoItem; };
+  for (ItemId id : out.playerItems) out.player.equip(local(id));
+  auto remapGear = [&](EntityStore::Record& rec) {
+    rec.weapon = local(rec.weapon);
+    rec.helmet = local(rec.helmet);
+    rec.chest  = local(rec.chest);
+  };
+  for (EntityStore::Record& rec : out.bySlot) remapGear(rec);
+  for (SavedArea& a : out.areas)
+    for (EntityStore::Record& rec : a.records) remapGear(rec);
+  return true;
+}
+
+void restoreSave(SaveState& st, SaveView v) {
+  v.seed = st.seed;
+  v.depth = st.depth;
+  v.turns = st.turns;
+  v.rng.seed(st.rngSeed, st.rngStream);
+  v.rng.setState(st.rngState);
+  v.log.clear();
+  if (!st.message.empty()) v.log.push(MsgId::Text, st.message);
+  v.player = st.player;
+
+  std::vector<EntityStore::Record> records;
+  records.reserve(st.denseSlot.size());
+  for (uint32_t s : st.denseSlot)
+    records.push_back(s < st.bySlot.size() ? st.bySlot[s] : EntityStore::Record());
+  std::vector<uint32_t> insertOrder;
+  for (const auto& c : st.chains) insertOrder.insert(insertOrder.end(), c.second.begin(), c.second.end());
+  v.actors.restore(st.slots, st.freeHead, st.denseSlot, records, insertOrder, st.dialogs);
+  v.foe = st.foe;
+
+  v.fov.restoreExplored(st.exploredIdx, st.exploredBits);
+  v.map.clearDirty();
+
+  // the levels left earlier: generate each again and lay the saved
+  // chunks, actors and explored memory over it
+  v.levels.reseed(st.seed, st.depth);
+  v.map.markEditsAgainst(buildArea(st.seed, st.depth)->map);
+  for (SavedArea& sa : st.areas) {
+    std::unique_ptr<Area> a = buildArea(st.seed, sa.depth);
+    Map& m = a->map;
+    if (m.getWidth() != sa.width || m.getHeight() != sa.height) m = Map(sa.width, sa.height, false);
+    const uint32_t across = (uint32_t)m.chunksAcross();
+    const uint32_t total  = across * (uint32_t)m.chunksDown();
+    for (const auto& c : sa.chunks)
+      if (c.first < total) m.writeChunk((int)(c.first % across), (int)(c.first / across), c.second);
+    if (!sa.chunks.empty()) findStairs(m, a->layout);
+    m.clearDirty();
+
+    std::vector<uint32_t> insertOrder;
+    for (const auto& c : sa.chains) insertOrder.insert(insertOrder.end(), c.second.begin(), c.second.end());
+    a->actors.restore(std::move(sa.slots), sa.freeHead, sa.denseSlot, sa.records, insertOrder,
+                      std::move(sa.dialogs));
+
+    if (sa.exploredIdx.size() == total) {
+      a->exploredIdx = std::move(sa.exploredIdx);
+      a->exploredBits = std::move(sa.exploredBits);
+    } else {
+      a->exploredIdx.assign(total, -1);
+    }
+    a->lastUsed = sa.lastUsed;
+    v.levels.restore(std::move(a));
+  }
+}
+
+// ---------------- SaveWriter ----------------
+
+SaveWriter::SaveWriter(std::string path) : file(std::move(path)) {
+  worker = std::thread(&SaveWriter::loop, this);
+}
+
+SaveWriter::~SaveWriter() {
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    stop = true;
+  }
+  cv.notify_one();
+  worker.join();
+}
+
+void SaveWriter::save(SaveView v) {
+  {
+    // a lost record breaks the chain: start over with a full snapshot
+    std::lock_guard<std::mutex> lock(mtx);
+    if (error) rebaseNext = true;
+  }
+  // rebase when the delta chain gets long or outweighs a full snapshot
+  const bool full = seq == 0 || rebaseNext || deltas >= kRebaseEvery || deltaBytes > fullBytes;
+  rebaseNext = false;
+
+  Job job;
+  job.replace = full;
+  job.bytes.resize(sizeof(RecordHeader));
+  encode(job.bytes, v, full, itemsSaved, dialogsSaved);
+  itemsSaved = (uint32_t)ItemRegistry::global().size();
+  dialogsSaved = (uint32_t)v.actors.dialogTable().size();
+  v.map.clearDirty();
+  v.actors.clearDirty();
+  v.fov.clearExploredDirty();
+
+  RecordHeader h{};
+  std::memcpy(h.magic, kMagic, 4);
+  h.version = kVersion;
+  h.kind = full ? kFull : kDelta;
+  h.seq = seq++;
+  h.payloadBytes = job.bytes.size() - sizeof h;
+  h.checksum = fnv(job.bytes.data() + sizeof h, h.payloadBytes);
+  std::memcpy(job.bytes.data(), &h, sizeof h);
+
+  lastBytes = job.bytes.size();
+  lastDelta = !full;
+  if (full) { deltas = 0; deltaBytes = 0; fullBytes = lastBytes; }
+  else      { ++deltas; deltaBytes += lastBytes; }
+
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    queue.push_back(std::move(job));
+  }
+  cv.notify_one();
+}
+
+void SaveWriter::flush() {
+  std::unique_lock<std::mutex> lock(mtx);
+  idle.wait(lock, [&]{ return queue.empty() && !busy; });
+}
+
+bool SaveWriter::failed(std::string* why) const {
+  std::lock_guard<std::mutex> lock(mtx);
+  if (why) *why = errorText;
+  return error;
+}
+
+void SaveWriter::loop() {
+  std::unique_lock<std::mutex> lock(mtx);
+  for (;;) {
+    cv.wait(lock, [&]{ return stop || !queue.empty(); });
+    if (queue.empty()) break;   // stop requested and nothing left
+    Job job = std::move(queue.front());
+    queue.pop_front();
+    if (error && !job.replace) {
+      // a delta after a lost record would leave a gap: wait for the next
+      // full snapshot instead
+      if (queue.empty()) idle.notify_all();
+      continue;
+    }
+    busy = true;
+    lock.unlock();
+    std::string why;
+    const bool ok = write(job, why);
+    lock.lock();
+    busy = false;
+    if (!ok) { error = true; errorText = why; }
+    else if (job.replace) error = false;
+    if (queue.empty()) idle.notify_all();
+  }
+  idle.notify_all();
+}
+
+bool SaveWriter::write(const Job& job, std::string& err) {
+  ProfileScope scope("SaveWriter::write");
+  auto fail = [&](const std::string& name) {
+    err = name + ": " + std::strerror(errno);
+    return false;
+  };
+  if (job.replace) {
+    // write-then-rename: the old save survives a crash mid-write
+    const std::string tmp = file + ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return fail(tmp);
+    bool ok = writeAll(fd, job.bytes.data(), job.bytes.size()) && ::fdatasync(fd) == 0;
+    if (!ok) fail(tmp);
+    if (::close(fd) != 0 && ok) ok = fail(tmp);
+    if (ok && std::rename(tmp.c_str(), file.c_str()) != 0) ok = fail(file);
+    if (!ok) ::unlink(tmp.c_str());
+    return ok;
+  }
+  int fd = ::open(file.c_str(), O_WRONLY | O_APPEND);
+  if (fd < 0) return fail(file);
+  bool ok = writeAll(fd, job.bytes.data(), job.bytes.size()) && ::fdatasync(fd) == 0;
+  if (!ok) fail(file);
+  if (::close(fd) != 0 && ok) ok = fail(file);
+  return ok;
+}
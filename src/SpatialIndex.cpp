@@ -0,0 +1,60 @@
+#include "SpatialIndex.h"
+#include <algorithm>
+
+// Nobody may ever clear the list (no save file), so duplicates are
+// squeezed out now and then: it stays within twice the buckets touched.
+void SpatialIndex::touch(uint64_t k) {
+  touched.push_back(k);
+  if (touched.size() < touchedCap) return;
+  std::sort(touched.begin(), touched.end());
+  touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+  touchedCap = std::max(kTouchedMin, 2 * touched.size());
+}
+
+void SpatialIndex::link(uint32_t id, uint64_t k) {
+  Link& l = links[id];
+  auto it = heads.find(k);
+  l.prev = kNone;
+  l.next = (it == heads.end()) ? kNone : it->second;
+  if (l.next != kNone) links[l.next].prev = id;
+  heads[k] = id;
+  l.key = k;
+  l.linked = true;
+  touch(k);
+}
+
+void SpatialIndex::unlink(uint32_t id) {
+  Link& l = links[id];
+  if (!l.linked) return;
+  if (l.prev != kNone) links[l.prev].next = l.next;
+  else if (l.next != kNone) heads[l.key] = l.next;
+  else heads.erase(l.key);                       // bucket now empty
+  if (l.next != kNone) links[l.next].prev = l.prev;
+  touch(l.key);
+  l.prev = l.next = kNone;
+  l.linked = false;
+}
+
+void SpatialIndex::insert(uint32_t id, int x, int y) {
+  if (id >= links.size()) links.resize((size_t)id + 1);
+  unlink(id);
+  link(id, key(cellOf(x), cellOf(y)));
+}
+
+void SpatialIndex::remove(uint32_t id) {
+  if (id < links.size()) unlink(id);
+}
+
+void SpatialIndex::move(uint32_t id, int x, int y) {
+  if (id >= links.size() || !links[id].linked) { insert(id, x, y); return; }
+  const uint64_t k = key(cellOf(x), cellOf(y));
+  if (links[id].key == k) return;                // same bucket: nothing to do
+  unlink(id);
+  link(id, k);
+}
+
+void SpatialIndex::clear() {
+  links.clear();
+  heads.clear();
+  clearTouched();
+}
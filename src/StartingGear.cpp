@@ -0,0 +1,18 @@
+#include "StartingGear.h"
+
+// Loadouts come from the item registry (data/items.ini).
+
+void giveStartingGear(Player& player) {
+  const Loadout& lo = ItemRegistry::global().loadout("player");
+  player.equip(lo.weapon);
+  player.equip(lo.helmet);
+  player.equip(lo.chest);
+  player.equip(lo.boots);
+}
+
+void giveStartingGear(Enemy& enemy) {
+  const Loadout& lo = ItemRegistry::global().loadout("enemy");
+  enemy.equip(lo.weapon);
+  enemy.equip(lo.helmet);
+  enemy.equip(lo.chest);
+}
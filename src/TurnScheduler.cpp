@@ -0,0 +1,85 @@
+#include "TurnScheduler.h"
+#include <algorithm>
+
+void TurnScheduler::add(ActorId id, int speed, bool first) {
+  if (id == kNone) return;
+  if (id >= actors.size()) actors.resize((size_t)id + 1);
+  remove(id);
+  Actor& a = actors[id];
+  a.speed = std::max(1, speed);
+  a.energy = 0;
+  a.first = first;
+  a.since = tick;
+  file(id);
+}
+
+void TurnScheduler::remove(ActorId id) {
+  if (!scheduled(id)) return;
+  Actor& a = actors[id];
+  if (a.state == Waiting) --pending;
+  a.state = Idle;
+  ++a.gen;
+}
+
+void TurnScheduler::setSpeed(ActorId id, int speed) {
+  if (!scheduled(id)) return;
+  Actor& a = actors[id];
+  if (a.state == Waiting) {
+    a.energy += a.speed * (int)(tick - a.since);
+    a.since = tick;
+    --pending;
+    ++a.gen;
+    a.speed = std::max(1, speed);
+    file(id);
+  } else {
+    a.speed = std::max(1, speed);
+  }
+}
+
+// Files the actor under the first tick at which it holds kActionCost.
+void TurnScheduler::file(ActorId id) {
+  Actor& a = actors[id];
+  const int need = kActionCost - a.energy;
+  const uint64_t wait = need <= 0 ? 0 : (uint64_t)((need + a.speed - 1) / a.speed);
+  Bucket& b = slots[(a.since + wait) & (kSlots - 1)];
+  b.lane[a.first ? 0 : 1].push_back(Entry{ id, a.gen });
+  a.state = Waiting;
+  ++pending;
+}
+
+TurnScheduler::ActorId TurnScheduler::next() {
+  if (pending == 0) return kNone;
+  for (;;) {
+    Bucket& b = slots[tick & (kSlots - 1)];
+    for (int l = 0; l < 2; ++l) {
+      while (b.pos[l] < b.lane[l].size()) {
+        const Entry e = b.lane[l][b.pos[l]++];
+        Actor& a = actors[e.id];
+        if (a.gen != e.gen || a.state != Waiting) continue;   // removed meanwhile
+        a.energy += a.speed * (int)(tick - a.since);
+        a.since = tick;
+        a.state = Acting;
+        --pending;
+        return e.id;
+      }
+    }
+    // this tick is used up: empty the bucket (keeping its memory) and move on
+    for (int l = 0; l < 2; ++l) { b.lane[l].clear(); b.pos[l] = 0; }
+    ++tick;
+  }
+}
+
+void TurnScheduler::done(ActorId id, int cost) {
+  if (!acting(id)) return;
+  Actor& a = actors[id];
+  a.energy -= std::min(std::max(cost, 1), kMaxCost);
+  a.since = tick;
+  file(id);
+}
+
+void TurnScheduler::clear() {
+  actors.clear();
+  for (Bucket& b : slots)
+    for (int l = 0; l < 2; ++l) { b.lane[l].clear(); b.pos[l] = 0; }
+  pending = 0;
+}
@@ -1,24 +1,16 @@
 #include "Ui.h"
 #include "Equipment.h"
+#include "Profiler.h"
 #include <algorithm>
+#include <cstdio>
 
 Ui::Ui(int sidebarWidth, int msgHeight)
-: sidebarWidth(sidebarWidth), msgHeight(msgHeight) {
-  w.hud = w.mapw = w.side = w.msg = nullptr;
-}
-
-Ui::~Ui() { destroy(); }
-
-void Ui::destroy() {
-  if (w.hud)  { delwin(w.hud);  w.hud  = nullptr; }
-  if (w.mapw) { delwin(w.mapw); w.mapw = nullptr; }
-  if (w.side) { delwin(w.side); w.side = nullptr; }
-  if (w.msg)  { delwin(w.msg);  w.msg  = nullptr; }
-}
+: sidebarWidth(sidebarWidth), msgHeight(msgHeight) {}
 
 void Ui::layout() {
-  destroy();
-  int H = LINES, W = COLS;
+  if (!out) return;
+  int H = 0, W = 0;
+  out->measure(H, W);
 
   int hudH  = 1;
   int sideW = std::min(sidebarWidth, std::max(0, W / 2));
@@ -26,142 +18,293 @@ void Ui::layout() {
   int msgH  = std::min(msgHeight, std::max(0, H / 3));
   int mapH  = std::max(0, H - hudH - msgH);
 
-  w.hud  = newwin(hudH, W,       0,          0);
-  w.mapw = newwin(mapH, mapW,    hudH,       0);
-  w.side = newwin(H - hudH, sideW, hudH,     mapW);
-  w.msg  = newwin(msgH, mapW,    hudH+mapH,  0);
+  out->place(Renderer::Hud,     0,         0,    hudH,     W);
+  out->place(Renderer::MapView, hudH,      0,    mapH,     mapW);
+  out->place(Renderer::Side,    hudH,      mapW, H - hudH, sideW);
+  out->place(Renderer::Msg,     hudH+mapH, 0,    msgH,     mapW);
+  panel[Renderer::Hud]     = { hudH,     W };
+  panel[Renderer::MapView] = { mapH,     mapW };
+  panel[Renderer::Side]    = { H - hudH, sideW };
+  panel[Renderer::Msg]     = { msgH,     mapW };
 
-  keypad(w.mapw, TRUE);
-  keypad(w.side, TRUE);
-  keypad(w.msg,  TRUE);
+  // new panels are blank: everything must be drawn again
+  hudValid = sideValid = msgValid = mapValid = false;
+  prevMarks.clear();
 }
 
-WINDOW* Ui::mapWindow() const { return w.mapw; }
-
 bool Ui::onMapViewport(int x, int y) const {
-  if (!w.mapw) return false;
-  int h=0, ww=0;
-  getmaxyx(w.mapw, h, ww);
-  return (x >= 0 && y >= 0 && x < ww && y < h);
+  if (!out) return false;
+  const Rect& r = panel[Renderer::MapView];
+  x -= camX; y -= camY;
+  return (x >= 0 && y >= 0 && x < r.w && y < r.h);
 }
 
-std::vector<std::string> Ui::wrapText(const std::string& s, int maxw) {
-  std::vector<std::string> out;
-  if (maxw <= 0) return out;
-  int i = 0, n = (int)s.size();
-  while (i < n) {
-    int len = std::min(maxw, n - i);
-    int breakPos = -1;
-    for (int j = 0; j < len; ++j)
-      if (s[i + j] == ' ') breakPos = j;
-    if (len == maxw && breakPos != -1) len = breakPos + 1;
-    std::string piece = s.substr(i, len);
-    while (!piece.empty() && piece.back() == ' ') piece.pop_back();
-    out.push_back(piece);
-    i += (int)piece.size();
-    if (i < n && s[i] == ' ') ++i;
+bool Ui::drawHUD(const Player& player, const EntityStore& actors, EntityHandle foe) {
+  if (!out) return false;
+  ProfileScope scope("Ui::drawHUD");
+  HudState now;
+  now.hp      = player.getHP();
+  now.enemyHp = actors.valid(foe) && actors.isAlive(foe) ? actors.getHP(foe) : 0;
+  now.spd     = player.getSpeed();
+  now.cells   = showStats ? shownCells : -1;
+  if (showProfile) {
+    if (profStale) {
+      const ProfileSummary p = Profiler::summary();
+      shownProf[0] = (int)(p.frameP50Ms * 1000); shownProf[1] = (int)(p.frameP99Ms * 1000);
+      shownProf[2] = (int)(p.inputP50Ms * 1000); shownProf[3] = (int)(p.inputP99Ms * 1000);
+      profStale = false;
+    }
+    std::copy(shownProf, shownProf + 4, now.prof);
   }
-  return out;
-}
+  if (hudValid && now == hudState) return false;
+  hudState = now;
+  hudValid = true;
 
-void Ui::drawHUD(const Player& player, const Enemy& enemy) const {
-  if (!w.hud) return;
-  werase(w.hud);
-  wattron(w.hud, A_REVERSE | (has_colors() ? COLOR_PAIR(5) : 0));
-  mvwprintw(w.hud, 0, 0, "HP:%d  Enemy:%d  SPD:%d  |  Move: WASD/Arrows  Q:Quit",
-            player.getHP(), enemy.isAlive() ? enemy.getHP() : 0, player.getSpeed());
-  wattroff(w.hud, A_REVERSE | (has_colors() ? COLOR_PAIR(5) : 0));
+  char line[256];
+  int n = std::snprintf(line, sizeof line, "HP:%d  Enemy:%d  SPD:%d  |  Move: WASD/Arrows  Q:Quit",
+                        now.hp, now.enemyHp, now.spd);
+  if (showStats)
+    n += std::snprintf(line + n, sizeof line - n, "  |  cells:%d", now.cells);
+  if (showProfile)
+    n += std::snprintf(line + n, sizeof line - n,
+                       "  |  frame p50 %.2f p99 %.2f ms  input p50 %.2f p99 %.2f ms",
+                       now.prof[0] / 1000.0, now.prof[1] / 1000.0, now.prof[2] / 1000.0, now.prof[3] / 1000.0);
+  out->clear(Renderer::Hud);
+  out->text(Renderer::Hud, 0, 0, line, std::min(n, (int)sizeof line - 1), kReverse | kWhite);
+  stats.cellsTouched += panel[Renderer::Hud].w;
+  return true;
 }
 
-void Ui::drawSidebar(const Player& player, const Enemy& enemy) const {
-  if (!w.side) return;
-  werase(w.side);
-  int h=0, ww=0; getmaxyx(w.side, h, ww);
+bool Ui::drawSidebar(const Player& player, const EntityStore& actors, EntityHandle foe) {
+  if (!out) return false;
+  ProfileScope scope("Ui::drawSidebar");
+
+  static const std::string none;
+  const bool hasFoe = actors.valid(foe);
+  SideState now;
+  int* st = now.stats;
+  st[0] = player.getHP();  st[1] = player.getSpeed();
+  st[2] = player.getAttack(); st[3] = player.getDefense();
+  if (hasFoe) {
+    st[4] = actors.isAlive(foe) ? actors.getHP(foe) : 0; st[5] = actors.getSpeed(foe);
+    st[6] = actors.getAttack(foe); st[7] = actors.getDefense(foe);
+  }
+  const std::string* names[7] = {
+    &player.getWeapon().name, &player.getHelmet().name,
+    &player.getChest().name,  &player.getBoots().name,
+    hasFoe ? &actors.getWeapon(foe).name : &none,
+    hasFoe ? &actors.getHelmet(foe).name : &none,
+    hasFoe ? &actors.getChest(foe).name  : &none
+  };
+
+  bool same = sideValid && std::equal(st, st + 8, sideState.stats);
+  for (int i = 0; i < 7 && same; ++i) same = (*names[i] == sideNames[i]);
+  if (same) return false;
+  sideState = now;
+  for (int i = 0; i < 7; ++i) sideNames[i] = *names[i];
+  sideValid = true;
+
+  out->clear(Renderer::Side);
+  const int h = panel[Renderer::Side].h, ww = panel[Renderer::Side].w;
   int cx = 1, cy = 0;
   auto print = [&](const std::string& s){
-    if (cy < h) mvwaddnstr(w.side, cy++, cx, s.c_str(), std::max(0, ww - cx - 1));
+    if (cy < h)
+      out->text(Renderer::Side, cy++, cx, s.c_str(), std::min((int)s.size(), ww - cx - 1), kPlain);
   };
 
   print("== STATUS ==");
   print("Player");
-  print("  HP : " + std::to_string(player.getHP()));
-  print("  SPD: " + std::to_string(player.getSpeed()));
-  print("  ATK: " + std::to_string(player.getAttack()));
-  print("  DEF: " + std::to_string(player.getDefense()));
+  print("  HP : " + std::to_string(st[0]));
+  print("  SPD: " + std::to_string(st[1]));
+  print("  ATK: " + std::to_string(st[2]));
+  print("  DEF: " + std::to_string(st[3]));
   cy++;
 
   print("Equipped");
-  print(std::string("  Weapon: ") + player.getWeapon().name);
-  print(std::string("  Helmet: ") + player.getHelmet().name);
-  print(std::string("  Chest : ") + player.getChest().name);
-  print(std::string("  Boots : ") + player.getBoots().name);
+  print(std::string("  Weapon: ") + sideNames[0]);
+  print(std::string("  Helmet: ") + sideNames[1]);
+  print(std::string("  Chest : ") + sideNames[2]);
+  print(std::string("  Boots : ") + sideNames[3]);
   cy++;
 
   print("Enemy");
-  print(std::string("  HP : ") + (enemy.isAlive() ? std::to_string(enemy.getHP()) : "0"));
-  print("  SPD: " + std::to_string(enemy.getSpeed()));
-  print("  ATK: " + std::to_string(enemy.getAttack()));
-  print("  DEF: " + std::to_string(enemy.getDefense()));
+  print("  HP : " + std::to_string(st[4]));
+  print("  SPD: " + std::to_string(st[5]));
+  print("  ATK: " + std::to_string(st[6]));
+  print("  DEF: " + std::to_string(st[7]));
   cy++;
 
   print("Enemy Gear");
-  print(std::string("  Weapon: ") + enemy.getWeapon().name);
-  print(std::string("  Helmet: ") + enemy.getHelmet().name);
-  print(std::string("  Chest : ") + enemy.getChest().name);
+  print(std::string("  Weapon: ") + sideNames[4]);
+  print(std::string("  Helmet: ") + sideNames[5]);
+  print(std::string("  Chest : ") + sideNames[6]);
 
   cy++;
   print("Keys");
   print("  Move: WASD/Arrows");
+  print("  Stats: F");
+  print("  Profile: P");
+  print("  Log: PgUp/PgDn");
   print("  Quit: Q");
+
+  stats.cellsTouched += h * ww;
+  return true;
 }
 
-void Ui::drawMessageBox(const std::string& text, bool showIndicator) const {
-  if (!w.msg) return;
-  werase(w.msg);
-  box(w.msg, 0, 0);
-  int h=0, ww=0; getmaxyx(w.msg, h, ww);
-  const int innerW = std::max(0, ww - 2);
-  auto lines = wrapText(text, innerW);
-  for (int i = 0; i < (int)lines.size() && i < h - 2; ++i) {
-    mvwaddnstr(w.msg, 1 + i, 1, lines[i].c_str(), innerW);
+bool Ui::drawMessageBox(const MessageLog& log, bool showIndicator) {
+  if (!out) return false;
+  ProfileScope scope("Ui::drawMessageBox");
+  if (log.version() != msgVersion) msgScroll = 0;   // new message: back to the end
+  if (msgValid && showIndicator == msgIndicator && log.version() == msgVersion &&
+      msgScroll == shownScroll)
+    return false;
+
+  out->clear(Renderer::Msg);
+  out->box(Renderer::Msg);
+  const int h = panel[Renderer::Msg].h, ww = panel[Renderer::Msg].w;
+  const int innerW = std::max(0, ww - 2), rows = std::max(0, h - 2);
+
+  // can't scroll past the oldest line
+  if (msgScroll > 0) {
+    int total = 0;
+    const MessageLog::Span* lines;
+    for (size_t i = 0; i < log.size(); ++i) total += log.wrap(i, innerW, lines);
+    msgScroll = std::min(msgScroll, std::max(0, total - rows));
   }
-  if (showIndicator && h >= 2 && ww >= 2) {
-    wattron(w.msg, A_BOLD | (has_colors() ? COLOR_PAIR(5) : 0));
-    mvwaddch(w.msg, h - 2, ww - 2, '>');
-    wattroff(w.msg, A_BOLD | (has_colors() ? COLOR_PAIR(5) : 0));
+
+  // newest entry at the bottom, older ones dimmed above it; lines come
+  // straight from the log's cached wrap
+  int row = rows - 1, skip = msgScroll;
+  for (size_t k = log.size(); k-- > 0 && row >= 0; ) {
+    const MessageLog::Span* lines;
+    const int n = log.wrap(k, innerW, lines);
+    const char* text = log.text(k).data();
+    const uint8_t style = k + 1 < log.size() ? kDim : kPlain;
+    for (int j = n; j-- > 0 && row >= 0; ) {
+      if (skip > 0) { --skip; continue; }
+      out->text(Renderer::Msg, 1 + row--, 1, text + lines[j].off, lines[j].len, style);
+    }
+  }
+  if (msgScroll > 0 && ww > 12) {
+    char label[24];
+    const int n = std::snprintf(label, sizeof label, " -%d lines ", msgScroll);
+    out->text(Renderer::Msg, 0, 2, label, std::min(n, ww - 4), kPlain);
   }
+  if (showIndicator && h >= 2 && ww >= 2)
+    out->text(Renderer::Msg, h - 2, ww - 2, ">", 1, kBold | kWhite);
+  msgVersion = log.version();
+  msgIndicator = showIndicator;
+  shownScroll = msgScroll;
+  msgValid = true;
+  stats.cellsTouched += h * ww;
+  return true;
 }
 
-void Ui::renderFrame(const Map& map, const Player& player,
-                     const Enemy& enemy, const NPC& npc,
-                     const std::string& message, bool showIndicator) {
-  // HUD
-  drawHUD(player, enemy);
-
-  // MAP
-  if (w.mapw) {
-    werase(w.mapw);
-    map.drawTo(w.mapw);
-
-    auto drawEntity = [&](int x, int y, chtype ch, short pair){
-      if (onMapViewport(x, y)) {
-        if (pair && has_colors()) wattron(w.mapw, COLOR_PAIR(pair) | A_BOLD);
-        mvwaddch(w.mapw, y, x, ch);
-        if (pair && has_colors()) wattroff(w.mapw, COLOR_PAIR(pair) | A_BOLD);
-      }
-    };
-    if (enemy.isAlive()) drawEntity(enemy.getX(), enemy.getY(), 'g', 1);
-    drawEntity(npc.getX(),   npc.getY(),   'N', 2);
-    drawEntity(player.getX(),player.getY(),'@', 3);
+void Ui::drawMark(const Mark& m) {
+  if (!onMapViewport(m.x, m.y)) return;
+  out->cells(Renderer::MapView, m.y - camY, m.x - camX, &m.cell, 1);
+  ++stats.cellsTouched;
+}
+
+void Ui::restoreTile(const Map& map, int x, int y) {
+  if (!onMapViewport(x, y)) return;
+  const Cell c = terrainCell(map, x, y);
+  out->cells(Renderer::MapView, y - camY, x - camX, &c, 1);
+  ++stats.cellsTouched;
+}
+
+Cell Ui::terrainCell(const Map& map, int x, int y) const {
+  const char g = Map::glyph(map.getTile(x, y));
+  if (!fov || fov->isVisible(x, y)) return { g, kPlain };
+  return fov->isExplored(x, y) ? Cell{ g, kDim } : Cell{};
+}
+
+void Ui::drawTerrain(const Map& map, int rows, int cols) {
+  rows = std::min(rows, map.getHeight() - camY);
+  cols = std::min(cols, map.getWidth()  - camX);
+  if (rows <= 0 || cols <= 0) return;
+  rowBuf.resize((size_t)cols);
+  for (int y = 0; y < rows; ++y) {
+    for (int x = 0; x < cols; ++x) rowBuf[x] = terrainCell(map, camX + x, camY + y);
+    out->cells(Renderer::MapView, y, 0, rowBuf.data(), cols);
   }
+}
+
+bool Ui::drawMap(const Map& map, const Player& player, const EntityStore& actors) {
+  if (!out) return false;
+  ProfileScope scope("Ui::drawMap");
 
-  // SIDEBAR + MSG
-  drawSidebar(player, enemy);
-  drawMessageBox(message, showIndicator);
+  const int mh = panel[Renderer::MapView].h, mw = panel[Renderer::MapView].w;
+  camX = Map::viewOrigin(player.getX(), map.getWidth(),  mw);
+  camY = Map::viewOrigin(player.getY(), map.getHeight(), mh);
+  // start paging in one screen around the view before we scroll into it
+  if (!mapValid || camX != mapCamX || camY != mapCamY)
+    map.prefetch(camX - mw, camY - mh, 3 * mw, 3 * mh);
 
-  if (w.hud)  wnoutrefresh(w.hud);
-  if (w.mapw) wnoutrefresh(w.mapw);
-  if (w.side) wnoutrefresh(w.side);
-  if (w.msg)  wnoutrefresh(w.msg);
-  doupdate();
+  // entities, in draw order (later ones win on shared tiles)
+  // (only actors inside the viewport are visited)
+  marks.clear();
+  actors.forEachInRect(camX, camY, mw, mh, [&](size_t i){
+    if (!actors.aliveAt(i)) return;
+    if (fov && !fov->isVisible(actors.xAt(i), actors.yAt(i))) return;
+    if (actors.kindAt(i) == EntityKind::Enemy)
+      marks.push_back({ actors.xAt(i), actors.yAt(i), { 'g', kRed | kBold } });
+    else
+      marks.push_back({ actors.xAt(i), actors.yAt(i), { 'N', kGreen | kBold } });
+  });
+  marks.push_back({ player.getX(), player.getY(), { '@', kCyan | kBold } });
+
+  const uint64_t fovVersion = fov ? fov->version() : 0;
+  const bool full = !mapValid || map.version() != mapVersion ||
+                    fovVersion != mapFovVersion ||
+                    camX != mapCamX || camY != mapCamY;
+  if (full) {
+    out->clear(Renderer::MapView);
+    drawTerrain(map, mh, mw);
+    stats.cellsTouched += mh * mw;
+    for (const auto& m : marks) drawMark(m);
+  } else if (marks != prevMarks) {
+    // put the terrain back where entities were, then draw them again
+    for (const auto& m : prevMarks) restoreTile(map, m.x, m.y);
+    for (const auto& m : marks) drawMark(m);
+  } else {
+    return false;
+  }
+
+  mapValid = true;
+  mapVersion = map.version();
+  mapFovVersion = fovVersion;
+  mapCamX = camX; mapCamY = camY;
+  prevMarks.swap(marks);
+  return true;
+}
+
+void Ui::renderFrame(const Map& map, const Player& player,
+                     const EntityStore& actors, EntityHandle foe,
+                     const MessageLog& log, bool showIndicator) {
+  stats.cellsTouched = 0;
+  stats.windowsRefreshed = 0;
+  ++stats.frames;
+  if (!out) return;
+  ProfileScope scope("Ui::renderFrame");
+
+  bool mapDirty  = drawMap(map, player, actors);
+  bool sideDirty = drawSidebar(player, actors, foe);
+  bool msgDirty  = drawMessageBox(log, showIndicator);
+  // The HUD readout shows the cost of the last frame that had real work
+  // (HUD excluded), so showing it does not keep idle frames busy.
+  if (mapDirty || sideDirty || msgDirty) shownCells = stats.cellsTouched;
+  bool hudDirty  = drawHUD(player, actors, foe);
+
+  if (hudDirty)  { out->touch(Renderer::Hud);     ++stats.windowsRefreshed; }
+  if (mapDirty)  { out->touch(Renderer::MapView); ++stats.windowsRefreshed; }
+  if (sideDirty) { out->touch(Renderer::Side);    ++stats.windowsRefreshed; }
+  if (msgDirty)  { out->touch(Renderer::Msg);     ++stats.windowsRefreshed; }
+
+  if (!stats.windowsRefreshed) { ++stats.idleFrames; return; }
+  {
+    ProfileScope flush("present");
+    out->present();
+  }
+  Profiler::presented();
 }
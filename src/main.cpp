@@ -1,7 +1,106 @@
+#include <chrono>
+#include <cstdio>
+#include <string>
 #include "Game.h"
+#include "GameOptions.h"
+#include "Input.h"
+#include "ItemRegistry.h"
+#include "LevelFile.h"
+#include "Profiler.h"
+#include "SaveGame.h"
 
-int main() {
-    Game game;
-    game.run();
-    return 0;
+static const char* kUsage =
+    "usage: twindisseia [options] [level.twlv]\n"
+    "  --seed N        dungeon/RNG seed (default: from the clock)\n"
+    "  --save FILE     autosave to FILE while playing\n"
+    "  --load FILE     continue a saved game (and keep saving to it)\n"
+    "  --record FILE   log the seed and every key to FILE\n"
+    "  --replay FILE   play a key log back headless, as fast as possible\n"
+    "  --profile FILE  record timings and write a Chrome trace to FILE on exit\n"
+    "  --items FILE    item definitions and loadouts (default: data/items.ini)\n"
+    "  --threads N     threads for the world turn (default: 2, 0 = all cores)\n"
+    "  --renderer NAME ncurses (default) or ansi: diffed frames, one write each\n";
+
+static const char* kDefaultItems = "data/items.ini";
+
+static int fail(const std::string& err) {
+    std::fprintf(stderr, "twindisseia: %s\n", err.c_str());
+    return 1;
+}
+
+int main(int argc, char** argv) {
+    GameOptions opts;
+    std::string err;
+    if (!parseGameOptions(argc, argv, opts, err)) {
+        std::fprintf(stderr, "twindisseia: %s\n%s", err.c_str(), kUsage);
+        return 1;
+    }
+
+    // the replay log decides the seed and level
+    Input input;
+    if (!opts.replayPath.empty() && !input.replay(opts.replayPath, opts.seed, opts.levelPath, err))
+        return fail(err);
+    if (opts.seed == 0) opts.seed = Game::clockSeed();
+    if (!opts.profilePath.empty()) Profiler::setEnabled(true);
+
+    // items before anything equips them; without a file the built-ins stay
+    if (!opts.itemsPath.empty()) {
+        if (!ItemRegistry::global().load(opts.itemsPath, err)) return fail(err);
+    } else if (FILE* f = std::fopen(kDefaultItems, "r")) {
+        std::fclose(f);
+        if (!ItemRegistry::global().load(kDefaultItems, err)) return fail(err);
+    }
+
+    Level level;
+    SaveState save;
+    if (!opts.loadPath.empty()) {
+        if (!loadSave(opts.loadPath, save, err)) return fail(err);
+        level.map = std::move(save.map);
+        if (opts.savePath.empty()) opts.savePath = opts.loadPath;
+    } else if (!opts.levelPath.empty() && !loadLevel(opts.levelPath, level, err)) {
+        return fail(err);
+    }
+    if (!opts.recordPath.empty() && !input.record(opts.recordPath, opts.seed, opts.levelPath, err))
+        return fail(err);
+
+    const bool haveLevel = !opts.loadPath.empty() || !opts.levelPath.empty();
+    const auto t0 = std::chrono::steady_clock::now();
+    int status = 0;
+    std::string saveErr;
+    {
+        Game game(opts, input, haveLevel ? &level : nullptr);
+        if (!opts.loadPath.empty()) game.restore(save);
+        if (!opts.savePath.empty()) game.autosaveTo(opts.savePath);
+        game.run();
+        input.finish(game.summary());
+        saveErr = game.saveError();
+
+        if (input.replaying()) {
+            const double ms = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - t0).count();
+            const std::string end = game.summary();
+            std::printf("%s\n", end.c_str());
+            std::printf("replayed %zu keys in %.1f ms\n", input.keysRead(), ms);
+            if (!input.expectedSummary().empty() && input.expectedSummary() != end) {
+                std::printf("MISMATCH, recording ended with:\n%s\n", input.expectedSummary().c_str());
+                status = 2;
+            }
+        }
+    }
+
+    // after the game has given the terminal back
+    if (!saveErr.empty()) {
+        std::fprintf(stderr, "twindisseia: the game was not saved: %s\n", saveErr.c_str());
+        if (status == 0) status = 1;
+    }
+
+    if (!opts.profilePath.empty()) {
+        size_t events = 0;
+        if (!Profiler::writeTrace(opts.profilePath, events, err)) return fail(err);
+        const ProfileSummary p = Profiler::summary();
+        std::printf("profile: %zu events -> %s\n", events, opts.profilePath.c_str());
+        std::printf("frame p50 %.3f ms p99 %.3f ms (%zu frames), input p50 %.3f ms p99 %.3f ms (%zu keys)\n",
+                    p.frameP50Ms, p.frameP99Ms, p.frames, p.inputP50Ms, p.inputP99Ms, p.inputs);
+    }
+    return status;
 }
@@ -0,0 +1,91 @@
+// Focused checks for the dice compiler and the turn scheduler.
+//
+//   make check   (also replays tests/replays/*.log)
+#include <cstdio>
+#include <string>
+#include "DicePlan.h"
+#include "Rng.h"
+#include "TurnScheduler.h"
+
+static int failures = 0;
+
+static void expect(bool ok, const std::string& what) {
+  if (ok) return;
+  ++failures;
+  std::printf("FAIL %s\n", what.c_str());
+}
+
+// Canonical text for a few spellings, and that the text compiles back to
+// a plan that prints and rolls the same.
+static void diceRoundTrips() {
+  const char* cases[][2] = {
+    { "1d8", "1d8" },          { "2d4+1", "2d4+1" },      { "4d6kh3", "4d6kh3" },
+    { "1d8!-1", "1d8!-1" },    { "1d6,1d4", "1d6+1d4" },  { "d6", "1d6" },
+    { "2d6+1d6", "3d6" },      { "3+2", "5" },            { "5d1", "5" },
+    { "4d6k4", "4d6" },        { "1d20kl1", "1d20" },     { "2d6-1d4+3", "2d6-1d4+3" },
+    { " 2d4 + 1 ", "2d4+1" },  { "0d6", "" },             { "", "" },
+    { "3d10kl2+1d4!", "3d10kl2+1d4!" },
+  };
+  for (const auto& c : cases) {
+    DicePlan p, q;
+    std::string err;
+    const std::string name = std::string("dice '") + c[0] + "'";
+    if (!DicePlan::compile(c[0], p, err)) { expect(false, name + ": " + err); continue; }
+    expect(p.toString() == c[1], name + " printed as '" + p.toString() + "', want '" + c[1] + "'");
+    if (!DicePlan::compile(p.toString(), q, err)) { expect(false, name + " reprint: " + err); continue; }
+    expect(q.toString() == p.toString(), name + " does not survive a round trip");
+    Rng a(7), b(7);
+    bool same = true;
+    for (int i = 0; i < 1000; ++i) same &= p.roll(a) == q.roll(b);
+    expect(same, name + " rolls differently after a round trip");
+  }
+
+  // errors leave the plan as it was
+  for (const char* bad : { "4d6kh", "d", "1d6x", "1d0" }) {
+    DicePlan p = DicePlan::dice(2, 6);
+    std::string err;
+    expect(!DicePlan::compile(bad, p, err) && !err.empty(), std::string("dice '") + bad + "' compiled");
+    expect(p.toString() == "2d6", std::string("dice '") + bad + "' changed the plan");
+  }
+}
+
+// Over `actions` turns, how many each of two actors gets.
+static void share(int speedA, int costA, int speedB, int costB, int actions, int& a, int& b) {
+  TurnScheduler s;
+  s.add(0, speedA, true);
+  s.add(1, speedB);
+  a = b = 0;
+  for (int i = 0; i < actions; ++i) {
+    const TurnScheduler::ActorId id = s.next();
+    (id == 0 ? a : b) += 1;
+    s.done(id, id == 0 ? costA : costB);
+  }
+}
+
+// Turns come in proportion to speed, and to 1/cost.
+static void turnRatios() {
+  int a, b;
+  share(7, TurnScheduler::kActionCost, 3, TurnScheduler::kActionCost, 1000, a, b);
+  expect(a == 700 && b == 300, "speed 7 vs 3 gave " + std::to_string(a) + ":" + std::to_string(b));
+  share(5, TurnScheduler::kActionCost, 5, TurnScheduler::kActionCost, 1000, a, b);
+  expect(a == 500 && b == 500, "speed 5 vs 5 gave " + std::to_string(a) + ":" + std::to_string(b));
+  share(10, 50, 10, TurnScheduler::kActionCost, 900, a, b);
+  expect(a == 600 && b == 300, "cost 50 vs 100 gave " + std::to_string(a) + ":" + std::to_string(b));
+
+  // ties go to the actor added as first
+  TurnScheduler s;
+  s.add(1, 4);
+  s.add(0, 4, true);
+  expect(s.next() == 0, "a tie did not go to the first actor");
+}
+
+int main() {
+  diceRoundTrips();
+  turnRatios();
+  if (failures) {
+    std::printf("%d check(s) failed\n", failures);
+    return 1;
+  }
+  std::printf("checks passed\n");
+  return 0;
+}
@@ -0,0 +1,242 @@
+// Load generator for twindisseia-server. Opens many sessions, has each
+// one press a key at a steady rate and times every key with a status
+// request (ESC [ 5 n, answered with ESC [ 0 n once the key has been
+// handled and drawn). Reports latency percentiles and, through the
+// socket's peer pid and /proc, the server's CPU time and memory, which
+// give sessions per core.
+//
+//   ./twindisseia-loadgen --socket /tmp/tw.sock --sessions 2000 --rate 2
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <queue>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "Rng.h"
+#include "ToolArgs.h"
+
+static void usage() {
+  std::printf(
+    "usage: twindisseia-loadgen [options]\n"
+    "  --socket PATH   server socket (default /tmp/twindisseia.sock)\n"
+    "  --sessions N    sessions to open (default 1000)\n"
+    "  --seconds N     how long to send keys (default 10)\n"
+    "  --rate N        keys per second per session (default 2)\n"
+    "  --seed N        key choice and timing (default 1)\n");
+}
+
+static double nowSec() {
+  return std::chrono::duration<double>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// utime + stime of `pid` in seconds, -1 if unreadable.
+static double cpuSeconds(int pid) {
+  char path[64], buf[1024];
+  std::snprintf(path, sizeof path, "/proc/%d/stat", pid);
+  FILE* f = std::fopen(path, "r");
+  if (!f) return -1;
+  const size_t n = std::fread(buf, 1, sizeof buf - 1, f);
+  std::fclose(f);
+  buf[n] = 0;
+  const char* p = std::strrchr(buf, ')');   // the name may contain spaces
+  unsigned long long ut = 0, st = 0;
+  if (!p || std::sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu",
+                        &ut, &st) != 2)
+    return -1;
+  return (double)(ut + st) / (double)sysconf(_SC_CLK_TCK);
+}
+
+static double rssBytes(int pid) {
+  char path[64];
+  std::snprintf(path, sizeof path, "/proc/%d/statm", pid);
+  FILE* f = std::fopen(path, "r");
+  if (!f) return -1;
+  unsigned long long size = 0, rss = 0;
+  const bool ok = std::fscanf(f, "%llu %llu", &size, &rss) == 2;
+  std::fclose(f);
+  return ok ? (double)rss * (double)sysconf(_SC_PAGESIZE) : -1;
+}
+
+struct Client {
+  int fd = -1;
+  bool open = false;
+  bool framed = false;     // first frame arrived
+  double sentAt = 0;       // waiting for the reply to this key (0 = not)
+  char tail[3] = {};       // last bytes read, for a reply split across reads
+};
+
+static const char kReply[] = "\x1b[0n";
+
+int main(int argc, char** argv) {
+  std::string path = "/tmp/twindisseia.sock";
+  size_t sessions = 1000;
+  double seconds = 10, rate = 2;
+  uint64_t seed = 1;
+  for (int i = 1; i < argc; ++i) {
+    const char* a = argv[i];
+    auto next = [&]() -> const char* {
+      if (i + 1 >= argc) { usage(); std::exit(1); }
+      return argv[++i];
+    };
+    if      (!std::strcmp(a, "--socket"))   path = next();
+    else if (!std::strcmp(a, "--sessions")) sessions = std::strtoull(next(), nullptr, 10);
+    else if (!std::strcmp(a, "--seconds"))  seconds = std::atof(next());
+    else if (!std::strcmp(a, "--rate"))     rate = std::atof(next());
+    else if (!std::strcmp(a, "--seed"))     seed = std::strtoull(next(), nullptr, 10);
+    else { usage(); return isHelpFlag(a) ? 0 : 1; }
+  }
+  if (sessions == 0 || rate <= 0 || seconds <= 0) { usage(); return 1; }
+
+  // one descriptor per session, plus a few
+  rlimit lim{};
+  if (getrlimit(RLIMIT_NOFILE, &lim) == 0 && lim.rlim_cur < sessions + 64) {
+    lim.rlim_cur = std::min<rlim_t>(lim.rlim_max, sessions + 64);
+    setrlimit(RLIMIT_NOFILE, &lim);
+  }
+
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  std::snprintf(addr.sun_path, sizeof addr.sun_path, "%s", path.c_str());
+  const int ep = epoll_create1(EPOLL_CLOEXEC);
+
+  std::vector<Client> clients(sessions);
+  int pid = -1;
+  double rss0 = -1;
+  const double c0 = nowSec();
+  for (size_t i = 0; i < sessions; ++i) {
+    Client& c = clients[i];
+    c.fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (c.fd < 0 || connect(c.fd, (sockaddr*)&addr, sizeof addr) != 0) {
+      std::fprintf(stderr, "twindisseia-loadgen: session %zu: %s\n", i, std::strerror(errno));
+      if (c.fd >= 0) close(c.fd);
+      c.fd = -1;
+      if (i == 0) return 1;
+      clients.resize(i);
+      break;
+    }
+    if (pid < 0) {
+      ucred cred{};
+      socklen_t len = sizeof cred;
+      if (getsockopt(c.fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) == 0) pid = cred.pid;
+      rss0 = rssBytes(pid);
+    }
+    fcntl(c.fd, F_SETFL, O_NONBLOCK);
+    c.open = true;
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.u64 = i;
+    epoll_ctl(ep, EPOLL_CTL_ADD, c.fd, &ev);
+  }
+  sessions = clients.size();
+
+  std::vector<double> lat;      // seconds
+  size_t replies = 0, ended = 0;
+  uint64_t bytes = 0;
+  char buf[1 << 16];
+  epoll_event events[512];
+  auto pollOnce = [&](int timeoutMs) {
+    const int n = epoll_wait(ep, events, 512, timeoutMs);
+    const double t = nowSec();
+    for (int k = 0; k < n; ++k) {
+      Client& c = clients[events[k].data.u64];
+      for (;;) {
+        const ssize_t r = recv(c.fd, buf, sizeof buf, 0);
+        if (r == 0 || (r < 0 && errno != EAGAIN && errno != EINTR)) {
+          epoll_ctl(ep, EPOLL_CTL_DEL, c.fd, nullptr);
+          close(c.fd);
+          c.open = false;
+          ++ended;
+          break;
+        }
+        if (r < 0) break;
+        bytes += (uint64_t)r;
+        c.framed = true;
+        // the reply may straddle the previous read
+        std::string scan(c.tail, c.tail + 3);
+        scan.append(buf, (size_t)r);
+        if (c.sentAt > 0 && scan.find(kReply) != std::string::npos) {
+          lat.push_back(t - c.sentAt);
+          c.sentAt = 0;
+          ++replies;
+        }
+        std::memcpy(c.tail, scan.data() + scan.size() - 3, 3);
+      }
+    }
+  };
+
+  // everyone has drawn a first frame before the clock starts
+  while (nowSec() - c0 < 30) {
+    const size_t framed = (size_t)std::count_if(clients.begin(), clients.end(),
+                                                [](const Client& c) { return c.framed || !c.open; });
+    if (framed == sessions) break;
+    pollOnce(100);
+  }
+  const double connectSec = nowSec() - c0;
+  const double rss1 = rssBytes(pid);
+
+  struct Send { double at; size_t i; bool operator>(const Send& o) const { return at > o.at; } };
+  std::priority_queue<Send, std::vector<Send>, std::greater<Send>> due;
+  Rng rng(seed);
+  const double period = 1.0 / rate;
+  const double t0 = nowSec();
+  const double cpu0 = cpuSeconds(pid);
+  for (size_t i = 0; i < sessions; ++i)
+    due.push({ t0 + period * (double)rng.bounded(1000000) / 1e6, i });
+  size_t sent = 0, skipped = 0;
+  const double tEnd = t0 + seconds;
+  static const char kKeys[] = "wasd";
+  for (double t = t0; t < tEnd; t = nowSec()) {
+    while (!due.empty() && due.top().at <= t) {
+      const Send s = due.top();
+      due.pop();
+      Client& c = clients[s.i];
+      if (!c.open) continue;
+      due.push({ s.at + period, s.i });
+      if (c.sentAt > 0) { ++skipped; continue; }   // still waiting for the last one
+      char msg[8] = { kKeys[rng.bounded(4)], '\x1b', '[', '5', 'n' };
+      if (send(c.fd, msg, 5, MSG_NOSIGNAL) == 5) { c.sentAt = t; ++sent; }
+    }
+    const double next = due.empty() ? tEnd : std::min(tEnd, due.top().at);
+    pollOnce(std::max(0, (int)((next - nowSec()) * 1000)));
+  }
+  const double wall = nowSec() - t0;
+  const double cpu = cpuSeconds(pid) - cpu0;
+  // late replies still count
+  for (double t = nowSec(); replies < sent && nowSec() - t < 2; ) pollOnce(50);
+
+  std::sort(lat.begin(), lat.end());
+  auto pct = [&](double q) {
+    return lat.empty() ? 0.0 : 1e3 * lat[std::min(lat.size() - 1, (size_t)(q * (double)lat.size()))];
+  };
+  std::printf("sessions    : %zu opened in %.2f s, %zu ended early\n", sessions, connectSec, ended);
+  if (rss0 > 0 && rss1 > 0)
+    std::printf("server RSS  : %.1f MB, ~%.0f KB per session\n",
+                rss1 / 1e6, (rss1 - rss0) / 1e3 / (double)std::max<size_t>(sessions - 1, 1));
+  std::printf("keys        : %zu in %.1f s (%.0f/s), %zu answered, %zu skipped (reply pending)\n",
+              sent, wall, (double)sent / wall, replies, skipped);
+  std::printf("traffic     : %.1f MB from the server (%.0f bytes per key)\n",
+              bytes / 1e6, sent ? (double)bytes / (double)sent : 0.0);
+  std::printf("latency     : p50 %.3f ms  p90 %.3f ms  p99 %.3f ms  max %.3f ms\n",
+              pct(0.50), pct(0.90), pct(0.99), lat.empty() ? 0.0 : 1e3 * lat.back());
+  if (pid > 0 && cpu0 >= 0 && cpu > 0) {
+    const double load = cpu / wall;   // cores busy
+    std::printf("server CPU  : %.1f%% of a core -> %.0f sessions per core at %.1f keys/s\n",
+                100.0 * load, (double)sessions / load, rate);
+  } else {
+    std::printf("server CPU  : not measurable (pid %d)\n", pid);
+  }
+  for (Client& c : clients)
+    if (c.open) close(c.fd);
+  close(ep);
+  return 0;
+}
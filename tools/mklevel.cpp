@@ -0,0 +1,75 @@
+// Level converter: turns a text layout into a binary .twlv level, and
+// checks or describes existing level files.
+//
+//   ./twindisseia-mklevel layout.txt level.twlv
+//   ./twindisseia-gen --width 2000 --height 2000 --print | ./twindisseia-mklevel - big.twlv
+//   ./twindisseia-mklevel --info big.twlv
+//   ./twindisseia-mklevel --verify big.twlv
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "LevelFile.h"
+#include "ToolArgs.h"
+
+static void usage() {
+  std::printf(
+    "usage: twindisseia-mklevel <layout.txt|-> <out.twlv>\n"
+    "       twindisseia-mklevel --info <level.twlv>\n"
+    "       twindisseia-mklevel --verify <level.twlv>\n"
+    "layout: '#' wall, '.' floor, ' ' void, '@' player, 'g' enemy, 'N' NPC\n");
+}
+
+static double msSince(std::chrono::steady_clock::time_point t0) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int main(int argc, char** argv) {
+  if (argc == 2 && isHelpFlag(argv[1])) { usage(); return 0; }
+  if (argc != 3) { usage(); return 1; }
+  std::string err;
+
+  if (!std::strcmp(argv[1], "--info")) {
+    auto t0 = std::chrono::steady_clock::now();
+    Level level;
+    if (!loadLevel(argv[2], level, err)) { std::fprintf(stderr, "%s\n", err.c_str()); return 1; }
+    const double ms = msSince(t0);
+    size_t counts[3] = {0, 0, 0};
+    for (const LevelSpawn& s : level.spawns) if (s.kind < 3) ++counts[s.kind];
+    std::printf("%s: %dx%d, %zu chunks, opened in %.2f ms\n", argv[2],
+                level.map.getWidth(), level.map.getHeight(), level.map.chunkCount(), ms);
+    std::printf("spawns: %zu player, %zu enemy, %zu npc\n", counts[0], counts[1], counts[2]);
+    return 0;
+  }
+
+  if (!std::strcmp(argv[1], "--verify")) {
+    auto t0 = std::chrono::steady_clock::now();
+    if (!verifyLevel(argv[2], err)) { std::fprintf(stderr, "%s\n", err.c_str()); return 1; }
+    std::printf("%s: ok (%.1f ms)\n", argv[2], msSince(t0));
+    return 0;
+  }
+
+  std::stringstream text;
+  if (!std::strcmp(argv[1], "-")) text << std::cin.rdbuf();
+  else {
+    std::ifstream in(argv[1], std::ios::binary);
+    if (!in) { std::fprintf(stderr, "%s: cannot open\n", argv[1]); return 1; }
+    text << in.rdbuf();
+  }
+
+  Level level;
+  if (!parseAsciiLevel(text.str(), level, err)) {
+    std::fprintf(stderr, "%s: %s\n", argv[1], err.c_str());
+    return 1;
+  }
+  if (!saveLevel(argv[2], level.map, level.spawns, err)) {
+    std::fprintf(stderr, "%s\n", err.c_str());
+    return 1;
+  }
+  std::printf("%s: %dx%d, %zu chunks, %zu spawns\n", argv[2], level.map.getWidth(),
+              level.map.getHeight(), level.map.chunkCount(), level.spawns.size());
+  return 0;
+}
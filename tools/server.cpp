@@ -0,0 +1,86 @@
+// Game server: many headless sessions in one process over a Unix socket
+// (see GameServer.h for the protocol).
+//
+//   ./twindisseia-server --socket /tmp/tw.sock
+//   socat -,raw,echo=0 UNIX-CONNECT:/tmp/tw.sock        (play one session)
+//   ./twindisseia-loadgen --socket /tmp/tw.sock --sessions 2000
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/resource.h>
+#include "GameServer.h"
+#include "ItemRegistry.h"
+#include "ToolArgs.h"
+
+static void usage() {
+  std::printf(
+    "usage: twindisseia-server [options]\n"
+    "  --socket PATH   Unix socket to listen on (default /tmp/twindisseia.sock)\n"
+    "  --seed N        session n plays seed N + n (default: from the clock)\n"
+    "  --max N         most sessions at once (default 20000)\n"
+    "  --items FILE    item definitions and loadouts (default: data/items.ini)\n");
+}
+
+static GameServer* server = nullptr;
+
+static void onSignal(int) {
+  if (server) server->stop();
+}
+
+int main(int argc, char** argv) {
+  ServerConfig cfg;
+  cfg.socketPath = "/tmp/twindisseia.sock";
+  const char* itemsPath = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    const char* a = argv[i];
+    auto next = [&]() -> const char* {
+      if (i + 1 >= argc) { usage(); std::exit(1); }
+      return argv[++i];
+    };
+    if      (!std::strcmp(a, "--socket")) cfg.socketPath = next();
+    else if (!std::strcmp(a, "--seed"))   cfg.seed = std::strtoull(next(), nullptr, 10);
+    else if (!std::strcmp(a, "--max"))    cfg.maxSessions = std::strtoull(next(), nullptr, 10);
+    else if (!std::strcmp(a, "--items"))  itemsPath = next();
+    else { usage(); return isHelpFlag(a) ? 0 : 1; }
+  }
+
+  std::string err;
+  auto fail = [&] {
+    std::fprintf(stderr, "twindisseia-server: %s\n", err.c_str());
+    return 1;
+  };
+  if (!itemsPath) {
+    if (FILE* f = std::fopen("data/items.ini", "r")) { std::fclose(f); itemsPath = "data/items.ini"; }
+  }
+  if (itemsPath && !ItemRegistry::global().load(itemsPath, err)) return fail();
+
+  // one descriptor per session, plus a few
+  rlimit lim{};
+  if (getrlimit(RLIMIT_NOFILE, &lim) == 0 && lim.rlim_cur < cfg.maxSessions + 64) {
+    lim.rlim_cur = std::min<rlim_t>(lim.rlim_max, cfg.maxSessions + 64);
+    setrlimit(RLIMIT_NOFILE, &lim);
+  }
+
+  GameServer srv(cfg);
+  if (!srv.listen(err)) return fail();
+  server = &srv;
+  struct sigaction sa{};
+  sa.sa_handler = onSignal;   // no SA_RESTART: epoll_wait returns EINTR
+  sigaction(SIGINT, &sa, nullptr);
+  sigaction(SIGTERM, &sa, nullptr);
+
+  std::printf("listening on %s\n", cfg.socketPath.c_str());
+  std::fflush(stdout);
+  const bool ok = srv.run(err);
+  server = nullptr;
+
+  const ServerStats& st = srv.stats();
+  std::printf("sessions: %llu served, %zu peak, %llu refused\n",
+              (unsigned long long)st.accepted, st.peak, (unsigned long long)st.refused);
+  std::printf("traffic : %.1f KB in, %.1f MB out, %llu session runs\n",
+              st.bytesIn / 1e3, st.bytesOut / 1e6, (unsigned long long)st.pumps);
+  return ok ? 0 : fail();
+}
@@ -0,0 +1,188 @@
+// Headless combat simulator: plays many Player-vs-Enemy fights with the
+// same rules as the game and prints win rate and distributions.
+//
+//   ./twindisseia-sim --fights 10000000 --threads 8 --seed 42
+//   ./twindisseia-sim --p-weapon 2d6 --e-hp 12
+//   ./twindisseia-sim --p-weapon 4d6kh3 --exact
+//   ./twindisseia-sim --exact --fights 0     (analytic odds only)
+//   ./twindisseia-sim --sweep                (score many player loadouts)
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "CombatSim.h"
+#include "FightSolver.h"
+#include "ItemRegistry.h"
+#include "StartingGear.h"
+
+static void usage() {
+  std::printf(
+    "usage: twindisseia-sim [options]\n"
+    "  --fights N      number of fights (default 1000000)\n"
+    "  --threads N     worker threads (default: all cores)\n"
+    "  --seed N        base seed (default 1)\n"
+    "  --p-hp/--p-spd/--p-atk/--p-def N   player base stats\n"
+    "  --e-hp/--e-spd/--e-atk/--e-def N   enemy base stats\n"
+    "  --p-weapon D    player weapon dice, e.g. 1d8, 2d4+1, 4d6kh3, 1d8!-1\n"
+    "  --e-weapon D    enemy weapon dice\n"
+    "  --items FILE    item definitions and loadouts (default: built in)\n"
+    "  --exact         also print exact odds from the Markov solver\n"
+    "  --sweep         score player gear combinations with the solver\n");
+}
+
+static void printHist(const char* title, const std::vector<uint64_t>& h, uint64_t total) {
+  std::printf("%s\n", title);
+  for (size_t i = 0; i < h.size(); ++i) {
+    if (!h[i]) continue;
+    double pct = 100.0 * (double)h[i] / (double)total;
+    int bar = (int)(pct / 2.0);
+    std::printf("  %4zu  %7.3f%%  %.*s\n", i, pct, bar,
+                "##################################################");
+  }
+}
+
+// Enumerates player weapon/helmet/chest/boots variations against a fixed
+// enemy and ranks them by exact win probability.
+static void sweep(const Player& basePlayer, const Enemy& enemy) {
+  static const int sidesList[] = { 4, 6, 8, 10, 12 };
+  static const int armorSides[] = { 0, 2, 4, 6 };
+
+  FightSolver solver;
+  combat::Combatant foe = combat::fromEnemy(enemy);
+
+  struct Row { double win, turns; int wc, ws, hs, flat, spd; };
+  std::vector<Row> rows;
+
+  auto t0 = std::chrono::steady_clock::now();
+  for (int wc = 1; wc <= 4; ++wc)
+  for (int ws : sidesList)
+  for (int hs : armorSides)
+  for (int flat = 0; flat <= 3; ++flat)
+  for (int spd = 0; spd <= 3; ++spd) {
+    Equipment weapon = basePlayer.getWeapon();
+    weapon.attackDice = DicePlan::dice(wc, ws);
+    Equipment helmet = basePlayer.getHelmet();
+    helmet.defenseDice = DicePlan::dice(1, hs);
+    Equipment chest = basePlayer.getChest();
+    chest.flatDefBonus = flat;
+
+    combat::Combatant me = combat::fromPlayer(basePlayer);
+    me.speed  = me.speed - basePlayer.getBoots().spdBonus + spd;
+    me.weapon = &weapon;
+    me.armor[0] = &helmet;
+    me.armor[1] = &chest;
+
+    FightOdds o = solver.solve(me, foe);
+    rows.push_back({ o.playerWin, o.expectedTurns, wc, ws, hs, flat, spd });
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+
+  std::sort(rows.begin(), rows.end(),
+            [](const Row& a, const Row& b){ return a.win > b.win; });
+  std::printf("scored %zu loadouts in %.3f ms (%zu cached damage PMFs)\n",
+              rows.size(), ms, solver.cacheSize());
+  std::printf("  %-8s %-7s %-5s %-5s %10s %8s\n",
+              "weapon", "helmet", "flat", "spd+", "win%", "turns");
+  for (size_t i = 0; i < rows.size() && i < 10; ++i) {
+    const Row& r = rows[i];
+    char w[16], h[16];
+    std::snprintf(w, sizeof w, "%dd%d", r.wc, r.ws);
+    if (r.hs) std::snprintf(h, sizeof h, "1d%d", r.hs); else std::snprintf(h, sizeof h, "-");
+    std::printf("  %-8s %-7s %-5d %-5d %9.4f%% %8.3f\n",
+                w, h, r.flat, r.spd, 100.0 * r.win, r.turns);
+  }
+}
+
+int main(int argc, char** argv) {
+  SimConfig cfg;
+  int pStats[4] = { 10, 5, 2, 1 };   // hp spd atk def (Player defaults)
+  int eStats[4] = {  6, 3, 1, 0 };   // Enemy defaults
+  const char* pWeapon = nullptr;
+  const char* eWeapon = nullptr;
+  const char* itemsPath = nullptr;
+  bool exact = false, doSweep = false;
+
+  static const char* statNames[4] = { "hp", "spd", "atk", "def" };
+  for (int i = 1; i < argc; ++i) {
+    std::string a = argv[i];
+    const char* v = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    bool used = false;
+    if (a == "-h" || a == "--help") { usage(); return 0; }
+    if (a == "--exact") { exact = true; continue; }
+    if (a == "--sweep") { doSweep = true; continue; }
+    if (!v) { usage(); return 1; }
+    if      (a == "--fights")   { cfg.fights  = std::strtoull(v, nullptr, 10); used = true; }
+    else if (a == "--threads")  { cfg.threads = (unsigned)std::strtoul(v, nullptr, 10); used = true; }
+    else if (a == "--seed")     { cfg.seed    = std::strtoull(v, nullptr, 10); used = true; }
+    else if (a == "--p-weapon") { pWeapon = v; used = true; }
+    else if (a == "--e-weapon") { eWeapon = v; used = true; }
+    else if (a == "--items")    { itemsPath = v; used = true; }
+    for (int s = 0; s < 4 && !used; ++s) {
+      if (a == std::string("--p-") + statNames[s]) { pStats[s] = std::atoi(v); used = true; }
+      if (a == std::string("--e-") + statNames[s]) { eStats[s] = std::atoi(v); used = true; }
+    }
+    if (!used) { usage(); return 1; }
+    ++i;
+  }
+
+  std::string err;
+  auto fail = [&] {
+    std::fprintf(stderr, "twindisseia-sim: %s\n", err.c_str());
+    return 1;
+  };
+  if (itemsPath && !ItemRegistry::global().load(itemsPath, err)) return fail();
+
+  Player player(0, 0, pStats[0], pStats[1], pStats[2], pStats[3]);
+  Enemy  enemy (0, 0, eStats[0], eStats[1], eStats[2], eStats[3]);
+  giveStartingGear(player);
+  giveStartingGear(enemy);
+
+  // custom weapons become registry items named after their dice
+  if (pWeapon) {
+    Equipment w = player.getWeapon();
+    if (!DicePlan::compile(pWeapon, w.attackDice, err)) return fail();
+    w.name = pWeapon;
+    player.equip(ItemRegistry::global().intern(w));
+  }
+  if (eWeapon) {
+    Equipment w = enemy.getWeapon();
+    if (!DicePlan::compile(eWeapon, w.attackDice, err)) return fail();
+    w.name = eWeapon;
+    enemy.equip(ItemRegistry::global().intern(w));
+  }
+
+  if (doSweep) { sweep(player, enemy); return 0; }
+
+  if (exact) {
+    auto t0 = std::chrono::steady_clock::now();
+    FightOdds o = solveFight(combat::fromPlayer(player), combat::fromEnemy(enemy));
+    auto t1 = std::chrono::steady_clock::now();
+    std::printf("exact       : win %.4f%%  expected turns %.4f  (%.3f ms)\n",
+                100.0 * o.playerWin, o.expectedTurns,
+                std::chrono::duration<double, std::milli>(t1 - t0).count());
+  }
+  if (cfg.fights == 0) return 0;
+
+  auto t0 = std::chrono::steady_clock::now();
+  SimStats st = simulateFights(combat::fromPlayer(player), combat::fromEnemy(enemy), cfg);
+  auto t1 = std::chrono::steady_clock::now();
+  double secs = std::chrono::duration<double>(t1 - t0).count();
+
+  std::printf("fights      : %llu in %.3f s (%.1f M fights/s)\n",
+              (unsigned long long)st.fights, secs,
+              secs > 0 ? (double)st.fights / secs / 1e6 : 0.0);
+  std::printf("player wins : %.4f%%\n", 100.0 * st.winRate());
+  std::printf("turns       : mean %.3f  p50 %d  p90 %d  p99 %d  max %d\n",
+              histMean(st.turns), histPercentile(st.turns, 0.50),
+              histPercentile(st.turns, 0.90), histPercentile(st.turns, 0.99),
+              (int)st.turns.size() - 1);
+  std::printf("player HP left on win : mean %.3f\n", histMean(st.playerHpLeft));
+  std::printf("enemy HP left on loss : mean %.3f\n", histMean(st.enemyHpLeft));
+  printHist("turns-to-kill distribution:", st.turns, st.fights);
+  printHist("player HP remaining (wins):", st.playerHpLeft, st.fights);
+  printHist("enemy HP remaining (losses):", st.enemyHpLeft, st.fights);
+  return 0;
+}